@@ -0,0 +1,52 @@
+# - EmbedShaders
+# Compiles GLSL shaders to SPIR-V and embeds them into C sources
+#
+#   embed_shaders(<sources> <shader>...)
+#
+# Appends generated C sources to <sources> variable. Shader "foo.vert" is
+# exported as "const uint32_t foo_vert_spv[]" and "const size_t
+# foo_vert_spv_size". SHADERS_FOUND is set if GLSL compiler was found.
+
+find_program(GLSLANG_VALIDATOR NAMES glslangValidator)
+find_program(GLSLC NAMES glslc)
+find_program(SPIRV_OPT NAMES spirv-opt)
+mark_as_advanced(GLSLANG_VALIDATOR GLSLC SPIRV_OPT)
+option(OPTIMIZE_SHADERS "Optimize SPIR-V with spirv-opt when available" ON)
+
+if(GLSLANG_VALIDATOR)
+    set(GLSL_COMPILER ${GLSLANG_VALIDATOR})
+elseif(GLSLC)
+    set(GLSL_COMPILER ${GLSLC})
+endif()
+if(GLSL_COMPILER)
+    set(SHADERS_FOUND TRUE)
+else()
+    set(SHADERS_FOUND FALSE)
+endif()
+if(OPTIMIZE_SHADERS AND SPIRV_OPT)
+    set(SHADER_OPTIMIZER ${SPIRV_OPT})
+else()
+    set(SHADER_OPTIMIZER "")
+endif()
+
+set(EMBED_SHADER_SCRIPT "${CMAKE_SOURCE_DIR}/shaders/embed_shader.sh")
+
+function(embed_shaders sources)
+    set(generated "")
+    foreach(shader ${ARGN})
+        get_filename_component(name ${shader} NAME)
+        string(REPLACE "." "_" symbol "${name}_spv")
+        set(input "${CMAKE_CURRENT_SOURCE_DIR}/${shader}")
+        set(output "${CMAKE_CURRENT_BINARY_DIR}/shaders/${symbol}.c")
+        add_custom_command(OUTPUT ${output}
+            COMMAND ${CMAKE_COMMAND} -E make_directory
+                "${CMAKE_CURRENT_BINARY_DIR}/shaders"
+            COMMAND sh ${EMBED_SHADER_SCRIPT} ${GLSL_COMPILER}
+                "${SHADER_OPTIMIZER}" ${input} ${symbol} ${output}
+            DEPENDS ${input} ${EMBED_SHADER_SCRIPT}
+            COMMENT "Embedding shader ${shader}"
+            VERBATIM)
+        list(APPEND generated ${output})
+    endforeach()
+    set(${sources} ${${sources}} ${generated} PARENT_SCOPE)
+endfunction()
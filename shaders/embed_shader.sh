@@ -0,0 +1,43 @@
+#!/bin/sh
+# Compile GLSL shader to SPIR-V and embed it into C source as array of words
+#
+# Usage: embed_shader.sh COMPILER SPIRV_OPT INPUT SYMBOL OUTPUT
+#   COMPILER   path to glslangValidator or glslc
+#   SPIRV_OPT  path to spirv-opt, or empty string to skip optimization
+#   INPUT      GLSL source, stage is taken from its extension
+#   SYMBOL     name of the array to define
+#   OUTPUT     C source to write
+set -e
+
+compiler="$1"
+optimizer="$2"
+input="$3"
+symbol="$4"
+output="$5"
+spirv="$output.spv"
+
+case "$(basename "$compiler")" in
+    glslc*)
+        "$compiler" -o "$spirv" "$input"
+        ;;
+    *)
+        "$compiler" -V -o "$spirv" "$input" > /dev/null
+        ;;
+esac
+if test -n "$optimizer"; then
+    "$optimizer" -O "$spirv" -o "$spirv.opt"
+    mv "$spirv.opt" "$spirv"
+fi
+
+{
+    echo "/* Generated from $(basename "$input"), do not edit */"
+    echo "#include \"shaders.h\""
+    echo ""
+    echo "const uint32_t ${symbol}[] = {"
+    od -An -v -tx4 "$spirv" | sed -e 's/\([0-9a-f]\{8\}\)/0x\1,/g' \
+        -e 's/^ */    /' -e 's/ *$//'
+    echo "};"
+    echo "const size_t ${symbol}_size = sizeof (${symbol});"
+} > "$output.tmp"
+mv "$output.tmp" "$output"
+rm -f "$spirv"
@@ -0,0 +1,27 @@
+#version 450
+
+layout (constant_id = 1) const bool GRAYSCALE = false;
+/* True if image format has no sRGB encoding of its own, e.g. 10-bit UNORM */
+layout (constant_id = 2) const bool ENCODE_SRGB = false;
+
+layout (location = 0) in vec3 color;
+layout (location = 0) out vec4 fragColor;
+
+vec3 encode_srgb (vec3 linear)
+{
+    vec3 low = linear * 12.92;
+    vec3 high = 1.055 * pow (linear, vec3 (1.0 / 2.4)) - 0.055;
+    return mix (low, high, step (vec3 (0.0031308), linear));
+}
+
+void main ()
+{
+    vec3 rgb = color;
+    if (GRAYSCALE) {
+        rgb = vec3 (dot (color, vec3 (0.299, 0.587, 0.114)));
+    }
+    if (ENCODE_SRGB) {
+        rgb = encode_srgb (rgb);
+    }
+    fragColor = vec4 (rgb, 1.0);
+}
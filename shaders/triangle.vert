@@ -0,0 +1,30 @@
+#version 450
+
+layout (constant_id = 0) const bool ANIMATE = true;
+
+layout (push_constant) uniform PushConstants {
+    float time;
+} pc;
+
+layout (location = 0) out vec3 color;
+
+const vec2 positions[3] = vec2[] (
+    vec2 (0.0, -0.6),
+    vec2 (0.6, 0.5),
+    vec2 (-0.6, 0.5)
+);
+
+const vec3 colors[3] = vec3[] (
+    vec3 (1.0, 0.0, 0.0),
+    vec3 (0.0, 1.0, 0.0),
+    vec3 (0.0, 0.0, 1.0)
+);
+
+void main ()
+{
+    float angle = ANIMATE ? pc.time : 0.0;
+    float c = cos (angle);
+    float s = sin (angle);
+    gl_Position = vec4 (mat2 (c, s, -s, c) * positions[gl_VertexIndex], 0.0, 1.0);
+    color = colors[gl_VertexIndex];
+}
@@ -0,0 +1,534 @@
+/**
+ * @file benchmark.c
+ * Sample series, percentiles and histograms of a benchmark run.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "benchmark.h"
+#include "common.h"
+#include "timer.h"
+
+/** Number of buckets in histograms of the report */
+#define HISTOGRAM_BUCKETS 32
+
+/** Growable array of samples in milliseconds */
+typedef struct sample_series_t {
+    double *values;
+    size_t count;
+    size_t capacity;
+} sample_series_t;
+
+/** Summary of sample series */
+typedef struct series_summary_t {
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    double bucket_ms; /**< Width of histogram bucket */
+    uint32_t histogram[HISTOGRAM_BUCKETS];
+} series_summary_t;
+
+/** CPU counters accumulated under one name */
+typedef struct counter_group_t {
+    const char *name;
+    perf_sample_t total;
+} counter_group_t;
+
+struct benchmark_t {
+    uint32_t frames; /**< Number of frames to measure */
+    uint32_t warmup; /**< Number of frames to skip */
+    uint64_t seed;
+    uint64_t frame_count; /**< Number of last finished frame plus one */
+    uint64_t last_present_ns; /**< Present time of previous frame */
+    uint64_t create_ns; /**< Time the benchmark was created */
+    double startup_ms; /**< Time from creation to first present */
+    uint32_t startup_round_trips; /**< Replies of X server waited for */
+    VkPhysicalDeviceProperties properties;
+    uint32_t physical_device_count; /**< Devices the device was chosen from */
+    char present_mode[32];
+    char format[32];
+    uint32_t image_count;
+    VkExtent2D extent;
+    int has_window; /**< true if window state is set */
+    int is_fullscreen;
+    int unredirected; /**< -1 if unknown */
+    sample_series_t cpu_frame_ms;
+    sample_series_t gpu_frame_ms;
+    sample_series_t present_interval_ms;
+    const char *latency_source; /**< NULL if latency is not measured */
+    sample_series_t present_latency_ms;
+    uint64_t queue_depth_sum;
+    uint32_t queue_depth_max;
+    uint32_t pass_count;
+    int has_statistics; /**< true if pipeline statistics were collected */
+    const char *pass_names[GPU_PROFILER_MAX_PASSES];
+    sample_series_t pass_ms[GPU_PROFILER_MAX_PASSES];
+    gpu_pipeline_statistics_t pass_statistics[GPU_PROFILER_MAX_PASSES];
+    uint64_t statistics_samples[GPU_PROFILER_MAX_PASSES];
+    uint32_t phase_count;
+    counter_group_t phases[BENCHMARK_MAX_COUNTER_GROUPS];
+    uint32_t thread_count;
+    counter_group_t threads[BENCHMARK_MAX_COUNTER_GROUPS];
+};
+
+/** Append sample to series, sample is dropped if out of memory */
+static void series_add (sample_series_t *series, double value)
+{
+    if (series->count == series->capacity) {
+        size_t capacity = series->capacity != 0 ? series->capacity * 2 : 256;
+        double *values = (double *)realloc (series->values,
+                                            capacity * sizeof (double));
+        if (values == NULL) {
+            return;
+        }
+        series->values = values;
+        series->capacity = capacity;
+    }
+    series->values[series->count++] = value;
+}
+
+static int compare_doubles (const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/** Nearest-rank percentile of sorted samples */
+static double percentile (const double *sorted, size_t count, double p)
+{
+    const double rank = ceil (p / 100.0 * (double)count);
+    return rank >= 1.0 ? sorted[(size_t)rank - 1] : sorted[0];
+}
+
+/** Compute statistics of series
+ * @returns 0 if series is empty
+ */
+static int series_summarize (const sample_series_t *series,
+                             series_summary_t *summary)
+{
+    double *sorted = NULL;
+    double sum = 0.0;
+    memset (summary, 0, sizeof (*summary));
+    if (series->count == 0) {
+        return 0;
+    }
+    sorted = (double *)malloc (series->count * sizeof (double));
+    if (sorted == NULL) {
+        return 0;
+    }
+    memcpy (sorted, series->values, series->count * sizeof (double));
+    qsort (sorted, series->count, sizeof (double), compare_doubles);
+    for (size_t i = 0; i < series->count; i++) {
+        sum += sorted[i];
+    }
+    summary->mean = sum / (double)series->count;
+    summary->p50 = percentile (sorted, series->count, 50.0);
+    summary->p95 = percentile (sorted, series->count, 95.0);
+    summary->p99 = percentile (sorted, series->count, 99.0);
+    summary->max = sorted[series->count - 1];
+    /* Buckets cover [0, max] rounded up to whole 0.1 ms */
+    summary->bucket_ms = ceil (summary->max * 10.0 + 1.0) / 10.0
+                         / HISTOGRAM_BUCKETS;
+    for (size_t i = 0; i < series->count; i++) {
+        size_t bucket = (size_t)(sorted[i] / summary->bucket_ms);
+        if (bucket >= HISTOGRAM_BUCKETS) {
+            bucket = HISTOGRAM_BUCKETS - 1;
+        }
+        summary->histogram[bucket]++;
+    }
+    free (sorted);
+    return 1;
+}
+
+benchmark_t *benchmark_create (uint32_t frames, uint32_t warmup, uint64_t seed)
+{
+    benchmark_t *benchmark = (benchmark_t *)calloc (1, sizeof (benchmark_t));
+    if (benchmark == NULL) {
+        return NULL;
+    }
+    benchmark->frames = frames;
+    benchmark->warmup = warmup;
+    benchmark->seed = seed;
+    benchmark->create_ns = timer_now_ns ();
+    strcpy (benchmark->present_mode, "unknown");
+    strcpy (benchmark->format, "unknown");
+    return benchmark;
+}
+
+void benchmark_destroy (benchmark_t *benchmark)
+{
+    if (benchmark == NULL) {
+        return;
+    }
+    free (benchmark->cpu_frame_ms.values);
+    free (benchmark->gpu_frame_ms.values);
+    free (benchmark->present_interval_ms.values);
+    free (benchmark->present_latency_ms.values);
+    for (uint32_t i = 0; i < GPU_PROFILER_MAX_PASSES; i++) {
+        free (benchmark->pass_ms[i].values);
+    }
+    free (benchmark);
+}
+
+void benchmark_set_device (benchmark_t *benchmark,
+                           const VkPhysicalDeviceProperties *properties,
+                           uint32_t physical_device_count)
+{
+    benchmark->properties = *properties;
+    benchmark->physical_device_count = physical_device_count;
+}
+
+void benchmark_set_swapchain (benchmark_t *benchmark, const char *present_mode,
+                              const char *format, uint32_t image_count,
+                              VkExtent2D extent)
+{
+    snprintf (benchmark->present_mode, sizeof (benchmark->present_mode), "%s",
+              present_mode);
+    snprintf (benchmark->format, sizeof (benchmark->format), "%s",
+              format != NULL ? format : "unknown");
+    benchmark->image_count = image_count;
+    benchmark->extent = extent;
+}
+
+void benchmark_set_window (benchmark_t *benchmark, int is_fullscreen,
+                           int unredirected)
+{
+    benchmark->has_window = 1;
+    benchmark->is_fullscreen = is_fullscreen;
+    benchmark->unredirected = unredirected;
+}
+
+void benchmark_set_startup_round_trips (benchmark_t *benchmark,
+                                        uint32_t round_trips)
+{
+    if (benchmark != NULL) {
+        benchmark->startup_round_trips = round_trips;
+    }
+}
+
+/** Check is frame with given number is measured, not warmup */
+static int is_measured (const benchmark_t *benchmark, uint64_t frame_number)
+{
+    return frame_number >= benchmark->warmup
+           && frame_number < (uint64_t)benchmark->warmup + benchmark->frames;
+}
+
+void benchmark_end_frame (benchmark_t *benchmark, uint64_t frame_number,
+                          double cpu_ms, uint64_t present_ns)
+{
+    if (benchmark == NULL) {
+        return;
+    }
+    if (benchmark->last_present_ns == 0) {
+        benchmark->startup_ms = timer_elapsed_ms (benchmark->create_ns,
+                                present_ns);
+    }
+    if (is_measured (benchmark, frame_number)) {
+        series_add (&benchmark->cpu_frame_ms, cpu_ms);
+        /* Interval to the first measured frame comes from last warmup one */
+        if (benchmark->last_present_ns != 0) {
+            series_add (&benchmark->present_interval_ms,
+                        (double)(present_ns - benchmark->last_present_ns) / 1e6);
+        }
+    }
+    benchmark->last_present_ns = present_ns;
+    benchmark->frame_count = frame_number + 1;
+}
+
+void benchmark_set_latency_source (benchmark_t *benchmark, const char *source)
+{
+    if (benchmark != NULL) {
+        benchmark->latency_source = source;
+    }
+}
+
+void benchmark_add_present_latency (benchmark_t *benchmark,
+                                    const present_latency_sample_t *sample)
+{
+    if (benchmark == NULL || !is_measured (benchmark, sample->frame_number)) {
+        return;
+    }
+    series_add (&benchmark->present_latency_ms, sample->latency_ms);
+    benchmark->queue_depth_sum += sample->queue_depth;
+    if (sample->queue_depth > benchmark->queue_depth_max) {
+        benchmark->queue_depth_max = sample->queue_depth;
+    }
+}
+
+void benchmark_add_gpu_frame (benchmark_t *benchmark,
+                              const gpu_frame_timings_t *timings)
+{
+    if (benchmark == NULL || !is_measured (benchmark, timings->frame_number)) {
+        return;
+    }
+    series_add (&benchmark->gpu_frame_ms, timings->frame_ms);
+    benchmark->has_statistics = timings->has_statistics;
+    for (uint32_t i = 0; i < timings->pass_count; i++) {
+        const gpu_pipeline_statistics_t *pass = &timings->pass_statistics[i];
+        gpu_pipeline_statistics_t *total = &benchmark->pass_statistics[i];
+        if (i >= benchmark->pass_count) {
+            benchmark->pass_names[i] = timings->pass_names[i];
+            benchmark->pass_count = i + 1;
+        }
+        series_add (&benchmark->pass_ms[i], timings->pass_ms[i]);
+        if (timings->has_statistics) {
+            total->vertex_invocations += pass->vertex_invocations;
+            total->clipping_primitives += pass->clipping_primitives;
+            total->fragment_invocations += pass->fragment_invocations;
+            total->compute_invocations += pass->compute_invocations;
+            benchmark->statistics_samples[i]++;
+        }
+    }
+}
+
+/** Add counters to group with given name, creating it if there is room */
+static void add_counters (counter_group_t *groups, uint32_t *count,
+                          const char *name, const perf_sample_t *counters)
+{
+    uint32_t i = 0;
+    while (i < *count && strcmp (groups[i].name, name) != 0) {
+        i++;
+    }
+    if (i == BENCHMARK_MAX_COUNTER_GROUPS) {
+        return;
+    }
+    if (i == *count) {
+        groups[i].name = name;
+        (*count)++;
+    }
+    for (uint32_t j = 0; j < PERF_COUNTER_COUNT; j++) {
+        groups[i].total.values[j] += counters->values[j];
+    }
+    groups[i].total.valid |= counters->valid;
+}
+
+void benchmark_add_phase_counters (benchmark_t *benchmark, const char *name,
+                                   const perf_sample_t *counters)
+{
+    if (benchmark == NULL || counters->valid == 0
+            || !is_measured (benchmark, benchmark->frame_count)) {
+        return;
+    }
+    add_counters (benchmark->phases, &benchmark->phase_count, name, counters);
+}
+
+void benchmark_add_thread_counters (benchmark_t *benchmark, const char *name,
+                                    const perf_sample_t *counters)
+{
+    if (benchmark == NULL || counters->valid == 0) {
+        return;
+    }
+    add_counters (benchmark->threads, &benchmark->thread_count, name, counters);
+}
+
+int benchmark_is_done (const benchmark_t *benchmark)
+{
+    return benchmark != NULL
+           && benchmark->frame_count >= (uint64_t)benchmark->warmup
+           + benchmark->frames;
+}
+
+/** Write summary of series as JSON object */
+static void write_json_series (FILE *file, const char *indent,
+                               const sample_series_t *series)
+{
+    series_summary_t summary;
+    if (!series_summarize (series, &summary)) {
+        fprintf (file, "null");
+        return;
+    }
+    fprintf (file, "{\n"
+             "%s  \"samples\": %lu,\n"
+             "%s  \"mean\": %.4f,\n"
+             "%s  \"p50\": %.4f,\n"
+             "%s  \"p95\": %.4f,\n"
+             "%s  \"p99\": %.4f,\n"
+             "%s  \"max\": %.4f,\n"
+             "%s  \"histogram\": {\"bucket_ms\": %.4f, \"counts\": [",
+             indent, (unsigned long)series->count, indent, summary.mean,
+             indent, summary.p50, indent, summary.p95, indent, summary.p99,
+             indent, summary.max, indent, summary.bucket_ms);
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        fprintf (file, "%s%u", i > 0 ? ", " : "", summary.histogram[i]);
+    }
+    fprintf (file, "]}\n%s}", indent);
+}
+
+/** Write latency distribution with mean and max queue depth */
+static void write_json_latency (FILE *file, const benchmark_t *benchmark)
+{
+    const size_t count = benchmark->present_latency_ms.count;
+    if (benchmark->latency_source == NULL) {
+        fprintf (file, "null");
+        return;
+    }
+    fprintf (file, "{\n    \"source\": \"%s\",\n    \"latency_ms\": ",
+             benchmark->latency_source);
+    write_json_series (file, "    ", &benchmark->present_latency_ms);
+    fprintf (file, ",\n    \"queue_depth\": {\"mean\": %.4f, \"max\": %u}\n  }",
+             count > 0 ? (double)benchmark->queue_depth_sum / (double)count : 0.0,
+             benchmark->queue_depth_max);
+}
+
+/** Write average pipeline statistics of pass as JSON object */
+static void write_json_statistics (FILE *file, const benchmark_t *benchmark,
+                                   uint32_t pass)
+{
+    const gpu_pipeline_statistics_t *total = &benchmark->pass_statistics[pass];
+    const double samples = (double)benchmark->statistics_samples[pass];
+    if (!benchmark->has_statistics || samples < 1.0) {
+        fprintf (file, "null");
+        return;
+    }
+    fprintf (file, "{\n"
+             "        \"vertex_invocations\": %.1f,\n"
+             "        \"clipping_primitives\": %.1f,\n"
+             "        \"fragment_invocations\": %.1f,\n"
+             "        \"compute_invocations\": %.1f\n"
+             "      }",
+             (double)total->vertex_invocations / samples,
+             (double)total->clipping_primitives / samples,
+             (double)total->fragment_invocations / samples,
+             (double)total->compute_invocations / samples);
+}
+
+/** Write rate of counter per kilo-instruction, null if unavailable */
+static void write_json_mpki (FILE *file, const perf_sample_t *total,
+                             perf_counter_t counter)
+{
+    const uint32_t needed = (1u << counter)
+                            | (1u << PERF_COUNTER_INSTRUCTIONS);
+    if ((total->valid & needed) != needed
+            || total->values[PERF_COUNTER_INSTRUCTIONS] == 0) {
+        fprintf (file, "null");
+        return;
+    }
+    fprintf (file, "%.4f", (double)total->values[counter] * 1000.0
+             / (double)total->values[PERF_COUNTER_INSTRUCTIONS]);
+}
+
+/** Write counters of groups as JSON array */
+static void write_json_counters (FILE *file, const counter_group_t *groups,
+                                 uint32_t count)
+{
+    const uint32_t ipc_needed = (1u << PERF_COUNTER_CYCLES)
+                                | (1u << PERF_COUNTER_INSTRUCTIONS);
+    fprintf (file, "[");
+    for (uint32_t i = 0; i < count; i++) {
+        const perf_sample_t *total = &groups[i].total;
+        fprintf (file, "%s\n      {\n        \"name\": ", i > 0 ? "," : "");
+        write_json_string (file, groups[i].name);
+        for (uint32_t j = 0; j < PERF_COUNTER_COUNT; j++) {
+            fprintf (file, ",\n        \"%s\": ",
+                     perf_counter_name ((perf_counter_t)j));
+            if (total->valid & (1u << j)) {
+                fprintf (file, "%llu", (unsigned long long)total->values[j]);
+            } else {
+                fprintf (file, "null");
+            }
+        }
+        fprintf (file, ",\n        \"ipc\": ");
+        if ((total->valid & ipc_needed) == ipc_needed
+                && total->values[PERF_COUNTER_CYCLES] != 0) {
+            fprintf (file, "%.4f",
+                     (double)total->values[PERF_COUNTER_INSTRUCTIONS]
+                     / (double)total->values[PERF_COUNTER_CYCLES]);
+        } else {
+            fprintf (file, "null");
+        }
+        fprintf (file, ",\n        \"cache_misses_per_kilo_instruction\": ");
+        write_json_mpki (file, total, PERF_COUNTER_CACHE_MISSES);
+        fprintf (file, ",\n        \"branch_misses_per_kilo_instruction\": ");
+        write_json_mpki (file, total, PERF_COUNTER_BRANCH_MISSES);
+        fprintf (file, "\n      }");
+    }
+    fprintf (file, "%s]", count > 0 ? "\n    " : "");
+}
+
+int benchmark_write_report (const benchmark_t *benchmark, const char *path)
+{
+    const int is_stdout = path == NULL || strcmp (path, "-") == 0;
+    FILE *file = is_stdout ? stdout : fopen (path, "w");
+    const VkPhysicalDeviceProperties *properties = &benchmark->properties;
+    if (file == NULL) {
+        return -1;
+    }
+    fprintf (file, "{\n  \"device\": {\n    \"name\": ");
+    write_json_string (file, properties->deviceName);
+    fprintf (file, ",\n"
+             "    \"vendorID\": %u,\n"
+             "    \"deviceID\": %u,\n"
+             "    \"driverVersion\": %u,\n"
+             "    \"apiVersion\": %u,\n"
+             "    \"physical_device_count\": %u\n"
+             "  },\n",
+             properties->vendorID, properties->deviceID,
+             properties->driverVersion, properties->apiVersion,
+             benchmark->physical_device_count);
+    fprintf (file, "  \"swapchain\": {\n    \"present_mode\": ");
+    write_json_string (file, benchmark->present_mode);
+    fprintf (file, ",\n    \"format\": ");
+    write_json_string (file, benchmark->format);
+    fprintf (file, ",\n"
+             "    \"image_count\": %u,\n"
+             "    \"width\": %u,\n"
+             "    \"height\": %u\n"
+             "  },\n",
+             benchmark->image_count, benchmark->extent.width,
+             benchmark->extent.height);
+    if (benchmark->has_window) {
+        fprintf (file, "  \"window\": {\n    \"fullscreen\": %s,\n"
+                 "    \"unredirected\": %s\n  },\n",
+                 benchmark->is_fullscreen ? "true" : "false",
+                 benchmark->unredirected < 0 ? "null"
+                 : benchmark->unredirected ? "true" : "false");
+    } else {
+        fprintf (file, "  \"window\": null,\n");
+    }
+    fprintf (file, "  \"frames\": %u,\n  \"warmup\": %u,\n  \"seed\": %llu,\n",
+             benchmark->frames, benchmark->warmup,
+             (unsigned long long)benchmark->seed);
+    fprintf (file, "  \"startup_ms\": %.4f,\n", benchmark->startup_ms);
+    fprintf (file, "  \"startup_round_trips\": %u,\n",
+             benchmark->startup_round_trips);
+    fprintf (file, "  \"cpu_frame_ms\": ");
+    write_json_series (file, "  ", &benchmark->cpu_frame_ms);
+    fprintf (file, ",\n  \"gpu_frame_ms\": ");
+    write_json_series (file, "  ", &benchmark->gpu_frame_ms);
+    fprintf (file, ",\n  \"present_interval_ms\": ");
+    write_json_series (file, "  ", &benchmark->present_interval_ms);
+    fprintf (file, ",\n  \"present_latency\": ");
+    write_json_latency (file, benchmark);
+    fprintf (file, ",\n  \"passes\": [");
+    for (uint32_t i = 0; i < benchmark->pass_count; i++) {
+        fprintf (file, "%s\n    {\n      \"name\": ", i > 0 ? "," : "");
+        write_json_string (file, benchmark->pass_names[i]);
+        fprintf (file, ",\n      \"gpu_ms\": ");
+        write_json_series (file, "      ", &benchmark->pass_ms[i]);
+        fprintf (file, ",\n      \"pipeline_statistics\": ");
+        write_json_statistics (file, benchmark, i);
+        fprintf (file, "\n    }");
+    }
+    fprintf (file, "%s],\n", benchmark->pass_count > 0 ? "\n  " : "");
+    /* Counters are null when perf events are not available */
+    if (benchmark->phase_count == 0 && benchmark->thread_count == 0) {
+        fprintf (file, "  \"cpu_counters\": null\n}\n");
+    } else {
+        fprintf (file, "  \"cpu_counters\": {\n    \"phases\": ");
+        write_json_counters (file, benchmark->phases, benchmark->phase_count);
+        fprintf (file, ",\n    \"threads\": ");
+        write_json_counters (file, benchmark->threads, benchmark->thread_count);
+        fprintf (file, "\n  }\n}\n");
+    }
+    if (is_stdout) {
+        return fflush (file) == 0 ? 0 : -1;
+    }
+    return fclose (file) == 0 ? 0 : -1;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file benchmark.h
+ * Collection of frame timings and JSON report of benchmark run.
+ */
+#ifndef VKBOOTSTRAP_BENCHMARK_H
+#define VKBOOTSTRAP_BENCHMARK_H
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "gpu_profiler.h"
+#include "perf_counters.h"
+#include "present_latency.h"
+
+/** Maximum number of distinct names of phases and of threads */
+#define BENCHMARK_MAX_COUNTER_GROUPS 16
+
+typedef struct benchmark_t benchmark_t;
+
+/** Create benchmark that records @a frames frames after @a warmup frames
+ *
+ * Startup time in the report is counted from this call to the first present.
+ * @param frames number of frames to measure
+ * @param warmup number of frames to skip before measuring
+ * @param seed seed of the workload, written to the report
+ * @returns new benchmark, NULL if out of memory
+ */
+benchmark_t *benchmark_create (uint32_t frames, uint32_t warmup, uint64_t seed);
+
+/** Free benchmark
+ * @param benchmark benchmark to free, can be NULL
+ */
+void benchmark_destroy (benchmark_t *benchmark);
+
+/** Remember device the benchmark runs on
+ * @param benchmark target benchmark
+ * @param properties properties of the device
+ * @param physical_device_count number of devices Vulkan reported, 0 if
+ *        Vulkan is not used
+ */
+void benchmark_set_device (benchmark_t *benchmark,
+                           const VkPhysicalDeviceProperties *properties,
+                           uint32_t physical_device_count);
+
+/** Remember parameters of swapchain the benchmark presents to
+ * @param benchmark target benchmark
+ * @param present_mode human readable name of present mode
+ * @param format human readable name of image format, NULL if unknown
+ * @param image_count number of swapchain images
+ * @param extent size of swapchain images
+ */
+void benchmark_set_swapchain (benchmark_t *benchmark, const char *present_mode,
+                              const char *format, uint32_t image_count,
+                              VkExtent2D extent);
+
+/** Remember state of window the benchmark presents to
+ *
+ * Report has null window if this is never called, e.g. in headless mode.
+ * @param benchmark target benchmark
+ * @param is_fullscreen non-zero if window was created fullscreen
+ * @param unredirected 1 if compositor doesn't redirect the window, 0 if it
+ *        does, -1 if unknown
+ */
+void benchmark_set_window (benchmark_t *benchmark, int is_fullscreen,
+                           int unredirected);
+
+/** Remember how many times startup waited for replies of X server
+ * @param benchmark target benchmark, can be NULL
+ * @param round_trips number of round trips, 0 in headless mode
+ */
+void benchmark_set_startup_round_trips (benchmark_t *benchmark,
+                                        uint32_t round_trips);
+
+/** Record CPU time of presented frame and finish it
+ *
+ * Frames that were dropped are not finished, so warmup and measured range
+ * count the same frame numbers GPU timings and latencies carry.
+ * @param benchmark target benchmark, can be NULL
+ * @param frame_number number of frame given to GPU profiler
+ * @param cpu_ms CPU time spent on frame, excluding waits for GPU
+ * @param present_ns time the frame was presented, see timer_now_ns()
+ */
+void benchmark_end_frame (benchmark_t *benchmark, uint64_t frame_number,
+                          double cpu_ms, uint64_t present_ns);
+
+/** Record GPU timings of frame, they arrive few frames later than CPU ones
+ * @param benchmark target benchmark, can be NULL
+ * @param timings timings read back by GPU profiler
+ */
+void benchmark_add_gpu_frame (benchmark_t *benchmark,
+                              const gpu_frame_timings_t *timings);
+
+/** Remember how present latency is measured
+ * @param benchmark target benchmark, can be NULL
+ * @param source string literal, "present_wait" or "fence"
+ */
+void benchmark_set_latency_source (benchmark_t *benchmark, const char *source);
+
+/** Record present latency of frame, it arrives few frames later than CPU one
+ * @param benchmark target benchmark, can be NULL
+ * @param sample latency collected from present latency tracker
+ */
+void benchmark_add_present_latency (benchmark_t *benchmark,
+                                    const present_latency_sample_t *sample);
+
+/** Record CPU counters of phase of current frame, ignored during warmup
+ * @param benchmark target benchmark, can be NULL
+ * @param name string literal naming the phase
+ * @param counters counters of the phase, accumulated over calls
+ */
+void benchmark_add_phase_counters (benchmark_t *benchmark, const char *name,
+                                   const perf_sample_t *counters);
+
+/** Record CPU counters of thread over whole run
+ * @param benchmark target benchmark, can be NULL
+ * @param name string literal naming the thread
+ * @param counters counters of the thread, accumulated over calls
+ */
+void benchmark_add_thread_counters (benchmark_t *benchmark, const char *name,
+                                    const perf_sample_t *counters);
+
+/** Check if all frames have been recorded
+ * @param benchmark benchmark to check, can be NULL
+ * @returns non-zero if benchmark is done, 0 if not or benchmark is NULL
+ */
+int benchmark_is_done (const benchmark_t *benchmark);
+
+/** Write report as JSON
+ * @param benchmark benchmark to report
+ * @param path file to write, "-" or NULL for standard output
+ * @returns 0 on success, -1 if file can't be written
+ */
+int benchmark_write_report (const benchmark_t *benchmark, const char *path);
+
+#endif
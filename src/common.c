@@ -0,0 +1,65 @@
+/**
+ * @file common.c
+ * Helpers shared by renderer, benchmarks and reports.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "common.h"
+
+const char *get_present_mode_string (VkPresentModeKHR presentMode)
+{
+    switch (presentMode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "fifo relaxed";
+        case VK_PRESENT_MODE_RANGE_SIZE_KHR:
+        case VK_PRESENT_MODE_MAX_ENUM_KHR:
+        default:
+            break;
+    }
+    return "unknown";
+}
+
+const char *get_format_string (VkFormat format)
+{
+    static const struct {
+        VkFormat format;
+        const char *name;
+    } names[] = {
+        {VK_FORMAT_A2B10G10R10_UNORM_PACK32, "A2B10G10R10_UNORM"},
+        {VK_FORMAT_A2R10G10B10_UNORM_PACK32, "A2R10G10B10_UNORM"},
+        {VK_FORMAT_B8G8R8A8_SRGB, "B8G8R8A8_SRGB"},
+        {VK_FORMAT_R8G8B8A8_SRGB, "R8G8B8A8_SRGB"},
+        {VK_FORMAT_B8G8R8A8_UNORM, "B8G8R8A8_UNORM"},
+        {VK_FORMAT_R8G8B8A8_UNORM, "R8G8B8A8_UNORM"},
+        {VK_FORMAT_R16G16B16A16_SFLOAT, "R16G16B16A16_SFLOAT"},
+    };
+    for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); i++) {
+        if (names[i].format == format) {
+            return names[i].name;
+        }
+    }
+    return NULL;
+}
+
+void write_json_string (FILE *file, const char *string)
+{
+    fputc ('"', file);
+    for (; *string != '\0'; string++) {
+        const unsigned char c = (unsigned char) * string;
+        if (c == '"' || c == '\\') {
+            fprintf (file, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf (file, "\\u%04x", c);
+        } else {
+            fputc (c, file);
+        }
+    }
+    fputc ('"', file);
+}
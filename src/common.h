@@ -0,0 +1,25 @@
+/**
+ * @file common.h
+ * Limits and helpers shared by renderer, benchmarks and reports.
+ */
+#ifndef VKBOOTSTRAP_COMMON_H
+#define VKBOOTSTRAP_COMMON_H
+#include <stdio.h>
+#include <vulkan/vulkan.h>
+
+#define MAX_QUEUE_FAMILY_PROPERTIES 100
+#define MAX_SWAPCHAIN_IMAGES 8
+#define MAX_SURFACE_FORMATS 64
+
+/** Get short lowercase name of present mode, "unknown" for others */
+const char *get_present_mode_string (VkPresentModeKHR presentMode);
+
+/** Get name of image format without VK_FORMAT_ prefix
+ * @returns name of formats swapchains may use, NULL for others
+ */
+const char *get_format_string (VkFormat format);
+
+/** Write string as JSON string literal, escaping what needs it */
+void write_json_string (FILE *file, const char *string);
+
+#endif
@@ -1,9 +1,15 @@
 /* src/config.h.  Generated from config.h.in by configure.  */
 /* src/config.h.in.  Generated from configure.ac by autoheader.  */
 
+/* Define to 1 to compile trace zones in */
+/* #undef ENABLE_TRACE */
+
 /* Define to 1 if you have the <inttypes.h> header file. */
 #define HAVE_INTTYPES_H 1
 
+/* Define to 1 if you have the <linux/perf_event.h> header file. */
+#define HAVE_LINUX_PERF_EVENT_H 1
+
 /* Define to 1 if your system has a GNU libc compatible `malloc' function, and
    to 0 otherwise. */
 #define HAVE_MALLOC 1
@@ -11,6 +17,9 @@
 /* Define to 1 if you have the <memory.h> header file. */
 #define HAVE_MEMORY_H 1
 
+/* Define to 1 if you have the <pthread.h> header file. */
+#define HAVE_PTHREAD_H 1
+
 /* Define to 1 if you have the <stdint.h> header file. */
 #define HAVE_STDINT_H 1
 
@@ -32,6 +41,21 @@
 /* Define to 1 if you have the <unistd.h> header file. */
 #define HAVE_UNISTD_H 1
 
+/* Define to 1 to report if compositor unredirected window */
+/* #undef HAVE_XCB_COMPOSITE */
+
+/* Define to 1 to build software renderer presented through MIT-SHM */
+/* #undef HAVE_XCB_SHM */
+
+/* Define to 1 to synchronize resize with _NET_WM_SYNC_REQUEST */
+/* #undef HAVE_XCB_SYNC */
+
+/* Define to 1 to receive raw motion from XInput2 */
+/* #undef HAVE_XCB_XINPUT */
+
+/* Define to 1 if shaders are compiled and embedded */
+/* #undef HAVE_SHADERS */
+
 /* Name of package */
 #define PACKAGE "vkbootstrap"
 
@@ -0,0 +1,199 @@
+/**
+ * @file flight_recorder.c
+ * Static ring of events and its async-signal-safe text dump.
+ */
+#define _POSIX_C_SOURCE 200809L
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "flight_recorder.h"
+#include "timer.h"
+
+/** Number of events kept, must be power of two */
+#define RING_SIZE 2048
+#define MAX_PATH_LENGTH 4096
+#define MAX_LINE_LENGTH 256
+
+typedef struct flight_record_t {
+    uint64_t time_ns;
+    uint64_t frame;
+    uint32_t event;
+    int32_t result;
+    uint32_t args[3];
+} flight_record_t;
+
+/** Name of each event and names of its arguments, NULL if unused */
+static const char *const event_names[FLIGHT_EVENT_COUNT][4] = {
+    {"frame", "cpu_us", "wait_us", NULL},
+    {"gpu_frame", "gpu_us", "passes", NULL},
+    {"acquire", "image", NULL, NULL},
+    {"submit", "frame_index", NULL, NULL},
+    {"present", "image", NULL, NULL},
+    {"swapchain", "width", "height", "images"},
+    {"error", "line", NULL, NULL},
+};
+
+/** Signals that terminate process and are worth a dump */
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+static flight_record_t records[RING_SIZE];
+static uint64_t head; /**< Number of events ever recorded */
+static char dump_path[MAX_PATH_LENGTH];
+
+void flight_recorder_record (flight_event_t event, uint64_t frame,
+                             int32_t result, uint32_t a, uint32_t b,
+                             uint32_t c)
+{
+    flight_record_t *record = &records[head & (RING_SIZE - 1)];
+    record->time_ns = timer_now_ns ();
+    record->frame = frame;
+    record->event = event;
+    record->result = result;
+    record->args[0] = a;
+    record->args[1] = b;
+    record->args[2] = c;
+    head++;
+}
+
+/** Line being formatted, snprintf is not async-signal-safe */
+typedef struct line_t {
+    char text[MAX_LINE_LENGTH];
+    size_t length;
+} line_t;
+
+static void append_string (line_t *line, const char *string)
+{
+    while (*string != '\0' && line->length < sizeof (line->text)) {
+        line->text[line->length++] = *string++;
+    }
+}
+
+static void append_uint (line_t *line, uint64_t value)
+{
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0 && line->length < sizeof (line->text)) {
+        line->text[line->length++] = digits[--count];
+    }
+}
+
+static void append_int (line_t *line, int64_t value)
+{
+    if (value < 0) {
+        append_string (line, "-");
+        append_uint (line, (uint64_t)(-(value + 1)) + 1);
+    } else {
+        append_uint (line, (uint64_t)value);
+    }
+}
+
+/** Format record as "time_us frame N event result=R arg=V..." */
+static void format_record (line_t *line, const flight_record_t *record,
+                           uint64_t base_ns)
+{
+    const char *const *names = event_names[record->event];
+    line->length = 0;
+    append_uint (line, (record->time_ns - base_ns) / 1000);
+    append_string (line, "us frame ");
+    append_uint (line, record->frame);
+    append_string (line, " ");
+    append_string (line, names[0]);
+    append_string (line, " result=");
+    append_int (line, record->result);
+    for (int i = 0; i < 3; i++) {
+        if (names[i + 1] != NULL) {
+            append_string (line, " ");
+            append_string (line, names[i + 1]);
+            append_string (line, "=");
+            append_uint (line, record->args[i]);
+        }
+    }
+    append_string (line, "\n");
+}
+
+static int write_all (int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t written = write (fd, data, size);
+        if (written <= 0) {
+            return -1;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+int flight_recorder_dump (void)
+{
+    static const char header[] =
+        "# vkbootstrap flight recorder, time is relative to oldest event\n";
+    const uint64_t last = head;
+    const uint64_t first = last > RING_SIZE ? last - RING_SIZE : 0;
+    line_t line;
+    int error = 0;
+    int fd = -1;
+    if (dump_path[0] == '\0') {
+        return -1;
+    }
+    fd = open (dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    error = write_all (fd, header, sizeof (header) - 1);
+    for (uint64_t i = first; i < last && error == 0; i++) {
+        const flight_record_t *record = &records[i & (RING_SIZE - 1)];
+        if (record->event >= FLIGHT_EVENT_COUNT) {
+            continue;
+        }
+        format_record (&line, record, records[first & (RING_SIZE - 1)].time_ns);
+        error = write_all (fd, line.text, line.length);
+    }
+    error = close (fd) != 0 || error != 0;
+    return error ? -1 : 0;
+}
+
+static void handle_fatal_signal (int signal_number)
+{
+    static const char message[] = "fatal signal, flight recorder written to ";
+    if (flight_recorder_dump () == 0) {
+        write_all (STDERR_FILENO, message, sizeof (message) - 1);
+        write_all (STDERR_FILENO, dump_path, strlen (dump_path));
+        write_all (STDERR_FILENO, "\n", 1);
+    }
+    /* Handler was reset, so signal terminates process as usual */
+    raise (signal_number);
+}
+
+int flight_recorder_init (const char *path)
+{
+    struct sigaction action;
+    if (strlen (path) >= sizeof (dump_path)) {
+        return -1;
+    }
+    strcpy (dump_path, path);
+    memset (&action, 0, sizeof (action));
+    action.sa_handler = handle_fatal_signal;
+    action.sa_flags = (int)SA_RESETHAND;
+    sigemptyset (&action.sa_mask);
+    for (size_t i = 0; i < sizeof (fatal_signals) / sizeof (fatal_signals[0]);
+            i++) {
+        if (sigaction (fatal_signals[i], &action, NULL) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+const char *flight_recorder_path (void)
+{
+    return dump_path;
+}
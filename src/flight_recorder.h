@@ -0,0 +1,52 @@
+/**
+ * @file flight_recorder.h
+ * Ring of recent frame events dumped to file when something goes wrong.
+ *
+ * Events are kept in static memory, so recording never allocates and the
+ * ring can be dumped from signal handler. Only one thread may record.
+ */
+#ifndef VKBOOTSTRAP_FLIGHT_RECORDER_H
+#define VKBOOTSTRAP_FLIGHT_RECORDER_H
+#include <stdint.h>
+
+/** Kind of recorded event, arguments of each are listed in comments */
+typedef enum flight_event_t {
+    FLIGHT_EVENT_FRAME = 0, /**< cpu_us, wait_us */
+    FLIGHT_EVENT_GPU_FRAME, /**< gpu_us, passes */
+    FLIGHT_EVENT_ACQUIRE, /**< image */
+    FLIGHT_EVENT_SUBMIT, /**< frame_index */
+    FLIGHT_EVENT_PRESENT, /**< image */
+    FLIGHT_EVENT_SWAPCHAIN, /**< width, height, images */
+    FLIGHT_EVENT_ERROR, /**< line */
+    FLIGHT_EVENT_COUNT
+} flight_event_t;
+
+/** Set file to dump to and install handlers of fatal signals
+ * @param path file that flight_recorder_dump() writes
+ * @returns 0 on success, -1 if path is too long or handlers can't be set
+ */
+int flight_recorder_init (const char *path);
+
+/** Record event, takes no locks and never allocates
+ * @param event kind of event
+ * @param frame number of frame the event belongs to
+ * @param result VkResult of operation, VK_SUCCESS if there is none
+ * @param a first argument of event
+ * @param b second argument of event
+ * @param c third argument of event
+ */
+void flight_recorder_record (flight_event_t event, uint64_t frame,
+                             int32_t result, uint32_t a, uint32_t b,
+                             uint32_t c);
+
+/** Write recorded events to file, oldest first
+ *
+ * Is async-signal-safe.
+ * @returns 0 on success, -1 if recorder isn't initialized or write failed
+ */
+int flight_recorder_dump (void);
+
+/** Get file that flight_recorder_dump() writes */
+const char *flight_recorder_path (void);
+
+#endif
@@ -0,0 +1,328 @@
+/**
+ * @file gpu_profiler.c
+ * Ring of timestamp query pools, one per frame in flight.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "gpu_profiler.h"
+
+/* Query 0 and 1 are frame begin and end, then begin/end pair per pass */
+#define FRAME_BEGIN_QUERY 0
+#define FRAME_END_QUERY 1
+#define PASS_QUERY(pass) (2 + 2 * (pass))
+#define QUERY_COUNT PASS_QUERY (GPU_PROFILER_MAX_PASSES)
+
+/* Number of bits in GPU_PROFILER_PIPELINE_STATISTICS */
+#define PIPELINE_STATISTICS_COUNT 4
+
+/** Queries of a single frame in flight */
+typedef struct gpu_profiler_frame_t {
+    VkQueryPool pool;
+    VkQueryPool statistics_pool; /**< One query per pass, or VK_NULL_HANDLE */
+    uint64_t frame_number; /**< Number of frame recorded to this pool */
+    uint32_t pass_count; /**< Number of passes recorded to this pool */
+    int is_recorded; /**< true if results are not collected yet */
+    const char *pass_names[GPU_PROFILER_MAX_PASSES];
+} gpu_profiler_frame_t;
+
+struct gpu_profiler_t {
+    VkDevice device;
+    double period_ms; /**< Milliseconds per timestamp tick */
+    uint64_t valid_mask; /**< Mask of valid bits in timestamp value */
+    uint32_t frame_count;
+    uint32_t current; /**< Index of frame being recorded */
+    gpu_profiler_frame_t frames[GPU_PROFILER_MAX_FRAMES];
+    /* Accumulated statistics */
+    uint64_t collected_frames;
+    double total_frame_ms;
+    uint32_t stats_pass_count;
+    int has_statistics; /**< true if pipeline statistics are collected */
+    const char *stats_pass_names[GPU_PROFILER_MAX_PASSES];
+    double total_pass_ms[GPU_PROFILER_MAX_PASSES];
+    uint64_t pass_samples[GPU_PROFILER_MAX_PASSES];
+    gpu_pipeline_statistics_t total_statistics[GPU_PROFILER_MAX_PASSES];
+};
+
+VkResult gpu_profiler_create (VkPhysicalDevice physicalDevice,
+                              VkDevice device,
+                              const VkPhysicalDeviceProperties *properties,
+                              uint32_t queueFamilyIndex, uint32_t frame_count,
+                              int pipeline_statistics,
+                              gpu_profiler_t **pProfiler)
+{
+    VkQueueFamilyProperties families[MAX_QUEUE_FAMILY_PROPERTIES];
+    uint32_t familyCount = MAX_QUEUE_FAMILY_PROPERTIES;
+    uint32_t validBits = 0;
+    gpu_profiler_t *profiler = NULL;
+    VkResult result = VK_SUCCESS;
+    const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = QUERY_COUNT,
+        .pipelineStatistics = 0,
+    };
+    const VkQueryPoolCreateInfo statisticsPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = GPU_PROFILER_MAX_PASSES,
+        .pipelineStatistics = GPU_PROFILER_PIPELINE_STATISTICS,
+    };
+    *pProfiler = NULL;
+    vkGetPhysicalDeviceQueueFamilyProperties (physicalDevice, &familyCount,
+            families);
+    if (familyCount > queueFamilyIndex) {
+        validBits = families[queueFamilyIndex].timestampValidBits;
+    }
+    if (validBits == 0 || frame_count > GPU_PROFILER_MAX_FRAMES) {
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+    profiler = (gpu_profiler_t *)calloc (1, sizeof (gpu_profiler_t));
+    if (profiler == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    profiler->device = device;
+    profiler->period_ms = (double)properties->limits.timestampPeriod / 1e6;
+    profiler->valid_mask = validBits >= 64 ? UINT64_MAX
+                           : (((uint64_t)1 << validBits) - 1);
+    profiler->frame_count = frame_count;
+    profiler->has_statistics = pipeline_statistics;
+    for (uint32_t i = 0; i < frame_count; i++) {
+        result = vkCreateQueryPool (device, &queryPoolCreateInfo, NULL,
+                                    &profiler->frames[i].pool);
+        if (result == VK_SUCCESS && pipeline_statistics) {
+            result = vkCreateQueryPool (device, &statisticsPoolCreateInfo, NULL,
+                                        &profiler->frames[i].statistics_pool);
+        }
+        if (result != VK_SUCCESS) {
+            gpu_profiler_destroy (profiler);
+            return result;
+        }
+    }
+    *pProfiler = profiler;
+    return VK_SUCCESS;
+}
+
+void gpu_profiler_destroy (gpu_profiler_t *profiler)
+{
+    if (profiler != NULL) {
+        for (uint32_t i = 0; i < profiler->frame_count; i++) {
+            vkDestroyQueryPool (profiler->device, profiler->frames[i].pool, NULL);
+            vkDestroyQueryPool (profiler->device,
+                                profiler->frames[i].statistics_pool, NULL);
+        }
+        free (profiler);
+    }
+}
+
+void gpu_profiler_begin_frame (gpu_profiler_t *profiler, VkCommandBuffer cmd,
+                               uint32_t frame_index, uint64_t frame_number)
+{
+    gpu_profiler_frame_t *frame = NULL;
+    if (profiler == NULL) {
+        return;
+    }
+    profiler->current = frame_index;
+    frame = &profiler->frames[frame_index];
+    frame->frame_number = frame_number;
+    frame->pass_count = 0;
+    frame->is_recorded = 0;
+    vkCmdResetQueryPool (cmd, frame->pool, 0, QUERY_COUNT);
+    if (profiler->has_statistics) {
+        vkCmdResetQueryPool (cmd, frame->statistics_pool, 0,
+                             GPU_PROFILER_MAX_PASSES);
+    }
+    vkCmdWriteTimestamp (cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame->pool,
+                         FRAME_BEGIN_QUERY);
+}
+
+uint32_t gpu_profiler_begin_pass (gpu_profiler_t *profiler, VkCommandBuffer cmd,
+                                  const char *name)
+{
+    gpu_profiler_frame_t *frame = NULL;
+    uint32_t pass = 0;
+    if (profiler == NULL) {
+        return GPU_PROFILER_MAX_PASSES;
+    }
+    frame = &profiler->frames[profiler->current];
+    if (frame->pass_count == GPU_PROFILER_MAX_PASSES) {
+        return GPU_PROFILER_MAX_PASSES;
+    }
+    pass = frame->pass_count++;
+    frame->pass_names[pass] = name;
+    vkCmdWriteTimestamp (cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame->pool,
+                         PASS_QUERY (pass));
+    if (profiler->has_statistics) {
+        vkCmdBeginQuery (cmd, frame->statistics_pool, pass, 0);
+    }
+    return pass;
+}
+
+void gpu_profiler_end_pass (gpu_profiler_t *profiler, VkCommandBuffer cmd,
+                            uint32_t pass)
+{
+    gpu_profiler_frame_t *frame = NULL;
+    if (profiler == NULL || pass >= GPU_PROFILER_MAX_PASSES) {
+        return;
+    }
+    frame = &profiler->frames[profiler->current];
+    if (profiler->has_statistics) {
+        vkCmdEndQuery (cmd, frame->statistics_pool, pass);
+    }
+    vkCmdWriteTimestamp (cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame->pool,
+                         PASS_QUERY (pass) + 1);
+}
+
+void gpu_profiler_end_frame (gpu_profiler_t *profiler, VkCommandBuffer cmd)
+{
+    gpu_profiler_frame_t *frame = NULL;
+    if (profiler == NULL) {
+        return;
+    }
+    frame = &profiler->frames[profiler->current];
+    vkCmdWriteTimestamp (cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame->pool,
+                         FRAME_END_QUERY);
+    frame->is_recorded = 1;
+}
+
+/** Convert difference between two raw timestamps to milliseconds */
+static double ticks_to_ms (const gpu_profiler_t *profiler, uint64_t begin,
+                           uint64_t end)
+{
+    return (double)((end - begin) & profiler->valid_mask) * profiler->period_ms;
+}
+
+/** Add frame timings to accumulated statistics */
+static void accumulate_stats (gpu_profiler_t *profiler,
+                              const gpu_frame_timings_t *timings)
+{
+    profiler->collected_frames++;
+    profiler->total_frame_ms += timings->frame_ms;
+    for (uint32_t i = 0; i < timings->pass_count; i++) {
+        if (i >= profiler->stats_pass_count) {
+            profiler->stats_pass_names[i] = timings->pass_names[i];
+            profiler->stats_pass_count = i + 1;
+        }
+        profiler->total_pass_ms[i] += timings->pass_ms[i];
+        profiler->pass_samples[i]++;
+        if (timings->has_statistics) {
+            const gpu_pipeline_statistics_t *pass = &timings->pass_statistics[i];
+            gpu_pipeline_statistics_t *total = &profiler->total_statistics[i];
+            total->vertex_invocations += pass->vertex_invocations;
+            total->clipping_primitives += pass->clipping_primitives;
+            total->fragment_invocations += pass->fragment_invocations;
+            total->compute_invocations += pass->compute_invocations;
+        }
+    }
+}
+
+/** Read pipeline statistics of all passes of the frame
+ * @returns VK_NOT_READY if results are not available yet
+ */
+static VkResult collect_statistics (const gpu_profiler_t *profiler,
+                                    const gpu_profiler_frame_t *frame,
+                                    gpu_frame_timings_t *timings)
+{
+    uint64_t values[GPU_PROFILER_MAX_PASSES][PIPELINE_STATISTICS_COUNT];
+    VkResult result = VK_SUCCESS;
+    if (frame->pass_count == 0) {
+        return VK_SUCCESS;
+    }
+    result = vkGetQueryPoolResults (profiler->device, frame->statistics_pool, 0,
+                                    frame->pass_count, sizeof (values), values,
+                                    sizeof (values[0]), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t i = 0; i < frame->pass_count; i++) {
+        timings->pass_statistics[i].vertex_invocations = values[i][0];
+        timings->pass_statistics[i].clipping_primitives = values[i][1];
+        timings->pass_statistics[i].fragment_invocations = values[i][2];
+        timings->pass_statistics[i].compute_invocations = values[i][3];
+    }
+    return VK_SUCCESS;
+}
+
+int gpu_profiler_collect (gpu_profiler_t *profiler, uint32_t frame_index,
+                          gpu_frame_timings_t *timings)
+{
+    gpu_profiler_frame_t *frame = NULL;
+    uint64_t values[QUERY_COUNT];
+    uint32_t queryCount = 0;
+    VkResult result = VK_SUCCESS;
+    if (profiler == NULL) {
+        return 0;
+    }
+    frame = &profiler->frames[frame_index];
+    if (!frame->is_recorded) {
+        return 0;
+    }
+    queryCount = PASS_QUERY (frame->pass_count);
+    /* No VK_QUERY_RESULT_WAIT_BIT: the frame's fence has already signalled */
+    result = vkGetQueryPoolResults (profiler->device, frame->pool, 0, queryCount,
+                                    sizeof (values), values, sizeof (uint64_t),
+                                    VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return 0;
+    }
+    timings->has_statistics = profiler->has_statistics;
+    if (profiler->has_statistics) {
+        result = collect_statistics (profiler, frame, timings);
+        if (result != VK_SUCCESS) {
+            return 0;
+        }
+    }
+    frame->is_recorded = 0;
+    timings->frame_number = frame->frame_number;
+    timings->frame_begin = values[FRAME_BEGIN_QUERY];
+    timings->frame_end = values[FRAME_END_QUERY];
+    timings->frame_ms = ticks_to_ms (profiler, values[FRAME_BEGIN_QUERY],
+                                     values[FRAME_END_QUERY]);
+    timings->pass_count = frame->pass_count;
+    for (uint32_t i = 0; i < frame->pass_count; i++) {
+        timings->pass_names[i] = frame->pass_names[i];
+        timings->pass_begin[i] = values[PASS_QUERY (i)];
+        timings->pass_end[i] = values[PASS_QUERY (i) + 1];
+        timings->pass_ms[i] = ticks_to_ms (profiler, timings->pass_begin[i],
+                                           timings->pass_end[i]);
+        timings->pass_start_ms[i] = ticks_to_ms (profiler, timings->frame_begin,
+                                    timings->pass_begin[i]);
+    }
+    accumulate_stats (profiler, timings);
+    return 1;
+}
+
+void gpu_profiler_print_stats (const gpu_profiler_t *profiler)
+{
+    if (profiler == NULL || profiler->collected_frames == 0) {
+        return;
+    }
+    printf ("GPU timings over %llu frames\n",
+            (unsigned long long)profiler->collected_frames);
+    printf ("  %-16s %8.3f ms\n", "frame",
+            profiler->total_frame_ms / (double)profiler->collected_frames);
+    for (uint32_t i = 0; i < profiler->stats_pass_count; i++) {
+        const double samples = (double)profiler->pass_samples[i];
+        const gpu_pipeline_statistics_t *total = &profiler->total_statistics[i];
+        printf ("  %-16s %8.3f ms\n", profiler->stats_pass_names[i],
+                profiler->total_pass_ms[i] / samples);
+        if (profiler->has_statistics) {
+            printf ("    vertex invocations:   %.0f\n"
+                    "    clipping primitives:  %.0f\n"
+                    "    fragment invocations: %.0f\n"
+                    "    compute invocations:  %.0f\n",
+                    (double)total->vertex_invocations / samples,
+                    (double)total->clipping_primitives / samples,
+                    (double)total->fragment_invocations / samples,
+                    (double)total->compute_invocations / samples);
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file gpu_profiler.h
+ * GPU timing of render passes using timestamp queries.
+ */
+#ifndef VKBOOTSTRAP_GPU_PROFILER_H
+#define VKBOOTSTRAP_GPU_PROFILER_H
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+/** Maximum number of passes that can be timed in one frame */
+#define GPU_PROFILER_MAX_PASSES 16
+
+/** Maximum number of frames that can be in flight at once */
+#define GPU_PROFILER_MAX_FRAMES 4
+
+/** Statistics counted by queries of passes, secondary command buffers
+ * executed inside a pass must inherit them.
+ * Order of these bits defines order of values in query results.
+ */
+#define GPU_PROFILER_PIPELINE_STATISTICS \
+    (VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT \
+     | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT \
+     | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT \
+     | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT)
+
+/** Pipeline statistics of one pass */
+typedef struct gpu_pipeline_statistics_t {
+    uint64_t vertex_invocations; /**< Vertex shader invocations */
+    uint64_t clipping_primitives; /**< Primitives output by clipping stage */
+    uint64_t fragment_invocations; /**< Fragment shader invocations */
+    uint64_t compute_invocations; /**< Compute shader invocations */
+} gpu_pipeline_statistics_t;
+
+/** GPU timings of one completed frame */
+typedef struct gpu_frame_timings_t {
+    uint64_t frame_number; /**< Number of frame these timings belong to */
+    uint64_t frame_begin; /**< Raw timestamp at the start of the frame */
+    uint64_t frame_end; /**< Raw timestamp at the end of the frame */
+    double frame_ms; /**< Time between start and end of the frame */
+    uint32_t pass_count; /**< Number of passes recorded in the frame */
+    int has_statistics; /**< true if pass_statistics are filled */
+    const char *pass_names[GPU_PROFILER_MAX_PASSES]; /**< Name of each pass */
+    uint64_t pass_begin[GPU_PROFILER_MAX_PASSES]; /**< Raw start of each pass */
+    uint64_t pass_end[GPU_PROFILER_MAX_PASSES]; /**< Raw end of each pass */
+    double pass_ms[GPU_PROFILER_MAX_PASSES]; /**< Duration of each pass */
+    /** Start of each pass relative to start of the frame */
+    double pass_start_ms[GPU_PROFILER_MAX_PASSES];
+    /** Pipeline statistics of each pass */
+    gpu_pipeline_statistics_t pass_statistics[GPU_PROFILER_MAX_PASSES];
+} gpu_frame_timings_t;
+
+typedef struct gpu_profiler_t gpu_profiler_t;
+
+/** Create profiler with one query pool per frame in flight
+ * @param physicalDevice device the queries will be executed on
+ * @param device logical device to create query pools on
+ * @param properties properties of @a physicalDevice
+ * @param queueFamilyIndex family of queue the frames are submitted to
+ * @param frame_count number of frames in flight
+ * @param pipeline_statistics non-zero to also collect pipeline statistics,
+ *        requires pipelineStatisticsQuery feature to be enabled on @a device
+ * @param pProfiler new profiler object
+ * @returns VK_ERROR_FEATURE_NOT_PRESENT if queue can't write timestamps
+ */
+VkResult gpu_profiler_create (VkPhysicalDevice physicalDevice,
+                              VkDevice device,
+                              const VkPhysicalDeviceProperties *properties,
+                              uint32_t queueFamilyIndex, uint32_t frame_count,
+                              int pipeline_statistics,
+                              gpu_profiler_t **pProfiler);
+
+/** Destroy profiler and its query pools
+ * @param profiler profiler to destroy, can be NULL
+ */
+void gpu_profiler_destroy (gpu_profiler_t *profiler);
+
+/** Reset frame's queries and write the frame start timestamp
+ * @param profiler target profiler, can be NULL
+ * @param cmd command buffer of the frame
+ * @param frame_index index of frame in flight
+ * @param frame_number monotonically increasing number of the frame
+ */
+void gpu_profiler_begin_frame (gpu_profiler_t *profiler, VkCommandBuffer cmd,
+                               uint32_t frame_index, uint64_t frame_number);
+
+/** Write timestamp at the start of a pass
+ *
+ * Passes must not be nested and must begin and end outside of render pass
+ * instance when pipeline statistics are collected.
+ * @param profiler target profiler, can be NULL
+ * @param cmd command buffer of the frame
+ * @param name static name of the pass
+ * @returns index of the pass to pass to gpu_profiler_end_pass()
+ */
+uint32_t gpu_profiler_begin_pass (gpu_profiler_t *profiler, VkCommandBuffer cmd,
+                                  const char *name);
+
+/** Write timestamp at the end of a pass
+ * @param profiler target profiler, can be NULL
+ * @param cmd command buffer of the frame
+ * @param pass index returned by gpu_profiler_begin_pass()
+ */
+void gpu_profiler_end_pass (gpu_profiler_t *profiler, VkCommandBuffer cmd,
+                            uint32_t pass);
+
+/** Write the frame end timestamp
+ * @param profiler target profiler, can be NULL
+ * @param cmd command buffer of the frame
+ */
+void gpu_profiler_end_frame (gpu_profiler_t *profiler, VkCommandBuffer cmd);
+
+/** Read back timings of the frame previously recorded at @a frame_index
+ *
+ * Must be called only after the fence of that frame has signalled, so the
+ * read never waits on the GPU.
+ * @param profiler target profiler, can be NULL
+ * @param frame_index index of frame in flight
+ * @param timings receives the timings
+ * @returns non-zero if @a timings were filled, 0 otherwise
+ */
+int gpu_profiler_collect (gpu_profiler_t *profiler, uint32_t frame_index,
+                          gpu_frame_timings_t *timings);
+
+/** Print average time of each pass over all collected frames
+ * @param profiler target profiler, can be NULL
+ */
+void gpu_profiler_print_stats (const gpu_profiler_t *profiler);
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file input_queue.c
+ * Ring buffer indexed by free running counters of pushed and popped events.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "input_queue.h"
+
+/** Indexes of producer and consumer are kept on separate cache lines */
+#define CACHE_LINE_SIZE 64
+
+struct input_queue_t {
+    /** Number of events ever pushed, written by producer */
+    atomic_uint_fast64_t tail;
+    /** Copy of head seen by producer, it is reloaded only if queue looks
+     * full, so producer rarely touches cache line of consumer */
+    uint64_t cached_head;
+    atomic_uint_fast64_t dropped;
+    char producer_padding[CACHE_LINE_SIZE];
+    /** Number of events ever popped, written by consumer */
+    atomic_uint_fast64_t head;
+    /** Copy of tail seen by consumer */
+    uint64_t cached_tail;
+    char consumer_padding[CACHE_LINE_SIZE];
+    input_event_t events[INPUT_QUEUE_CAPACITY];
+};
+
+input_queue_t *input_queue_create (void)
+{
+    input_queue_t *queue = (input_queue_t *)calloc (1, sizeof (input_queue_t));
+    if (queue != NULL) {
+        atomic_init (&queue->tail, 0);
+        atomic_init (&queue->dropped, 0);
+        atomic_init (&queue->head, 0);
+    }
+    return queue;
+}
+
+void input_queue_destroy (input_queue_t *queue)
+{
+    free (queue);
+}
+
+int input_queue_push (input_queue_t *queue, const input_event_t *event)
+{
+    const uint_fast64_t tail = atomic_load_explicit (&queue->tail,
+                               memory_order_relaxed);
+    if (tail - queue->cached_head == INPUT_QUEUE_CAPACITY) {
+        queue->cached_head = atomic_load_explicit (&queue->head,
+                             memory_order_acquire);
+        if (tail - queue->cached_head == INPUT_QUEUE_CAPACITY) {
+            atomic_fetch_add_explicit (&queue->dropped, 1,
+                                       memory_order_relaxed);
+            return -1;
+        }
+    }
+    queue->events[tail & (INPUT_QUEUE_CAPACITY - 1)] = *event;
+    /* Event is written before consumer can see new tail */
+    atomic_store_explicit (&queue->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+int input_queue_pop (input_queue_t *queue, input_event_t *event)
+{
+    const uint_fast64_t head = atomic_load_explicit (&queue->head,
+                               memory_order_relaxed);
+    if (head == queue->cached_tail) {
+        queue->cached_tail = atomic_load_explicit (&queue->tail,
+                             memory_order_acquire);
+        if (head == queue->cached_tail) {
+            return 0;
+        }
+    }
+    *event = queue->events[head & (INPUT_QUEUE_CAPACITY - 1)];
+    /* Slot is read before producer can reuse it */
+    atomic_store_explicit (&queue->head, head + 1, memory_order_release);
+    return 1;
+}
+
+uint64_t input_queue_get_dropped (const input_queue_t *queue)
+{
+    return atomic_load_explicit (&queue->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file input_queue.h
+ * Lock-free single producer, single consumer queue of timestamped input.
+ *
+ * Thread processing X events pushes, thread running simulation pops. Each
+ * side writes only its own index, so neither of them ever waits. Changes
+ * of window state go through the same queue, so they are seen in order
+ * with input.
+ */
+#ifndef VKBOOTSTRAP_INPUT_QUEUE_H
+#define VKBOOTSTRAP_INPUT_QUEUE_H
+#include <stdint.h>
+
+/** Number of events queue can hold, must be power of two */
+#define INPUT_QUEUE_CAPACITY 256
+
+typedef enum input_event_type_t {
+    INPUT_EVENT_KEY_PRESS,
+    INPUT_EVENT_KEY_RELEASE,
+    INPUT_EVENT_BUTTON_PRESS,
+    INPUT_EVENT_BUTTON_RELEASE,
+    INPUT_EVENT_MOTION, /**< Pointer position in window coordinates */
+    INPUT_EVENT_RAW_MOTION, /**< Unaccelerated device motion from XInput2 */
+    INPUT_EVENT_RESIZE, /**< Window configured, new size in x and y */
+    INPUT_EVENT_CLOSE, /**< Window manager asked to close window */
+    INPUT_EVENT_MAP, /**< Detail is non-zero if window got mapped */
+    INPUT_EVENT_VISIBILITY, /**< Detail is state from VisibilityNotify */
+    INPUT_EVENT_SYNC_REQUEST, /**< Frame of next size must set counter */
+} input_event_type_t;
+
+typedef struct input_event_t {
+    input_event_type_t type;
+    uint32_t detail; /**< Keycode or button, 0 for motion */
+    uint32_t server_time; /**< X server timestamp in milliseconds */
+    float x; /**< Position, or motion along first axis for raw motion */
+    float y; /**< Position, or motion along second axis for raw motion */
+    uint64_t local_ns; /**< Time event was received, see timer_now_ns() */
+    int64_t value; /**< Counter value of INPUT_EVENT_SYNC_REQUEST */
+} input_event_t;
+
+typedef struct input_queue_t input_queue_t;
+
+/** Create empty queue
+ * @returns new queue, NULL if out of memory
+ */
+input_queue_t *input_queue_create (void);
+
+/** Free queue
+ * @param queue queue to free, can be NULL
+ */
+void input_queue_destroy (input_queue_t *queue);
+
+/** Add event, called only by producer thread
+ * @param queue target queue
+ * @param event event to copy into queue
+ * @returns 0 on success, -1 if queue is full and event is dropped
+ */
+int input_queue_push (input_queue_t *queue, const input_event_t *event);
+
+/** Take oldest event, called only by consumer thread
+ * @param queue source queue
+ * @param event receives the event
+ * @returns non-zero if event is taken, 0 if queue is empty
+ */
+int input_queue_pop (input_queue_t *queue, input_event_t *event);
+
+/** Get number of events dropped because queue was full */
+uint64_t input_queue_get_dropped (const input_queue_t *queue);
+
+#endif
@@ -0,0 +1,275 @@
+/**
+ * @file live_metrics.c
+ * Seqlock protected segment of POSIX shared memory.
+ */
+#define _POSIX_C_SOURCE 200809L
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "live_metrics.h"
+#include "timer.h"
+
+#define SEGMENT_NAME_FORMAT "/vkbootstrap.%d"
+#define MAX_SEGMENT_NAME 64
+
+/** Weight of new value in exponential averages */
+#define AVERAGE_WEIGHT 0.1
+
+/** Resident memory is read from /proc once per this many nanoseconds */
+#define RESIDENT_UPDATE_NS 1000000000ull
+
+/** Number of times reader retries copy before giving up */
+#define MAX_READ_ATTEMPTS 100
+
+/** Layout of segment, see live_metrics.h */
+typedef struct live_metrics_segment_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    int32_t pid;
+    atomic_uint sequence; /**< Odd while data is being written */
+    uint32_t padding;
+    live_metrics_data_t data;
+} live_metrics_segment_t;
+
+_Static_assert (sizeof (atomic_uint) == sizeof (uint32_t),
+                "sequence must be 32-bit to keep layout of segment");
+
+struct live_metrics_t {
+    char name[MAX_SEGMENT_NAME];
+    live_metrics_segment_t *segment;
+    live_metrics_data_t data; /**< Private copy updated before publishing */
+    uint64_t last_present_ns;
+    uint64_t last_resident_ns; /**< Time resident memory was read */
+    int statm; /**< Descriptor of /proc/self/statm, -1 if not available */
+};
+
+struct live_metrics_reader_t {
+    live_metrics_segment_t *segment; /**< Mapped read-only */
+};
+
+live_metrics_t *live_metrics_create (void)
+{
+    live_metrics_t *metrics = (live_metrics_t *)calloc (1,
+                              sizeof (live_metrics_t));
+    live_metrics_segment_t *segment = NULL;
+    void *address = MAP_FAILED;
+    int fd = -1;
+    if (metrics == NULL) {
+        return NULL;
+    }
+    snprintf (metrics->name, sizeof (metrics->name), SEGMENT_NAME_FORMAT,
+              (int)getpid ());
+    fd = shm_open (metrics->name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        free (metrics);
+        return NULL;
+    }
+    if (ftruncate (fd, sizeof (live_metrics_segment_t)) == 0) {
+        address = mmap (NULL, sizeof (live_metrics_segment_t),
+                        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close (fd);
+    if (address == MAP_FAILED) {
+        shm_unlink (metrics->name);
+        free (metrics);
+        return NULL;
+    }
+    segment = (live_metrics_segment_t *)address;
+    segment->version = LIVE_METRICS_VERSION;
+    segment->size = sizeof (live_metrics_data_t);
+    segment->pid = (int32_t)getpid ();
+    atomic_store (&segment->sequence, 0);
+    segment->magic = LIVE_METRICS_MAGIC;
+    metrics->segment = segment;
+    metrics->statm = open ("/proc/self/statm", O_RDONLY);
+    strcpy (metrics->data.present_mode, "unknown");
+    return metrics;
+}
+
+void live_metrics_destroy (live_metrics_t *metrics)
+{
+    if (metrics == NULL) {
+        return;
+    }
+    if (metrics->statm >= 0) {
+        close (metrics->statm);
+    }
+    munmap (metrics->segment, sizeof (live_metrics_segment_t));
+    shm_unlink (metrics->name);
+    free (metrics);
+}
+
+void live_metrics_set_swapchain (live_metrics_t *metrics,
+                                 const char *present_mode, uint32_t width,
+                                 uint32_t height, uint32_t image_count)
+{
+    if (metrics == NULL) {
+        return;
+    }
+    snprintf (metrics->data.present_mode, sizeof (metrics->data.present_mode),
+              "%s", present_mode);
+    metrics->data.width = width;
+    metrics->data.height = height;
+    metrics->data.image_count = image_count;
+}
+
+/** Update exponential average, first value initializes it */
+static double update_average (double current, double value)
+{
+    return current <= 0.0 ? value
+           : current + AVERAGE_WEIGHT * (value - current);
+}
+
+void live_metrics_add_gpu_frame (live_metrics_t *metrics, double gpu_ms)
+{
+    if (metrics == NULL) {
+        return;
+    }
+    metrics->data.gpu_frame_ms = gpu_ms;
+    metrics->data.gpu_frame_ms_avg =
+        update_average (metrics->data.gpu_frame_ms_avg, gpu_ms);
+}
+
+void live_metrics_add_input (live_metrics_t *metrics, double latency_ms)
+{
+    if (metrics == NULL) {
+        return;
+    }
+    metrics->data.input_latency_ms_avg =
+        update_average (metrics->data.input_latency_ms_avg, latency_ms);
+}
+
+/** Read resident set size, see proc(5) */
+static uint64_t read_resident_bytes (int statm)
+{
+    char buffer[128];
+    unsigned long pages = 0;
+    const ssize_t size = pread (statm, buffer, sizeof (buffer) - 1, 0);
+    if (size <= 0) {
+        return 0;
+    }
+    buffer[size] = '\0';
+    if (sscanf (buffer, "%*u %lu", &pages) != 1) {
+        return 0;
+    }
+    return (uint64_t)pages * (uint64_t)sysconf (_SC_PAGESIZE);
+}
+
+/** Copy private data to segment, never waits for readers */
+static void publish (live_metrics_t *metrics)
+{
+    live_metrics_segment_t *segment = metrics->segment;
+    const unsigned sequence = atomic_load_explicit (&segment->sequence,
+                              memory_order_relaxed);
+    atomic_store_explicit (&segment->sequence, sequence + 1,
+                           memory_order_relaxed);
+    atomic_thread_fence (memory_order_release);
+    memcpy (&segment->data, &metrics->data, sizeof (segment->data));
+    atomic_store_explicit (&segment->sequence, sequence + 2,
+                           memory_order_release);
+}
+
+void live_metrics_end_frame (live_metrics_t *metrics, double cpu_ms,
+                             uint64_t present_ns)
+{
+    live_metrics_data_t *data = NULL;
+    if (metrics == NULL) {
+        return;
+    }
+    data = &metrics->data;
+    if (metrics->last_present_ns != 0) {
+        const double interval = timer_elapsed_ms (metrics->last_present_ns,
+                                present_ns);
+        if (data->present_interval_ms_avg > 0.0
+                && interval > 2.0 * data->present_interval_ms_avg) {
+            data->dropped_frames++;
+        }
+        data->present_interval_ms_avg =
+            update_average (data->present_interval_ms_avg, interval);
+    }
+    metrics->last_present_ns = present_ns;
+    if (metrics->statm >= 0
+            && present_ns - metrics->last_resident_ns >= RESIDENT_UPDATE_NS) {
+        data->resident_bytes = read_resident_bytes (metrics->statm);
+        metrics->last_resident_ns = present_ns;
+    }
+    data->frame_number++;
+    data->update_ns = present_ns;
+    data->cpu_frame_ms = cpu_ms;
+    data->cpu_frame_ms_avg = update_average (data->cpu_frame_ms_avg, cpu_ms);
+    publish (metrics);
+}
+
+live_metrics_reader_t *live_metrics_open (int pid)
+{
+    char name[MAX_SEGMENT_NAME];
+    struct stat status;
+    live_metrics_reader_t *reader = NULL;
+    live_metrics_segment_t *segment = NULL;
+    void *address = MAP_FAILED;
+    int fd = -1;
+    snprintf (name, sizeof (name), SEGMENT_NAME_FORMAT, pid);
+    fd = shm_open (name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat (fd, &status) == 0
+            && (size_t)status.st_size >= sizeof (live_metrics_segment_t)) {
+        address = mmap (NULL, sizeof (live_metrics_segment_t), PROT_READ,
+                        MAP_SHARED, fd, 0);
+    }
+    close (fd);
+    if (address == MAP_FAILED) {
+        return NULL;
+    }
+    segment = (live_metrics_segment_t *)address;
+    if (segment->magic != LIVE_METRICS_MAGIC
+            || segment->version != LIVE_METRICS_VERSION
+            || segment->size != sizeof (live_metrics_data_t)
+            || (reader = (live_metrics_reader_t *)malloc (
+                             sizeof (live_metrics_reader_t))) == NULL) {
+        munmap (address, sizeof (live_metrics_segment_t));
+        return NULL;
+    }
+    reader->segment = segment;
+    return reader;
+}
+
+void live_metrics_close (live_metrics_reader_t *reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+    munmap (reader->segment, sizeof (live_metrics_segment_t));
+    free (reader);
+}
+
+int live_metrics_read (live_metrics_reader_t *reader,
+                       live_metrics_data_t *data)
+{
+    live_metrics_segment_t *segment = reader->segment;
+    for (int i = 0; i < MAX_READ_ATTEMPTS; i++) {
+        const unsigned begin = atomic_load_explicit (&segment->sequence,
+                               memory_order_acquire);
+        unsigned end = 0;
+        if (begin & 1u) {
+            continue;
+        }
+        memcpy (data, &segment->data, sizeof (*data));
+        atomic_thread_fence (memory_order_acquire);
+        end = atomic_load_explicit (&segment->sequence, memory_order_relaxed);
+        if (begin == end) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file live_metrics.h
+ * Frame statistics published in POSIX shared memory for external monitors.
+ *
+ * Segment is named "/vkbootstrap.<pid>" and contains, in native byte order:
+ * uint32 magic, uint32 version, uint32 size of live_metrics_data_t,
+ * int32 pid, uint32 sequence, uint32 padding, then live_metrics_data_t.
+ * Sequence is a seqlock: it is odd while publisher writes the data, so a
+ * reader copies the data and retries if sequence was odd or has changed.
+ */
+#ifndef VKBOOTSTRAP_LIVE_METRICS_H
+#define VKBOOTSTRAP_LIVE_METRICS_H
+#include <stdint.h>
+
+/** "VKBM" */
+#define LIVE_METRICS_MAGIC 0x4d424b56u
+#define LIVE_METRICS_VERSION 2
+
+/** Snapshot of statistics, all times are in milliseconds */
+typedef struct live_metrics_data_t {
+    uint64_t frame_number; /**< Number of frames presented */
+    uint64_t update_ns; /**< CLOCK_MONOTONIC time of last update */
+    double cpu_frame_ms; /**< CPU time of last frame, excluding waits */
+    double cpu_frame_ms_avg; /**< Exponential average of cpu_frame_ms */
+    double gpu_frame_ms; /**< GPU time of last measured frame */
+    double gpu_frame_ms_avg; /**< Exponential average of gpu_frame_ms */
+    double present_interval_ms_avg; /**< Average time between presents */
+    uint64_t dropped_frames; /**< Presents late by twice average interval */
+    uint64_t resident_bytes; /**< Resident memory of the process */
+    uint32_t width; /**< Width of swapchain images */
+    uint32_t height; /**< Height of swapchain images */
+    uint32_t image_count; /**< Number of swapchain images */
+    uint32_t padding;
+    char present_mode[16]; /**< Name of present mode, zero terminated */
+    /** Average time from input event to present of first frame using it */
+    double input_latency_ms_avg;
+} live_metrics_data_t;
+
+typedef struct live_metrics_t live_metrics_t;
+
+/** Create and map segment of calling process
+ * @returns publisher, NULL if segment can't be created
+ */
+live_metrics_t *live_metrics_create (void);
+
+/** Unmap and remove segment
+ * @param metrics publisher to destroy, can be NULL
+ */
+void live_metrics_destroy (live_metrics_t *metrics);
+
+/** Set swapchain parameters published with following frames
+ * @param metrics target publisher, can be NULL
+ * @param present_mode human readable name of present mode
+ * @param width width of swapchain images
+ * @param height height of swapchain images
+ * @param image_count number of swapchain images
+ */
+void live_metrics_set_swapchain (live_metrics_t *metrics,
+                                 const char *present_mode, uint32_t width,
+                                 uint32_t height, uint32_t image_count);
+
+/** Set GPU time published with following frames
+ * @param metrics target publisher, can be NULL
+ * @param gpu_ms GPU time of frame that has just been collected
+ */
+void live_metrics_add_gpu_frame (live_metrics_t *metrics, double gpu_ms);
+
+/** Set input latency published with following frames
+ * @param metrics target publisher, can be NULL
+ * @param latency_ms time from input event to present of frame using it
+ */
+void live_metrics_add_input (live_metrics_t *metrics, double latency_ms);
+
+/** Publish statistics of presented frame, never blocks
+ * @param metrics target publisher, can be NULL
+ * @param cpu_ms CPU time spent on frame, excluding waits for GPU
+ * @param present_ns time the frame was presented, see timer_now_ns()
+ */
+void live_metrics_end_frame (live_metrics_t *metrics, double cpu_ms,
+                             uint64_t present_ns);
+
+typedef struct live_metrics_reader_t live_metrics_reader_t;
+
+/** Map segment of another process read-only
+ * @param pid process that publishes metrics
+ * @returns reader, NULL if there is no valid segment of @a pid
+ */
+live_metrics_reader_t *live_metrics_open (int pid);
+
+/** Unmap segment
+ * @param reader reader to close, can be NULL
+ */
+void live_metrics_close (live_metrics_reader_t *reader);
+
+/** Copy consistent snapshot of statistics
+ * @param reader source segment
+ * @param data receives statistics
+ * @returns 0 if publisher is updating the data too often to get snapshot
+ */
+int live_metrics_read (live_metrics_reader_t *reader,
+                       live_metrics_data_t *data);
+
+#endif
@@ -3,16 +3,59 @@
  * This module contains entry point and initialization for X11 variant
  * of application.
  */
+#define _POSIX_C_SOURCE 200809L
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
 #include <xcb/xcb.h>
+#ifdef HAVE_XCB_SYNC
+#include <xcb/sync.h>
+#endif
+#ifdef HAVE_XCB_COMPOSITE
+#include <xcb/composite.h>
+#endif
+#ifdef HAVE_XCB_XINPUT
+#include <xcb/xinput.h>
+#endif
+#ifdef HAVE_XCB_SHM
+#include <xcb/shm.h>
+#endif
 #define VK_USE_PLATFORM_XCB_KHR
 #include <vulkan/vulkan.h>
+#include "benchmark.h"
+#include "common.h"
+#include "flight_recorder.h"
+#include "gpu_profiler.h"
+#include "input_queue.h"
+#include "live_metrics.h"
+#include "microbench.h"
+#include "perf_counters.h"
+#include "pipeline_compiler.h"
+#include "present_latency.h"
+#include "shader_variants.h"
+#include "simulation.h"
+#include "timer.h"
+#include "trace.h"
+#include "worker_pool.h"
+#ifdef HAVE_SHADERS
+#include "shaders.h"
+#endif
+#ifdef HAVE_XCB_SHM
+#include "shm_presenter.h"
+#include "software_renderer.h"
+#endif
 
 /** Window type */
 typedef struct game_window_t {
@@ -22,11 +65,72 @@ typedef struct game_window_t {
     int is_closed; /**< true if window is closed */
     int width; /**< Width of window's client area */
     int height; /**< Height of window's client area */
-    char padding[4];
+    int is_resized; /**< true if size has changed since last check */
+    int is_fullscreen; /**< true if window asked to cover whole screen */
+    int is_mapped; /**< false if window is unmapped, e.g. minimized */
+    uint8_t visibility; /**< State from last VisibilityNotify */
+    uint8_t depth; /**< Depth of window, 32 if it has alpha channel */
+    xcb_colormap_t colormap; /**< 0 if window shares colormap of root */
+    input_queue_t *input; /**< Input events waiting for simulation */
+#ifdef HAVE_XCB_XINPUT
+    /** Major opcode of XInput, 0 if raw motion is not selected */
+    uint8_t xinput_opcode;
+#endif
+#ifdef HAVE_XCB_SYNC
+    xcb_atom_t wm_sync_request; /**< Atom of _NET_WM_SYNC_REQUEST message */
+    /** Counter window manager waits on during resize, 0 if unsupported */
+    xcb_sync_counter_t sync_counter;
+    xcb_sync_int64_t sync_value; /**< Value to set after next frame */
+    int is_sync_pending; /**< true if sync request is not answered yet */
+#endif
 } game_window_t;
 
-/** Single application's main window */
-static game_window_t *main_window = NULL;
+/** Maximum number of windows, see --windows */
+#define MAX_WINDOWS 8
+
+/** Windows of application, each one is rendered to its own swapchain */
+static game_window_t *windows[MAX_WINDOWS];
+
+/** Number of created windows */
+static uint32_t window_count = 0;
+
+/** Atoms interned in one batch right after connecting */
+typedef enum atom_id_t {
+    ATOM_WM_PROTOCOLS,
+    ATOM_WM_DELETE_WINDOW,
+    ATOM_NET_WM_STATE,
+    ATOM_NET_WM_STATE_FULLSCREEN,
+    ATOM_NET_WM_BYPASS_COMPOSITOR,
+    ATOM_NET_WM_SYNC_REQUEST,
+    ATOM_NET_WM_SYNC_REQUEST_COUNTER,
+    ATOM_COUNT
+} atom_id_t;
+
+static const char *const atom_names[ATOM_COUNT] = {
+    "WM_PROTOCOLS",
+    "WM_DELETE_WINDOW",
+    "_NET_WM_STATE",
+    "_NET_WM_STATE_FULLSCREEN",
+    "_NET_WM_BYPASS_COMPOSITOR",
+    "_NET_WM_SYNC_REQUEST",
+    "_NET_WM_SYNC_REQUEST_COUNTER",
+};
+
+/** Interned atoms, XCB_ATOM_NONE if atom is not known */
+static xcb_atom_t atoms[ATOM_COUNT];
+
+/** Number of times startup waited for replies of X server */
+static uint32_t round_trip_count = 0;
+
+#ifdef HAVE_XCB_SYNC
+/** true if XSync extension is initialized */
+static int has_sync = 0;
+#endif
+
+#ifdef HAVE_XCB_XINPUT
+/** Major opcode of XInput, 0 if XInput2 is not supported */
+static uint8_t xinput_opcode = 0;
+#endif
 
 /** The name the program was run with */
 static const char *program_name;
@@ -34,6 +138,51 @@ static const char *program_name;
 /** Flag that indicates to be verbose as possible */
 static int verbose = 0;
 
+/** Flag that requests collection of pipeline statistics per pass */
+static int pipeline_statistics = 0;
+
+/** Flag that requests fixed workload with timing report, see --benchmark */
+static int benchmark_mode = 0;
+
+/** Number of frames measured in benchmark mode */
+static uint32_t benchmark_frames = 1000;
+
+/** Number of frames rendered before measuring starts */
+static uint32_t benchmark_warmup = 100;
+
+/** File to write benchmark report to, "-" for standard output */
+static const char *benchmark_output = "-";
+
+/** File to write trace to, NULL if trace is not requested */
+static const char *trace_output = NULL;
+
+/** Flag that requests publishing metrics in shared memory */
+static int live_metrics_mode = 0;
+
+/** Flag that requests rendering without X server, see --headless */
+static int headless_mode = 0;
+
+/** Microbenchmark to run instead of animation, see --microbench */
+static const char *microbench_name = NULL;
+
+/** Flag that requests rendering on CPU, see --software */
+static int software_mode = 0;
+
+/** Flag that requests fullscreen window bypassing compositor */
+static int fullscreen_mode = 0;
+
+/** Flag that requests window blended with desktop, see --transparent */
+static int transparent_mode = 0;
+
+/** Flag that prefers 10 bits per color channel, see --deep-color */
+static int deep_color_mode = 0;
+
+/** Number of windows, or headless surfaces, rendered every frame */
+static uint32_t view_count = 1;
+
+/** Set by SIGINT and SIGTERM to leave frame loop */
+static volatile sig_atomic_t is_interrupted = 0;
+
 /** License text to show when application is runned with --version flag */
 static const char *version_text =
     PACKAGE_STRING "\n\n"
@@ -42,16 +191,193 @@ static const char *version_text =
     "terms of the Do What The Fuck You Want To Public License, Version 2,\n"
     "as published by Sam Hocevar. See http://www.wtfpl.net for more details.\n";
 
+/* Options that have no short equivalent */
+enum {
+    PIPELINE_STATISTICS_OPTION = CHAR_MAX + 1,
+    BENCHMARK_OPTION,
+    FRAMES_OPTION,
+    WARMUP_OPTION,
+    OUTPUT_OPTION,
+    TRACE_OPTION,
+    LIVE_METRICS_OPTION,
+    HEADLESS_OPTION,
+    MICROBENCH_OPTION,
+    SOFTWARE_OPTION,
+    FULLSCREEN_OPTION,
+    WINDOWS_OPTION,
+    TRANSPARENT_OPTION,
+    DEEP_COLOR_OPTION,
+};
+
 /* Option flags and variables */
 static struct option const long_options[] = {
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'V'},
     {"verbose", no_argument, NULL, 'v'},
+    {"pipeline-statistics", no_argument, NULL, PIPELINE_STATISTICS_OPTION},
+    {"benchmark", no_argument, NULL, BENCHMARK_OPTION},
+    {"frames", required_argument, NULL, FRAMES_OPTION},
+    {"warmup", required_argument, NULL, WARMUP_OPTION},
+    {"output", required_argument, NULL, OUTPUT_OPTION},
+    {"trace", required_argument, NULL, TRACE_OPTION},
+    {"live-metrics", no_argument, NULL, LIVE_METRICS_OPTION},
+    {"headless", no_argument, NULL, HEADLESS_OPTION},
+    {"microbench", required_argument, NULL, MICROBENCH_OPTION},
+    {"software", no_argument, NULL, SOFTWARE_OPTION},
+    {"fullscreen", no_argument, NULL, FULLSCREEN_OPTION},
+    {"windows", required_argument, NULL, WINDOWS_OPTION},
+    {"transparent", no_argument, NULL, TRANSPARENT_OPTION},
+    {"deep-color", no_argument, NULL, DEEP_COLOR_OPTION},
     {NULL, 0, NULL, 0}
 };
 
 #define MAX_PHYSICAL_DEVICES 100
-#define MAX_QUEUE_FAMILY_PROPERTIES 100
+#define MAX_INSTANCE_EXTENSIONS 256
+#define MAX_DEVICE_EXTENSIONS 256
+#define MAX_ENABLED_INSTANCE_EXTENSIONS 3
+#define MAX_ENABLED_DEVICE_EXTENSIONS 3
+/** Number of latency samples taken from tracker at once */
+#define MAX_LATENCY_SAMPLES 16
+#define MAX_PATH_LENGTH 4096
+/** Number of frames CPU is allowed to record ahead of GPU */
+#define FRAMES_IN_FLIGHT 2
+/** Leading entries of preferred_surface_formats used with --deep-color */
+#define DEEP_COLOR_FORMAT_COUNT 2
+#define PIPELINE_CACHE_FILE_NAME "vkbootstrap.pipeline-cache"
+/** Period of simulation ticks while window can't be seen */
+#define HIDDEN_TICK_MS 100
+/** Opacity of background cleared with --transparent */
+#define TRANSPARENT_ALPHA 0.75f
+
+/** Swapchain and objects created for each of its images
+ *
+ * Without surface there is no swapchain, so images are owned by renderer
+ * and frames are never presented.
+ */
+typedef struct swapchain_t {
+    VkSwapchainKHR handle;
+    VkExtent2D extent; /**< Size of swapchain images */
+    uint32_t image_count; /**< Number of images in swapchain */
+    VkPresentModeKHR presentMode;
+    VkFormat format; /**< Format of images */
+    /** Way images are composited, opaque for offscreen images */
+    VkCompositeAlphaFlagBitsKHR compositeAlpha;
+    int is_offscreen; /**< true if images and memory are owned by renderer */
+    VkImage images[MAX_SWAPCHAIN_IMAGES];
+    VkDeviceMemory memory[MAX_SWAPCHAIN_IMAGES]; /**< Memory of offscreen images */
+    VkImageView views[MAX_SWAPCHAIN_IMAGES];
+    VkFramebuffer framebuffers[MAX_SWAPCHAIN_IMAGES];
+} swapchain_t;
+
+/** Resources used to record and submit one frame in flight */
+typedef struct frame_t {
+    VkCommandPool commandPool;
+    /** Begins render pass of each view and executes commands of the view */
+    VkCommandBuffer commandBuffer;
+    /** Signalled when images of all views can be presented */
+    VkSemaphore renderFinished;
+    VkFence fence; /**< Signalled when GPU is done with this frame */
+    /** Time frame was last submitted, for tracing and latency */
+    uint64_t submitTime;
+} frame_t;
+
+/** Window or headless surface rendered every frame
+ *
+ * Each view has own command pools, so views are recorded in parallel.
+ */
+typedef struct view_t {
+    game_window_t *window; /**< NULL if view has no window */
+    VkSurfaceKHR surface; /**< VK_NULL_HANDLE to render offscreen */
+    VkExtent2D extent; /**< Size requested for swapchain images */
+    swapchain_t swapchain;
+    VkCommandPool commandPools[FRAMES_IN_FLIGHT];
+    /** Secondary command buffers drawing inside render pass of the view */
+    VkCommandBuffer commandBuffers[FRAMES_IN_FLIGHT];
+    /** Signalled when acquired image can be rendered to */
+    VkSemaphore imageAcquired[FRAMES_IN_FLIGHT];
+    uint32_t imageIndex; /**< Image rendered by current frame */
+    int isDrawn; /**< true if current frame draws this view */
+    int isOutOfDate; /**< true if swapchain must be recreated */
+    VkResult recordResult; /**< Result of recording current frame */
+} view_t;
+
+/** Everything needed to create pipeline that draws the triangle */
+typedef struct triangle_pipeline_t {
+    VkShaderModule vertexShader;
+    VkShaderModule fragmentShader;
+    VkPipelineLayout layout;
+    VkRenderPass renderPass;
+} triangle_pipeline_t;
+
+/** constant_id of specialization constants of triangle shaders */
+enum {
+    TRIANGLE_ANIMATE_CONSTANT = 0,
+    TRIANGLE_GRAYSCALE_CONSTANT = 1,
+    TRIANGLE_ENCODE_SRGB_CONSTANT = 2,
+};
+
+/** Push constants of triangle shaders */
+typedef struct triangle_constants_t {
+    float time; /**< Animation time in seconds */
+} triangle_constants_t;
+
+/** Phases of frame loop, CPU counters are sampled at the end of each */
+typedef enum frame_phase_t {
+    PHASE_PROCESS_EVENTS = 0,
+    PHASE_SIMULATION,
+    PHASE_WAIT_FENCE,
+    PHASE_ACQUIRE,
+    PHASE_RECORD,
+    PHASE_SUBMIT,
+    PHASE_PRESENT,
+    PHASE_COUNT
+} frame_phase_t;
+
+static const char *const phase_names[PHASE_COUNT] = {
+    "process events",
+    "simulation",
+    "wait fence",
+    "acquire",
+    "record",
+    "submit",
+    "present",
+};
+
+/** Objects used to render frames into window surface */
+typedef struct renderer_t {
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkQueue queue;
+    VkRenderPass renderPass;
+    view_t views[MAX_WINDOWS];
+    uint32_t viewCount;
+    worker_pool_t *recorders; /**< Threads recording views in parallel */
+    frame_t frames[FRAMES_IN_FLIGHT];
+    VkPipelineCache pipelineCache; /**< Cache persisted between runs */
+    pipeline_compiler_t *compiler; /**< Creates pipelines in background */
+    triangle_pipeline_t triangle;
+    shader_variants_t *triangleVariants; /**< NULL if there are no shaders */
+    shader_variant_key_t triangleKey; /**< Variant of triangle to draw */
+    VkPipeline trianglePipeline; /**< Pipeline used by current frame */
+    int hasStatistics; /**< true if passes collect pipeline statistics */
+    /** true if windows have alpha channel, frames use premultiplied alpha */
+    int hasAlpha;
+    VkSurfaceFormatKHR surfaceFormat; /**< Format of images of all views */
+    /** true if format stores values as they are, so frames encode sRGB */
+    int encodesSrgb;
+    gpu_profiler_t *profiler; /**< GPU pass timings, NULL if unsupported */
+    /** Present latency of benchmark, NULL if not measured */
+    present_latency_t *latency;
+    uint64_t presentId; /**< ID of last frame presented with present ID */
+    uint64_t frame_number; /**< Number of frames submitted so far */
+    float animationTime; /**< Time pushed to triangle shaders */
+    double waitMs; /**< Time last draw_frame() spent waiting for GPU */
+    int hasGpuTimings; /**< true if last draw_frame() collected gpuTimings */
+    gpu_frame_timings_t gpuTimings; /**< GPU timings of earlier frame */
+    perf_counters_t *counters; /**< CPU counters of render thread, or NULL */
+    perf_sample_t phaseBegin; /**< Counters at the start of current phase */
+    perf_sample_t phaseCounters[PHASE_COUNT]; /**< Counters of frame phases */
+} renderer_t;
 static const VkApplicationInfo pApplicationInfo = {
     .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
     .pNext = NULL,
@@ -64,6 +390,11 @@ static const VkApplicationInfo pApplicationInfo = {
 static const char *const ppEnabledInstanceExtensionNames[] = {
     VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_XCB_SURFACE_EXTENSION_NAME,
 };
+#ifdef VK_EXT_headless_surface
+static const char *const ppHeadlessInstanceExtensionNames[] = {
+    VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME,
+};
+#endif
 static const VkInstanceCreateInfo instanceCreateInfo = {
     .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
     .pNext = NULL,
@@ -83,40 +414,403 @@ static void print_usage (void)
             "  -h, --help     display this help and exit\n"
             "  -V, --version  output version information and exit\n"
             "  --verbose      be verbose\n"
+            "  --pipeline-statistics\n"
+            "                 collect shader invocation counts of each pass\n"
+            "  --benchmark    render fixed workload, report timings and exit\n"
+            "  --frames=N     number of frames to measure in benchmark (1000)\n"
+            "  --warmup=M     number of frames to skip before measuring (100)\n"
+            "  --output=FILE  write benchmark or microbenchmark report to FILE\n"
+            "                 instead of stdout\n"
+            "  --trace=FILE   write Chrome trace of CPU and GPU zones to FILE\n"
+            "  --live-metrics publish frame statistics for vkbootstrap-top\n"
+            "  --headless     render offscreen without X server until "
+            "interrupted\n"
+            "  --microbench=NAME\n"
+            "                 run microbenchmark, report it and exit, NAME is "
+            "copy,\n"
+            "                 host-write, submit, dispatch, barrier, present,\n"
+            "                 present-format or all\n"
+            "  --software     render on CPU and present through MIT-SHM, "
+            "also used\n"
+            "                 when Vulkan can't be initialized\n"
+            "  --fullscreen   cover whole screen and ask compositor to "
+            "unredirect window\n"
+            "  --windows=N    render N windows, or N headless surfaces, "
+            "presented\n"
+            "                 together every frame (1)\n"
+            "  --transparent  blend windows with desktop using premultiplied "
+            "alpha\n"
+            "  --deep-color   prefer 30-bit window and 10-bit surface formats "
+            "if screen\n"
+            "                 and surface have them\n"
+            "\nEnvironment:\n"
+            "  VKBOOTSTRAP_FLIGHT_DIR\n"
+            "                 directory of flight recorder dumps written on "
+            "errors,\n"
+            "                 empty to disable them (TMPDIR or /tmp)\n"
             "\nReport bugs to: <" PACKAGE_BUGREPORT ">\n", program_name);
 }
 
-/** Process all pending events
- * @param window events of this window should be processed
+/** Queue core input event with its timestamps
+ * @param window window that received the event
+ * @param event key, button or motion event, they share layout
  */
-static void window_process_events (game_window_t *window)
+static void window_push_core_input (game_window_t *window,
+                                    const xcb_generic_event_t *event)
+{
+    const xcb_key_press_event_t *input = (const xcb_key_press_event_t *)event;
+    input_event_t queued;
+    switch (event->response_type & ~0x80) {
+        case XCB_KEY_PRESS:
+            queued.type = INPUT_EVENT_KEY_PRESS;
+            break;
+        case XCB_KEY_RELEASE:
+            queued.type = INPUT_EVENT_KEY_RELEASE;
+            break;
+        case XCB_BUTTON_PRESS:
+            queued.type = INPUT_EVENT_BUTTON_PRESS;
+            break;
+        case XCB_BUTTON_RELEASE:
+            queued.type = INPUT_EVENT_BUTTON_RELEASE;
+            break;
+        default:
+            queued.type = INPUT_EVENT_MOTION;
+            break;
+    }
+    queued.detail = queued.type != INPUT_EVENT_MOTION ? input->detail : 0;
+    queued.server_time = input->time;
+    queued.x = (float)input->event_x;
+    queued.y = (float)input->event_y;
+    queued.local_ns = timer_now_ns ();
+    queued.value = 0;
+    input_queue_push (window->input, &queued);
+}
+
+#ifdef HAVE_XCB_XINPUT
+/** Queue XInput2 raw motion, first two valuators are taken as x and y
+ * @param window window that selected raw events
+ * @param event raw motion event
+ */
+static void window_push_raw_motion (game_window_t *window,
+                                    const xcb_ge_generic_event_t *event)
+{
+    const xcb_input_raw_motion_event_t *raw =
+        (const xcb_input_raw_motion_event_t *)event;
+    const uint32_t *valuators = xcb_input_raw_button_press_valuator_mask (raw);
+    const xcb_input_fp3232_t *values =
+        xcb_input_raw_button_press_axisvalues_raw (raw);
+    float axes[2] = {0.0f, 0.0f};
+    input_event_t queued;
+    int value = 0;
+    /* Values are sent only for valuators set in mask */
+    for (uint32_t axis = 0; axis < 2 && raw->valuators_len > 0; axis++) {
+        if (valuators[0] & (1u << axis)) {
+            axes[axis] = (float)((double)values[value].integral
+                                 + (double)values[value].frac / 4294967296.0);
+            value++;
+        }
+    }
+    queued.type = INPUT_EVENT_RAW_MOTION;
+    queued.detail = 0;
+    queued.server_time = raw->time;
+    queued.x = axes[0];
+    queued.y = axes[1];
+    queued.local_ns = timer_now_ns ();
+    queued.value = 0;
+    input_queue_push (window->input, &queued);
+}
+#endif
+
+/** Thread that reads events of all windows from their connection */
+typedef struct event_thread_t {
+    xcb_connection_t *connection;
+    pthread_t thread;
+    int is_started; /**< true if @a thread has to be joined */
+    atomic_int is_stopping;
+    pthread_mutex_t lock; /**< Protects counters below */
+    /** Uses CLOCK_MONOTONIC, initialized by event_thread_start() */
+    pthread_cond_t state_changed;
+    uint64_t change_count; /**< Number of state changes sent so far */
+    uint64_t seen_count; /**< Value of @a change_count at end of last wait */
+} event_thread_t;
+
+/** Event thread of connection windows are created on */
+static event_thread_t event_thread = {
+    .connection = NULL,
+    .is_started = 0,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .change_count = 0,
+    .seen_count = 0,
+};
+
+/** Send change of window state to render thread
+ *
+ * Unlike input, state is never dropped. Render thread drains the queue
+ * every frame, so a full queue frees up soon.
+ * @param window window which state has changed
+ * @param state message describing the change
+ */
+static void window_send_state (game_window_t *window,
+                               const input_event_t *state)
+{
+    const struct timespec retry_delay = {.tv_sec = 0, .tv_nsec = 1000000};
+    while (input_queue_push (window->input, state) != 0
+            && !atomic_load (&event_thread.is_stopping)) {
+        nanosleep (&retry_delay, NULL);
+    }
+    pthread_mutex_lock (&event_thread.lock);
+    event_thread.change_count++;
+    pthread_cond_signal (&event_thread.state_changed);
+    pthread_mutex_unlock (&event_thread.lock);
+}
+
+/** Handle event reported to window, called on event thread
+ *
+ * Window is only read here, its state is changed by render thread when
+ * it takes the messages sent from here.
+ * @param window window the event belongs to
+ * @param event event to handle
+ */
+static void window_handle_event (game_window_t *window,
+                                 xcb_generic_event_t *event)
 {
-    xcb_generic_event_t *event = NULL;
     xcb_client_message_event_t *client_message = NULL;
     xcb_configure_notify_event_t *configure_event = NULL;
-    int size_changed = 0;
-    while ((event = xcb_poll_for_event (window->connection))) {
-        switch (event->response_type & ~0x80) {
-            case XCB_CLIENT_MESSAGE:
-                client_message = (xcb_client_message_event_t *)event;
-                if (client_message->data.data32[0] == window->wm_delete_window) {
-                    window->is_closed = 1;
-                }
-                break;
-            case XCB_CONFIGURE_NOTIFY:
-                configure_event = (xcb_configure_notify_event_t *)event;
-                size_changed = (configure_event->width != window->width)
-                               || (configure_event->height != window->height);
-                if (size_changed) {
-                    window->width = configure_event->width;
-                    window->height = configure_event->height;
-                    /*game_resize (window->width, window->height);*/
-                }
-                break;
-            default:
+#ifdef HAVE_XCB_XINPUT
+    xcb_ge_generic_event_t *generic = NULL;
+#endif
+    input_event_t state = {
+        .type = INPUT_EVENT_CLOSE,
+        .detail = 0,
+        .server_time = 0,
+        .x = 0.0f,
+        .y = 0.0f,
+        .local_ns = 0,
+        .value = 0,
+    };
+    int has_state = 0;
+    switch (event->response_type & ~0x80) {
+        case XCB_CLIENT_MESSAGE:
+            client_message = (xcb_client_message_event_t *)event;
+            if (client_message->type != atoms[ATOM_WM_PROTOCOLS]
+                    || client_message->type == XCB_ATOM_NONE) {
+                /* Not from window manager, e.g. wake of event thread */
                 break;
+            }
+            if (client_message->data.data32[0] == window->wm_delete_window) {
+                state.type = INPUT_EVENT_CLOSE;
+                has_state = 1;
+            }
+#ifdef HAVE_XCB_SYNC
+            /* Configure notify follows, counter is set once frame of
+             * new size is presented */
+            if (client_message->data.data32[0] == window->wm_sync_request
+                    && window->sync_counter != 0) {
+                state.type = INPUT_EVENT_SYNC_REQUEST;
+                state.server_time = client_message->data.data32[1];
+                state.value = (int64_t)(((uint64_t)
+                                         client_message->data.data32[3] << 32)
+                                        | client_message->data.data32[2]);
+                has_state = 1;
+            }
+#endif
+            break;
+        case XCB_CONFIGURE_NOTIFY:
+            /* Render thread ignores it if only position has changed */
+            configure_event = (xcb_configure_notify_event_t *)event;
+            state.type = INPUT_EVENT_RESIZE;
+            state.x = (float)configure_event->width;
+            state.y = (float)configure_event->height;
+            has_state = 1;
+            break;
+        case XCB_MAP_NOTIFY:
+        case XCB_UNMAP_NOTIFY:
+            state.type = INPUT_EVENT_MAP;
+            state.detail = (event->response_type & ~0x80) == XCB_MAP_NOTIFY;
+            has_state = 1;
+            break;
+        case XCB_VISIBILITY_NOTIFY:
+            state.type = INPUT_EVENT_VISIBILITY;
+            state.detail = ((xcb_visibility_notify_event_t *)event)->state;
+            has_state = 1;
+            break;
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+        case XCB_MOTION_NOTIFY:
+            window_push_core_input (window, event);
+            break;
+#ifdef HAVE_XCB_XINPUT
+        case XCB_GE_GENERIC:
+            generic = (xcb_ge_generic_event_t *)event;
+            if (window->xinput_opcode != 0
+                    && generic->extension == window->xinput_opcode
+                    && generic->event_type == XCB_INPUT_RAW_MOTION) {
+                window_push_raw_motion (window, generic);
+            }
+            break;
+#endif
+        default:
+            break;
+    }
+    if (has_state) {
+        state.local_ns = timer_now_ns ();
+        window_send_state (window, &state);
+    }
+}
+
+/** Find window event is reported to
+ * @param event event read from connection of windows
+ * @returns window of application, NULL if event belongs to none of them
+ */
+static game_window_t *find_event_window (const xcb_generic_event_t *event)
+{
+    xcb_window_t window_id = XCB_WINDOW_NONE;
+    switch (event->response_type & ~0x80) {
+        case XCB_CLIENT_MESSAGE:
+            window_id = ((const xcb_client_message_event_t *)event)->window;
+            break;
+        case XCB_CONFIGURE_NOTIFY:
+            window_id = ((const xcb_configure_notify_event_t *)event)->window;
+            break;
+        case XCB_MAP_NOTIFY:
+            window_id = ((const xcb_map_notify_event_t *)event)->window;
+            break;
+        case XCB_UNMAP_NOTIFY:
+            window_id = ((const xcb_unmap_notify_event_t *)event)->window;
+            break;
+        case XCB_VISIBILITY_NOTIFY:
+            window_id = ((const xcb_visibility_notify_event_t *)event)->window;
+            break;
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+        case XCB_MOTION_NOTIFY:
+            window_id = ((const xcb_key_press_event_t *)event)->event;
+            break;
+        case XCB_GE_GENERIC:
+            /* Raw input is selected on root, first window takes it */
+            return window_count > 0 ? windows[0] : NULL;
+        default:
+            break;
+    }
+    for (uint32_t i = 0; i < window_count; i++) {
+        if (windows[i]->window_id == window_id) {
+            return windows[i];
+        }
+    }
+    return NULL;
+}
+
+/** Read events until connection is lost or thread is stopped */
+static void *event_thread_main (void *arg)
+{
+    xcb_generic_event_t *event = NULL;
+    (void)arg;
+    TRACE_THREAD_NAME ("events");
+    while (!atomic_load (&event_thread.is_stopping)
+            && (event = xcb_wait_for_event (event_thread.connection)) != NULL) {
+        game_window_t *window = find_event_window (event);
+        if (window != NULL) {
+            window_handle_event (window, event);
+        }
+        free (event);
+    }
+    if (!atomic_load (&event_thread.is_stopping)) {
+        /* Connection is broken, windows can't be shown anymore */
+        const input_event_t state = {
+            .type = INPUT_EVENT_CLOSE,
+            .detail = 0,
+            .server_time = 0,
+            .x = 0.0f,
+            .y = 0.0f,
+            .local_ns = timer_now_ns (),
+            .value = 0,
+        };
+        for (uint32_t i = 0; i < window_count; i++) {
+            window_send_state (windows[i], &state);
         }
     }
+    return NULL;
+}
+
+/** Start reading events of windows on their own thread
+ *
+ * All windows must be created before, and destroyed only after
+ * event_thread_stop().
+ * @param connection connection windows are created on
+ * @returns 0 on success, -1 if thread can't be started
+ */
+static int event_thread_start (xcb_connection_t *connection)
+{
+    pthread_condattr_t attributes;
+    int error = 0;
+    event_thread.connection = connection;
+    atomic_store (&event_thread.is_stopping, 0);
+    if (pthread_condattr_init (&attributes) != 0) {
+        return -1;
+    }
+    /* Wall clock steps must not stretch or cut ticks of hidden windows */
+    error = pthread_condattr_setclock (&attributes, CLOCK_MONOTONIC) != 0
+            || pthread_cond_init (&event_thread.state_changed,
+                                  &attributes) != 0;
+    pthread_condattr_destroy (&attributes);
+    if (error) {
+        return -1;
+    }
+    if (pthread_create (&event_thread.thread, NULL, event_thread_main, NULL)) {
+        pthread_cond_destroy (&event_thread.state_changed);
+        return -1;
+    }
+    event_thread.is_started = 1;
+    return 0;
+}
+
+/** Wake event thread and wait until it exits */
+static void event_thread_stop (void)
+{
+    xcb_client_message_event_t wake;
+    if (!event_thread.is_started) {
+        return;
+    }
+    atomic_store (&event_thread.is_stopping, 1);
+    /* Message without type is ignored, it only ends the wait for event */
+    memset (&wake, 0, sizeof (wake));
+    wake.response_type = XCB_CLIENT_MESSAGE;
+    wake.format = 32;
+    wake.window = windows[0]->window_id;
+    wake.type = XCB_ATOM_NONE;
+    xcb_send_event (event_thread.connection, 0, wake.window,
+                    XCB_EVENT_MASK_NO_EVENT, (const char *)&wake);
+    xcb_flush (event_thread.connection);
+    pthread_join (event_thread.thread, NULL);
+    pthread_cond_destroy (&event_thread.state_changed);
+    event_thread.is_started = 0;
+}
+
+/** Block until state of a window changes or timeout expires
+ * @param timeout_ms maximum wait time in milliseconds
+ */
+static void event_thread_wait (int timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime (CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock (&event_thread.lock);
+    /* Changes sent since last wait may be still queued, they end it too */
+    while (event_thread.change_count == event_thread.seen_count
+            && pthread_cond_timedwait (&event_thread.state_changed,
+                                       &event_thread.lock, &deadline) == 0) {
+    }
+    event_thread.seen_count = event_thread.change_count;
+    pthread_mutex_unlock (&event_thread.lock);
 }
 
 /** Check is window isn't closed
@@ -127,13 +821,234 @@ static int window_is_exists (game_window_t *window)
     return window->is_closed == 0;
 }
 
+/** Apply input and state changes sent by event thread
+ * @param window window whose queue is drained
+ * @param simulation scene changed by input, NULL to drop the input
+ * @returns local time of oldest input event taken, 0 if there was none
+ */
+static uint64_t window_apply_events (game_window_t *window,
+                                     simulation_t *simulation)
+{
+    input_event_t event;
+    uint64_t oldest_ns = 0;
+    while (input_queue_pop (window->input, &event)) {
+        switch (event.type) {
+            case INPUT_EVENT_RESIZE:
+                if ((int)event.x != window->width
+                        || (int)event.y != window->height) {
+                    window->width = (int)event.x;
+                    window->height = (int)event.y;
+                    window->is_resized = 1;
+                }
+                break;
+            case INPUT_EVENT_CLOSE:
+                window->is_closed = 1;
+                break;
+            case INPUT_EVENT_MAP:
+                window->is_mapped = event.detail != 0;
+                break;
+            case INPUT_EVENT_VISIBILITY:
+                window->visibility = (uint8_t)event.detail;
+                break;
+            case INPUT_EVENT_SYNC_REQUEST:
+#ifdef HAVE_XCB_SYNC
+                window->sync_value.lo = (uint32_t)event.value;
+                window->sync_value.hi = (int32_t)((uint64_t)event.value >> 32);
+                window->is_sync_pending = 1;
+#endif
+                break;
+            case INPUT_EVENT_KEY_PRESS:
+            case INPUT_EVENT_KEY_RELEASE:
+            case INPUT_EVENT_BUTTON_PRESS:
+            case INPUT_EVENT_BUTTON_RELEASE:
+            case INPUT_EVENT_MOTION:
+            case INPUT_EVENT_RAW_MOTION:
+            default:
+                if (simulation != NULL) {
+                    simulation_apply_input (simulation, &event);
+                }
+                if (oldest_ns == 0) {
+                    oldest_ns = event.local_ns;
+                }
+                break;
+        }
+    }
+    return oldest_ns;
+}
+
+/** Check if any part of window can be seen
+ * @returns non-zero if window is mapped and not fully obscured
+ */
+static int window_is_visible (const game_window_t *window)
+{
+    return window->is_mapped
+           && window->visibility != XCB_VISIBILITY_FULLY_OBSCURED;
+}
+
+/** Tell window manager that frame was presented after last sync request
+ *
+ * Window manager waits for this during interactive resize, so the window
+ * is never shown with stale contents of different size.
+ * @param window window the frame was presented to
+ */
+static void window_end_frame (game_window_t *window)
+{
+#ifdef HAVE_XCB_SYNC
+    if (window->is_sync_pending) {
+        window->is_sync_pending = 0;
+        xcb_sync_set_counter (window->connection, window->sync_counter,
+                              window->sync_value);
+        xcb_flush (window->connection);
+    }
+#else
+    (void)window;
+#endif
+}
+
+/** Send requests whose replies are needed to create windows
+ *
+ * Nothing waits for the replies here, server answers them while Vulkan
+ * is initialized, see collect_atoms().
+ * @param connection connection to send requests to
+ * @param cookies receives cookie of each atom, ATOM_COUNT of them
+ */
+static void request_atoms (xcb_connection_t *connection,
+                           xcb_intern_atom_cookie_t *cookies)
+{
+    /* Extensions are queried first, so their replies come before atoms */
+#ifdef HAVE_XCB_SYNC
+    xcb_prefetch_extension_data (connection, &xcb_sync_id);
+#endif
+#ifdef HAVE_XCB_COMPOSITE
+    xcb_prefetch_extension_data (connection, &xcb_composite_id);
+#endif
+#ifdef HAVE_XCB_XINPUT
+    xcb_prefetch_extension_data (connection, &xcb_input_id);
+#endif
+#ifdef HAVE_XCB_SHM
+    xcb_prefetch_extension_data (connection, &xcb_shm_id);
+#endif
+    for (uint32_t i = 0; i < ATOM_COUNT; i++) {
+        cookies[i] = xcb_intern_atom (connection, 0,
+                                      (uint16_t)strlen (atom_names[i]),
+                                      atom_names[i]);
+    }
+    xcb_flush (connection);
+}
+
+/** Take replies of requests sent by request_atoms()
+ * @param connection connection requests were sent to
+ * @param cookies cookies returned by request_atoms()
+ */
+static void collect_atoms (xcb_connection_t *connection,
+                           const xcb_intern_atom_cookie_t *cookies)
+{
+    /* Replies of whole batch arrive after a single round trip */
+    round_trip_count++;
+    for (uint32_t i = 0; i < ATOM_COUNT; i++) {
+        xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply (connection,
+                                         cookies[i], NULL);
+        atoms[i] = reply != NULL ? reply->atom : XCB_ATOM_NONE;
+        free (reply);
+    }
+}
+
+/** Negotiate versions of optional extensions in a single round trip
+ *
+ * Extension data must be already prefetched by request_atoms().
+ * @param connection connection windows are created on
+ */
+static void init_extensions (xcb_connection_t *connection)
+{
+#ifdef HAVE_XCB_SYNC
+    const xcb_query_extension_reply_t *sync = xcb_get_extension_data (
+                connection, &xcb_sync_id);
+    xcb_sync_initialize_cookie_t sync_cookie;
+    xcb_sync_initialize_reply_t *sync_version = NULL;
+#endif
+#ifdef HAVE_XCB_XINPUT
+    const xcb_query_extension_reply_t *xinput = xcb_get_extension_data (
+                connection, &xcb_input_id);
+    xcb_input_xi_query_version_cookie_t xinput_cookie;
+    xcb_input_xi_query_version_reply_t *xinput_version = NULL;
+#endif
+    int is_waiting = 0;
+#ifdef HAVE_XCB_SYNC
+    /* Extension must be initialized before any other request */
+    if (sync != NULL && sync->present) {
+        sync_cookie = xcb_sync_initialize (connection, XCB_SYNC_MAJOR_VERSION,
+                                           XCB_SYNC_MINOR_VERSION);
+        is_waiting = 1;
+    }
+#endif
+#ifdef HAVE_XCB_XINPUT
+    if (xinput != NULL && xinput->present) {
+        xinput_cookie = xcb_input_xi_query_version (connection, 2, 0);
+        is_waiting = 1;
+    }
+#endif
+    if (is_waiting) {
+        round_trip_count++;
+    }
+#ifdef HAVE_XCB_SYNC
+    if (sync != NULL && sync->present) {
+        sync_version = xcb_sync_initialize_reply (connection, sync_cookie,
+                       NULL);
+        has_sync = sync_version != NULL;
+        free (sync_version);
+    }
+#endif
+#ifdef HAVE_XCB_XINPUT
+    if (xinput != NULL && xinput->present) {
+        xinput_version = xcb_input_xi_query_version_reply (connection,
+                         xinput_cookie, NULL);
+        if (xinput_version != NULL && xinput_version->major_version >= 2) {
+            xinput_opcode = xinput->major_opcode;
+        }
+        free (xinput_version);
+    }
+#endif
+    (void)connection;
+}
+
+#ifdef HAVE_XCB_SYNC
+/** Create XSync counter and announce it to window manager
+ * @param window window that takes part in _NET_WM_SYNC_REQUEST protocol
+ * @param counter_atom atom of _NET_WM_SYNC_REQUEST_COUNTER property
+ * @returns non-zero if counter is created
+ */
+static int window_init_sync (game_window_t *window, xcb_atom_t counter_atom)
+{
+    xcb_connection_t *connection = window->connection;
+    const xcb_sync_int64_t zero = {.hi = 0, .lo = 0};
+    if (!has_sync || counter_atom == XCB_ATOM_NONE) {
+        return 0;
+    }
+    window->sync_counter = xcb_generate_id (connection);
+    xcb_sync_create_counter (connection, window->sync_counter, zero);
+    xcb_change_property (connection, XCB_PROP_MODE_REPLACE, window->window_id,
+                         counter_atom, XCB_ATOM_CARDINAL, 32, 1,
+                         &window->sync_counter);
+    return 1;
+}
+#endif
+
 /** Destroy window and free all related resources
  * @param window window to destroy
  */
 static void window_destroy (game_window_t *window)
 {
     if (window != NULL) {
+#ifdef HAVE_XCB_SYNC
+        if (window->sync_counter != 0) {
+            xcb_sync_destroy_counter (window->connection, window->sync_counter);
+        }
+#endif
         xcb_destroy_window (window->connection, window->window_id);
+        if (window->colormap != 0) {
+            xcb_free_colormap (window->connection, window->colormap);
+        }
+        input_queue_destroy (window->input);
         free (window);
     }
 }
@@ -146,55 +1061,286 @@ static xcb_window_t window_get_native (game_window_t *window)
     return window->window_id;
 }
 
+/** Check if compositor shows window directly instead of its own copy
+ * @param window window to check
+ * @returns 1 if window is unredirected, 0 if redirected, -1 if unknown
+ */
+static int window_is_unredirected (game_window_t *window)
+{
+#ifdef HAVE_XCB_COMPOSITE
+    xcb_connection_t *connection = window->connection;
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data (
+                connection, &xcb_composite_id);
+    xcb_composite_query_version_reply_t *version = NULL;
+    xcb_query_tree_reply_t *tree = NULL;
+    xcb_generic_error_t *error = NULL;
+    xcb_window_t toplevel = window->window_id;
+    xcb_pixmap_t pixmap = 0;
+    if (extension == NULL || !extension->present) {
+        /* Without Composite nothing can be redirected */
+        return 1;
+    }
+    version = xcb_composite_query_version_reply (connection,
+              xcb_composite_query_version (connection,
+                                           XCB_COMPOSITE_MAJOR_VERSION,
+                                           XCB_COMPOSITE_MINOR_VERSION), NULL);
+    if (version == NULL) {
+        return -1;
+    }
+    free (version);
+    /* Compositor redirects frame of window manager, the child of root */
+    while ((tree = xcb_query_tree_reply (connection,
+                                         xcb_query_tree (connection, toplevel),
+                                         NULL)) != NULL
+            && tree->parent != tree->root) {
+        toplevel = tree->parent;
+        free (tree);
+    }
+    if (tree == NULL) {
+        return -1;
+    }
+    free (tree);
+    /* Only redirected window has pixmap that can be named */
+    pixmap = xcb_generate_id (connection);
+    error = xcb_request_check (connection,
+                               xcb_composite_name_window_pixmap_checked (
+                                   connection, toplevel, pixmap));
+    if (error != NULL) {
+        const int is_match = error->error_code == XCB_MATCH;
+        free (error);
+        return is_match ? 1 : -1;
+    }
+    xcb_free_pixmap (connection, pixmap);
+    return 0;
+#else
+    (void)window;
+    return -1;
+#endif
+}
+
+#ifdef HAVE_XCB_XINPUT
+/** Select XInput2 raw motion of all master devices
+ * @param window window whose queue receives the events
+ * @param root root window of screen, raw events can be selected only there
+ */
+static void window_init_xinput (game_window_t *window, xcb_window_t root)
+{
+    struct {
+        xcb_input_event_mask_t header;
+        uint32_t mask;
+    } mask;
+    window->xinput_opcode = 0;
+    if (xinput_opcode == 0) {
+        return;
+    }
+    mask.header.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
+    mask.header.mask_len = 1;
+    mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_MOTION;
+    xcb_input_xi_select_events (window->connection, root, 1, &mask.header);
+    window->xinput_opcode = xinput_opcode;
+}
+#endif
+
+/** Find TrueColor visual of screen
+ * @param screen screen to search
+ * @param depth 24 for opaque visual, 32 for visual with alpha channel,
+ *        both with 8 bits per color channel, 30 for opaque visual with 10
+ * @returns matching visual, root visual is preferred, NULL if none
+ */
+static const xcb_visualtype_t *find_true_color_visual (
+    const xcb_screen_t *screen, uint8_t depth)
+{
+    xcb_depth_iterator_t depths = xcb_screen_allowed_depths_iterator (screen);
+    const xcb_visualtype_t *found = NULL;
+    const uint8_t bits = depth == 30 ? 10 : 8;
+    const uint32_t colorMask = (1u << (3 * bits)) - 1;
+    for (; depths.rem; xcb_depth_next (&depths)) {
+        xcb_visualtype_iterator_t visuals;
+        if (depths.data->depth != depth) {
+            continue;
+        }
+        visuals = xcb_depth_visuals_iterator (depths.data);
+        for (; visuals.rem; xcb_visualtype_next (&visuals)) {
+            const xcb_visualtype_t *visual = visuals.data;
+            if (visual->_class != XCB_VISUAL_CLASS_TRUE_COLOR
+                    || visual->bits_per_rgb_value != bits
+                    || (visual->red_mask | visual->green_mask
+                        | visual->blue_mask) != colorMask) {
+                continue;
+            }
+            /* Root visual needs no colormap of its own */
+            if (visual->visual_id == screen->root_visual) {
+                return visual;
+            }
+            if (found == NULL) {
+                found = visual;
+            }
+        }
+    }
+    return found;
+}
+
 /** Create and display new window
+ *
+ * Visual matches swapchain images, so neither X server nor compositor
+ * converts presented frames.
  * @param connection The connection to display where window should be created
  * @param caption The caption of window in Host Portable Character Encoding
  * @param width The width of the window's client area
  * @param height The height of the window's client area
+ * @param fullscreen non-zero to cover whole screen, @a width and @a height
+ *        are ignored then
+ * @param transparent non-zero to create 32-bit window with alpha channel,
+ *        window is opaque if screen has no such visual
+ * @param deepColor non-zero to create 30-bit window, which drivers offer
+ *        10-bit surface formats for; ignored if @a transparent is set
+ *        and 24-bit window is created if screen has no such visual
  * @returns new window object, NULL otherwise
  */
 static game_window_t *window_create (xcb_connection_t *connection,
                                      const char *caption,
-                                     uint16_t width, uint16_t height)
+                                     uint16_t width, uint16_t height,
+                                     int fullscreen, int transparent,
+                                     int deepColor)
 {
     const xcb_setup_t *setup = xcb_get_setup (connection);
     xcb_screen_iterator_t iter = xcb_setup_roots_iterator (setup);
     xcb_screen_t *screen = iter.data;
     game_window_t *window = NULL;
     window = (game_window_t *)malloc (sizeof (game_window_t));
+    if (window != NULL && (window->input = input_queue_create ()) == NULL) {
+        free (window);
+        window = NULL;
+    }
     if (window != NULL) {
-        const uint32_t mask = XCB_CW_EVENT_MASK;
-        const uint32_t values[] = {XCB_EVENT_MASK_STRUCTURE_NOTIFY};
-        xcb_intern_atom_cookie_t delete_cookie = xcb_intern_atom (connection,
-                0, strlen ("WM_DELETE_WINDOW"), "WM_DELETE_WINDOW");
-        xcb_intern_atom_cookie_t protocols_cookie = xcb_intern_atom (connection,
-                0, strlen ("WM_PROTOCOLS"), "WM_PROTOCOLS");
-        xcb_intern_atom_reply_t *delete_reply = xcb_intern_atom_reply (connection,
-                                                delete_cookie, NULL);
-        xcb_intern_atom_reply_t *protocols_reply = xcb_intern_atom_reply (connection,
-                protocols_cookie, NULL);
+        uint8_t depth = transparent ? 32 : deepColor ? 30 : 24;
+        const xcb_visualtype_t *visual = find_true_color_visual (screen, depth);
+        /* Border pixel must be set if depth differs from parent */
+        uint32_t mask = XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK;
+        uint32_t values[3] = {
+            0,
+            XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_VISIBILITY_CHANGE
+            | XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE
+            | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE
+            | XCB_EVENT_MASK_POINTER_MOTION,
+            0
+        };
+        xcb_atom_t protocols[2];
+        uint32_t protocol_count = 0;
+#ifdef HAVE_XCB_SYNC
+        window->wm_sync_request = XCB_ATOM_NONE;
+        window->sync_counter = 0;
+        window->is_sync_pending = 0;
+#endif
+        if (fullscreen) {
+            width = screen->width_in_pixels;
+            height = screen->height_in_pixels;
+        }
         window->connection = connection;
         window->is_closed = 0;
-        window->width = 0;
-        window->height = 0;
+        window->width = width;
+        window->height = height;
+        window->is_resized = 0;
+        window->is_fullscreen = fullscreen;
+        /* Window is mapped below, so it is expected to be seen */
+        window->is_mapped = 1;
+        window->visibility = XCB_VISIBILITY_UNOBSCURED;
+        window->colormap = 0;
+        if (visual == NULL && depth != 24) {
+            /* Opaque 8-bit window is still better than none */
+            depth = 24;
+            visual = find_true_color_visual (screen, depth);
+        }
+        window->depth = visual != NULL ? depth : screen->root_depth;
+        if (visual != NULL && visual->visual_id != screen->root_visual) {
+            window->colormap = xcb_generate_id (connection);
+            xcb_create_colormap (connection, XCB_COLORMAP_ALLOC_NONE,
+                                 window->colormap, screen->root,
+                                 visual->visual_id);
+            mask |= XCB_CW_COLORMAP;
+            values[2] = window->colormap;
+        }
         window->window_id = xcb_generate_id (connection);
-        xcb_create_window (connection, XCB_COPY_FROM_PARENT, window->window_id,
+        xcb_create_window (connection, window->depth, window->window_id,
                            screen->root, 0, 0, width, height, 0,
-                           XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
-                           mask, values);
+                           XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                           visual != NULL ? visual->visual_id
+                           : screen->root_visual, mask, values);
+        if (verbose) {
+            printf ("Window visual 0x%x, depth %u\n",
+                    visual != NULL ? visual->visual_id : screen->root_visual,
+                    window->depth);
+        }
         xcb_change_property (connection, XCB_PROP_MODE_REPLACE,
                              window->window_id, XCB_ATOM_WM_NAME,
                              XCB_ATOM_STRING, 8, (uint32_t)strlen (caption), caption);
 
-        window->wm_delete_window = delete_reply->atom;
-        xcb_change_property (connection, XCB_PROP_MODE_REPLACE, window->window_id,
-                             protocols_reply->atom, 4, 32, 1, &delete_reply->atom);
+        window->wm_delete_window = atoms[ATOM_WM_DELETE_WINDOW];
+        if (window->wm_delete_window != XCB_ATOM_NONE) {
+            protocols[protocol_count++] = window->wm_delete_window;
+        }
+#ifdef HAVE_XCB_SYNC
+        /* Window manager waits for frame of new size during resize */
+        if (atoms[ATOM_NET_WM_SYNC_REQUEST] != XCB_ATOM_NONE
+                && window_init_sync (window,
+                                     atoms[ATOM_NET_WM_SYNC_REQUEST_COUNTER])) {
+            window->wm_sync_request = atoms[ATOM_NET_WM_SYNC_REQUEST];
+            protocols[protocol_count++] = window->wm_sync_request;
+        }
+#endif
+#ifdef HAVE_XCB_XINPUT
+        /* Raw events are selected on root, so only first window takes them */
+        window->xinput_opcode = 0;
+        if (window_count == 0) {
+            window_init_xinput (window, screen->root);
+        }
+#endif
+        if (atoms[ATOM_WM_PROTOCOLS] != XCB_ATOM_NONE && protocol_count > 0) {
+            xcb_change_property (connection, XCB_PROP_MODE_REPLACE,
+                                 window->window_id, atoms[ATOM_WM_PROTOCOLS],
+                                 XCB_ATOM_ATOM, 32, protocol_count, protocols);
+        }
+        if (fullscreen && atoms[ATOM_NET_WM_STATE] != XCB_ATOM_NONE
+                && atoms[ATOM_NET_WM_STATE_FULLSCREEN] != XCB_ATOM_NONE) {
+            /* State of unmapped window is set directly, without message */
+            xcb_change_property (connection, XCB_PROP_MODE_REPLACE,
+                                 window->window_id, atoms[ATOM_NET_WM_STATE],
+                                 XCB_ATOM_ATOM, 32, 1,
+                                 &atoms[ATOM_NET_WM_STATE_FULLSCREEN]);
+        }
+        if (fullscreen && atoms[ATOM_NET_WM_BYPASS_COMPOSITOR] != XCB_ATOM_NONE) {
+            /* 1 asks compositor to unredirect the window */
+            const uint32_t bypass = 1;
+            xcb_change_property (connection, XCB_PROP_MODE_REPLACE,
+                                 window->window_id,
+                                 atoms[ATOM_NET_WM_BYPASS_COMPOSITOR],
+                                 XCB_ATOM_CARDINAL, 32, 1, &bypass);
+        }
         xcb_map_window (connection, window->window_id);
         xcb_flush (connection);
     }
     return window;
 }
 
+/** Parse non-negative number given as value of option
+ * @param arg value of option
+ * @param name name of option to report errors with
+ */
+static uint32_t parse_count (const char *arg, const char *name)
+{
+    char *end = NULL;
+    unsigned long value = 0;
+    errno = 0;
+    value = strtoul (arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0' || arg[0] == '-'
+            || value > UINT32_MAX) {
+        fprintf (stderr, "%s: invalid value of --%s: '%s'\n", program_name,
+                 name, arg);
+        exit (EXIT_FAILURE);
+    }
+    return (uint32_t)value;
+}
+
 /** Parse command-line arguments
  * @param argc number of arguments passed to main()
  * @param argv array of arguments passed to main()
@@ -202,6 +1348,9 @@ static game_window_t *window_create (xcb_connection_t *connection,
 static void parse_args (int argc, char *const *argv)
 {
     int opt;
+    /* Options that only make sense with --benchmark */
+    const char *benchmark_option = NULL;
+    int has_output = 0;
     program_name = argv[0];
     while ((opt = getopt_long (argc, argv, "hV", long_options, NULL)) != -1) {
         switch (opt) {
@@ -214,15 +1363,85 @@ static void parse_args (int argc, char *const *argv)
             case 'v':
                 verbose = 1;
                 break;
-            default:
-                print_usage ();
-                exit (EXIT_FAILURE);
-        }
-    }
-}
-
-static void
-print_device_properties (uint32_t index, VkPhysicalDeviceProperties *properties)
+            case PIPELINE_STATISTICS_OPTION:
+                pipeline_statistics = 1;
+                break;
+            case BENCHMARK_OPTION:
+                benchmark_mode = 1;
+                break;
+            case FRAMES_OPTION:
+                benchmark_frames = parse_count (optarg, "frames");
+                benchmark_option = "frames";
+                break;
+            case WARMUP_OPTION:
+                benchmark_warmup = parse_count (optarg, "warmup");
+                benchmark_option = "warmup";
+                break;
+            case OUTPUT_OPTION:
+                benchmark_output = optarg;
+                has_output = 1;
+                break;
+            case TRACE_OPTION:
+                trace_output = optarg;
+                break;
+            case LIVE_METRICS_OPTION:
+                live_metrics_mode = 1;
+                break;
+            case HEADLESS_OPTION:
+                headless_mode = 1;
+                break;
+            case MICROBENCH_OPTION:
+                if (!microbench_is_known (optarg)) {
+                    fprintf (stderr, "%s: unknown microbenchmark '%s'\n",
+                             program_name, optarg);
+                    exit (EXIT_FAILURE);
+                }
+                microbench_name = optarg;
+                break;
+            case SOFTWARE_OPTION:
+#ifndef HAVE_XCB_SHM
+                fprintf (stderr, "%s: software rendering is not compiled in\n",
+                         program_name);
+                exit (EXIT_FAILURE);
+#endif
+                software_mode = 1;
+                break;
+            case FULLSCREEN_OPTION:
+                fullscreen_mode = 1;
+                break;
+            case TRANSPARENT_OPTION:
+                transparent_mode = 1;
+                break;
+            case DEEP_COLOR_OPTION:
+                deep_color_mode = 1;
+                break;
+            case WINDOWS_OPTION:
+                view_count = parse_count (optarg, "windows");
+                if (view_count == 0 || view_count > MAX_WINDOWS) {
+                    fprintf (stderr, "%s: --windows must be from 1 to %d\n",
+                             program_name, MAX_WINDOWS);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            default:
+                print_usage ();
+                exit (EXIT_FAILURE);
+        }
+    }
+    if (!benchmark_mode && benchmark_option != NULL) {
+        fprintf (stderr, "%s: --%s needs --benchmark\n", program_name,
+                 benchmark_option);
+        exit (EXIT_FAILURE);
+    }
+    if (!benchmark_mode && has_output && microbench_name == NULL) {
+        fprintf (stderr, "%s: --output needs --benchmark or --microbench\n",
+                 program_name);
+        exit (EXIT_FAILURE);
+    }
+}
+
+static void
+print_device_properties (uint32_t index, VkPhysicalDeviceProperties *properties)
 {
     const char *const deviceTypes[] = {
         "other",
@@ -269,12 +1488,93 @@ print_device_queues (uint32_t queueFamilyCount,
     }
 }
 
+#ifdef VK_KHR_present_wait
+/** Check if physical device provides device extension */
+static int
+has_device_extension (VkPhysicalDevice physicalDevice, const char *name)
+{
+    VkExtensionProperties extensions[MAX_DEVICE_EXTENSIONS];
+    uint32_t extensionCount = MAX_DEVICE_EXTENSIONS;
+    VkResult result = vkEnumerateDeviceExtensionProperties (physicalDevice,
+                      NULL, &extensionCount, extensions);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < extensionCount; i++) {
+        if (strcmp (extensions[i].extensionName, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Check if physical device can wait for presentation of frames
+ * @param vk instance with VK_KHR_get_physical_device_properties2 enabled
+ * @param physicalDevice device to check
+ * @param pFeatures present wait features chained to present ID features,
+ *        receive features supported by @a physicalDevice
+ * @returns non-zero if both present ID and present wait are supported
+ */
+static int
+has_present_wait (VkInstance vk, VkPhysicalDevice physicalDevice,
+                  VkPhysicalDevicePresentWaitFeaturesKHR *pFeatures)
+{
+    const VkPhysicalDevicePresentIdFeaturesKHR *presentIdFeatures =
+        (const VkPhysicalDevicePresentIdFeaturesKHR *)pFeatures->pNext;
+    VkPhysicalDeviceFeatures2KHR features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+        .pNext = pFeatures,
+    };
+    PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 =
+        (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr (vk,
+                "vkGetPhysicalDeviceFeatures2KHR");
+    if (getFeatures2 == NULL
+            || !has_device_extension (physicalDevice,
+                                      VK_KHR_PRESENT_ID_EXTENSION_NAME)
+            || !has_device_extension (physicalDevice,
+                                      VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        return 0;
+    }
+    getFeatures2 (physicalDevice, &features);
+    return pFeatures->presentWait && presentIdFeatures->presentId;
+}
+#endif
+
+/** Pick physical device and create logical device on it
+ * @param vk vulkan instance
+ * @param enableSwapchain non-zero if device will present to surface
+ * @param hasProperties2 non-zero if @a vk has
+ *        VK_KHR_get_physical_device_properties2 enabled
+ * @param pPhysicalDevice receives chosen physical device
+ * @param pProperties receives properties of chosen physical device
+ * @param pEnabledFeatures receives features enabled on created device
+ * @param pHasPresentWait receives non-zero if device has present ID and
+ *        present wait enabled
+ * @param pDevice receives created device
+ */
 static VkResult
-create_device (VkInstance vk, VkPhysicalDevice *pPhysicalDevice,
-               VkDevice *pDevice)
+create_device (VkInstance vk, int enableSwapchain, int hasProperties2,
+               VkPhysicalDevice *pPhysicalDevice,
+               VkPhysicalDeviceProperties *pProperties,
+               VkPhysicalDeviceFeatures *pEnabledFeatures,
+               int *pHasPresentWait, VkDevice *pDevice)
 {
-    uint32_t enabledDeviceExtensionCount = 1;
-    const char *const ppEnabledDeviceExtensionNames[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    VkPhysicalDeviceFeatures supportedFeatures;
+#ifdef VK_KHR_present_wait
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = NULL,
+        .presentId = VK_FALSE,
+    };
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+        .pNext = &presentIdFeatures,
+        .presentWait = VK_FALSE,
+    };
+#endif
+    const char *ppEnabledDeviceExtensionNames[MAX_ENABLED_DEVICE_EXTENSIONS] = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME
+    };
     uint32_t queueFamilyIndex = 0;
     float queuePriorities[] = {1.0f};
     VkPhysicalDeviceProperties properties;
@@ -297,9 +1597,9 @@ create_device (VkInstance vk, VkPhysicalDevice *pPhysicalDevice,
         .pQueueCreateInfos = pQueueCreateInfos,
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = NULL,
-        .enabledExtensionCount = enabledDeviceExtensionCount,
+        .enabledExtensionCount = enableSwapchain ? 1 : 0,
         .ppEnabledExtensionNames = ppEnabledDeviceExtensionNames,
-        .pEnabledFeatures = NULL,
+        .pEnabledFeatures = pEnabledFeatures,
     };
     uint32_t physicalDeviceCount = MAX_PHYSICAL_DEVICES;
     VkPhysicalDevice physicalDevices[MAX_PHYSICAL_DEVICES];
@@ -308,6 +1608,10 @@ create_device (VkInstance vk, VkPhysicalDevice *pPhysicalDevice,
     if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
         goto out;
     }
+    if (physicalDeviceCount == 0) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+        goto out;
+    }
     for (uint32_t i = 0; i < physicalDeviceCount; i++) {
         vkGetPhysicalDeviceProperties (physicalDevices[i], &properties);
         if (verbose) {
@@ -321,6 +1625,47 @@ create_device (VkInstance vk, VkPhysicalDevice *pPhysicalDevice,
     }
     /* TODO: We are just getting first physical device */
     *pPhysicalDevice = physicalDevices[0];
+    vkGetPhysicalDeviceProperties (*pPhysicalDevice, pProperties);
+    /* Renderer submits everything to first queue of the first family */
+    queuePrioritiesCount = MAX_QUEUE_FAMILY_PROPERTIES;
+    vkGetPhysicalDeviceQueueFamilyProperties (*pPhysicalDevice,
+            &queuePrioritiesCount, queueFamilyProperties);
+    if (queuePrioritiesCount <= queueFamilyIndex
+            || (queueFamilyProperties[queueFamilyIndex].queueFlags
+                & VK_QUEUE_GRAPHICS_BIT) == 0) {
+        fprintf (stderr, "%s: queue family %u doesn't support graphics\n",
+                 program_name, queueFamilyIndex);
+        result = VK_ERROR_FEATURE_NOT_PRESENT;
+        goto out;
+    }
+    vkGetPhysicalDeviceFeatures (*pPhysicalDevice, &supportedFeatures);
+    memset (pEnabledFeatures, 0, sizeof (*pEnabledFeatures));
+    if (pipeline_statistics) {
+        /* Views are drawn by secondary command buffers inside the pass */
+        if (supportedFeatures.pipelineStatisticsQuery
+                && supportedFeatures.inheritedQueries) {
+            pEnabledFeatures->pipelineStatisticsQuery = VK_TRUE;
+            pEnabledFeatures->inheritedQueries = VK_TRUE;
+        } else {
+            fprintf (stderr, "%s: pipeline statistics are not supported\n",
+                     program_name);
+        }
+    }
+    *pHasPresentWait = 0;
+#ifdef VK_KHR_present_wait
+    /* Present wait is only used to measure latency of benchmark */
+    if (enableSwapchain && hasProperties2 && benchmark_mode
+            && has_present_wait (vk, *pPhysicalDevice, &presentWaitFeatures)) {
+        deviceCreateInfo.pNext = &presentWaitFeatures;
+        ppEnabledDeviceExtensionNames[deviceCreateInfo.enabledExtensionCount++] =
+            VK_KHR_PRESENT_ID_EXTENSION_NAME;
+        ppEnabledDeviceExtensionNames[deviceCreateInfo.enabledExtensionCount++] =
+            VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+        *pHasPresentWait = 1;
+    }
+#else
+    (void)hasProperties2;
+#endif
     return vkCreateDevice (*pPhysicalDevice, &deviceCreateInfo, NULL, pDevice);
 out:
     return result;
@@ -392,6 +1737,172 @@ get_vulkan_error_string (VkResult result)
     return NULL;
 }
 
+/** Surface formats in order of preference
+ *
+ * X11 drivers usually scan out BGRA, presenting RGBA may cost a swizzle.
+ * Formats without sRGB variant get colors encoded by triangle.frag and
+ * record_frame(), see is_srgb_format().
+ */
+static const VkSurfaceFormatKHR preferred_surface_formats[] = {
+    {VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+    {VK_FORMAT_A2R10G10B10_UNORM_PACK32, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+    {VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+    {VK_FORMAT_R8G8B8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+    {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+    {VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+};
+
+/** Check if images of format encode linear colors written to them */
+static int
+is_srgb_format (VkFormat format)
+{
+    return format == VK_FORMAT_B8G8R8A8_SRGB
+           || format == VK_FORMAT_R8G8B8A8_SRGB
+           || format == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+}
+
+/** Encode linear color channel with sRGB curve, as triangle.frag does */
+static float
+encode_srgb (float linear)
+{
+    if (linear < 0.0031308f) {
+        return linear * 12.92f;
+    }
+    return 1.055f * powf (linear, 1.0f / 2.4f) - 0.055f;
+}
+
+/** Choose format of swapchain images
+ * @param physicalDevice device that presents to @a surface
+ * @param surface surface to present to, VK_NULL_HANDLE for offscreen images
+ * @param deepColor non-zero to prefer 10 bits per color channel
+ * @param pFormat receives chosen format; if none of
+ *        preferred_surface_formats is supported, the first one in sRGB
+ *        color space, or the first one at all
+ */
+static VkResult
+choose_surface_format (VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
+                       int deepColor, VkSurfaceFormatKHR *pFormat)
+{
+    VkSurfaceFormatKHR formats[MAX_SURFACE_FORMATS];
+    uint32_t formatCount = MAX_SURFACE_FORMATS;
+    const size_t first = deepColor ? 0 : DEEP_COLOR_FORMAT_COUNT;
+    VkResult result = VK_SUCCESS;
+    *pFormat = preferred_surface_formats[first];
+    if (surface == VK_NULL_HANDLE) {
+        return VK_SUCCESS;
+    }
+    result = vkGetPhysicalDeviceSurfaceFormatsKHR (physicalDevice, surface,
+             &formatCount, formats);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        return result;
+    }
+    if (formatCount == 0) {
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+    /* Single undefined format means that surface takes any format */
+    if (formatCount == 1 && formats[0].format == VK_FORMAT_UNDEFINED) {
+        return VK_SUCCESS;
+    }
+    for (size_t i = first; i < sizeof (preferred_surface_formats)
+            / sizeof (preferred_surface_formats[0]); i++) {
+        for (uint32_t j = 0; j < formatCount; j++) {
+            if (formats[j].format == preferred_surface_formats[i].format
+                    && formats[j].colorSpace
+                    == preferred_surface_formats[i].colorSpace) {
+                *pFormat = formats[j];
+                return VK_SUCCESS;
+            }
+        }
+    }
+    /* Colors are encoded for sRGB only, see renderer_init() */
+    for (uint32_t i = 0; i < formatCount; i++) {
+        if (formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            *pFormat = formats[i];
+            return VK_SUCCESS;
+        }
+    }
+    *pFormat = formats[0];
+    return VK_SUCCESS;
+}
+
+/** Get name of the way images of swapchain reach the screen */
+static const char *
+get_swapchain_mode_string (const swapchain_t *swapchain)
+{
+    if (swapchain->is_offscreen) {
+        return "offscreen";
+    }
+    return get_present_mode_string (swapchain->presentMode);
+}
+
+#if defined (VK_EXT_headless_surface) || defined (VK_KHR_present_wait)
+/** Check if loader or any of implicit layers provide instance extension */
+static int
+has_instance_extension (const char *name)
+{
+    VkExtensionProperties extensions[MAX_INSTANCE_EXTENSIONS];
+    uint32_t extensionCount = MAX_INSTANCE_EXTENSIONS;
+    VkResult result = vkEnumerateInstanceExtensionProperties (NULL,
+                      &extensionCount, extensions);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < extensionCount; i++) {
+        if (strcmp (extensions[i].extensionName, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
+/** Create instance with extensions needed to present frames
+ *
+ * Headless instance enables VK_EXT_headless_surface where supported,
+ * otherwise it has no surface extensions at all.
+ * @param headless non-zero if there is no X server to present to
+ * @param pHasSurface receives non-zero if instance can create surface
+ * @param pHasProperties2 receives non-zero if instance has
+ *        VK_KHR_get_physical_device_properties2 enabled
+ * @param pInstance receives created instance
+ */
+static VkResult
+create_instance (int headless, int *pHasSurface, int *pHasProperties2,
+                 VkInstance *pInstance)
+{
+    VkInstanceCreateInfo createInfo = instanceCreateInfo;
+#ifdef VK_KHR_present_wait
+    const char *extensions[MAX_ENABLED_INSTANCE_EXTENSIONS];
+#endif
+    *pHasSurface = !headless;
+    *pHasProperties2 = 0;
+    if (headless) {
+        createInfo.enabledExtensionCount = 0;
+        createInfo.ppEnabledExtensionNames = NULL;
+#ifdef VK_EXT_headless_surface
+        if (has_instance_extension (VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME)) {
+            createInfo.enabledExtensionCount = 2;
+            createInfo.ppEnabledExtensionNames = ppHeadlessInstanceExtensionNames;
+            *pHasSurface = 1;
+        }
+#endif
+    }
+#ifdef VK_KHR_present_wait
+    /* Features of present wait can only be queried through properties2 */
+    if (has_instance_extension (
+                VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+        for (uint32_t i = 0; i < createInfo.enabledExtensionCount; i++) {
+            extensions[i] = createInfo.ppEnabledExtensionNames[i];
+        }
+        extensions[createInfo.enabledExtensionCount++] =
+            VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+        createInfo.ppEnabledExtensionNames = extensions;
+        *pHasProperties2 = 1;
+    }
+#endif
+    return vkCreateInstance (&createInfo, NULL, pInstance);
+}
+
 static VkResult
 create_surface (xcb_connection_t *connection, xcb_window_t window,
                 VkInstance vk,
@@ -407,24 +1918,68 @@ create_surface (xcb_connection_t *connection, xcb_window_t window,
     return vkCreateXcbSurfaceKHR (vk, &SurfaceCreateInfo, NULL, surface);
 }
 
+/** Create surface that has no window, see create_instance() */
+static VkResult
+create_headless_surface (VkInstance vk, VkSurfaceKHR *surface)
+{
+#ifdef VK_EXT_headless_surface
+    const VkHeadlessSurfaceCreateInfoEXT surfaceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT,
+        .pNext = NULL,
+        .flags = 0,
+    };
+    /* Loader may be older than headers, so entry point is looked up */
+    PFN_vkCreateHeadlessSurfaceEXT createHeadlessSurface =
+        (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr (vk,
+                "vkCreateHeadlessSurfaceEXT");
+    if (createHeadlessSurface != NULL) {
+        return createHeadlessSurface (vk, &surfaceCreateInfo, NULL, surface);
+    }
+#else
+    (void)vk;
+    (void)surface;
+#endif
+    return VK_ERROR_EXTENSION_NOT_PRESENT;
+}
+
+/** Create swapchain for surface
+ * @param surfaceFormat format of images, see choose_surface_format()
+ * @param pExtent desired size of images, receives the actual size
+ * @param hasAlpha non-zero if window of @a surface has alpha channel,
+ *        images are then blended with premultiplied alpha if supported
+ * @param oldSwapchain swapchain being replaced, or VK_NULL_HANDLE
+ * @param pPresentMode receives chosen present mode
+ * @param pCompositeAlpha receives chosen way of compositing images
+ */
 static VkResult
 create_swapchain (VkPhysicalDevice physicalDevice, VkDevice device,
-                  VkSurfaceKHR surface, VkSwapchainKHR *swapchain)
+                  VkSurfaceKHR surface, const VkSurfaceFormatKHR *surfaceFormat,
+                  VkExtent2D *pExtent, int hasAlpha,
+                  VkSwapchainKHR oldSwapchain, VkPresentModeKHR *pPresentMode,
+                  VkCompositeAlphaFlagBitsKHR *pCompositeAlpha,
+                  VkSwapchainKHR *swapchain)
 {
     VkSurfaceCapabilitiesKHR SurfaceCapabilities = {0};
     VkResult result = VK_SUCCESS;
     uint32_t presentModeCount = 100;
     VkPresentModeKHR presentModes[100];
     const uint32_t QueueFamilyIndeces[] = {0};
+    /* In order of preference */
+    const VkCompositeAlphaFlagBitsKHR compositeAlphas[] = {
+        VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR,
+        VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+        VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+        VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR,
+    };
     VkSwapchainCreateInfoKHR SwapchainCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
         .pNext = NULL,
         .flags = 0,
         .surface = surface,
         .minImageCount = 2,
-        .imageFormat = VK_FORMAT_R8G8B8A8_SRGB,
-        .imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
-        .imageExtent = {.width = 640, .height = 480},
+        .imageFormat = surfaceFormat->format,
+        .imageColorSpace = surfaceFormat->colorSpace,
+        .imageExtent = *pExtent,
         .imageArrayLayers = 1,
         .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
         .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
@@ -434,7 +1989,7 @@ create_swapchain (VkPhysicalDevice physicalDevice, VkDevice device,
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = VK_PRESENT_MODE_FIFO_KHR,
         .clipped = VK_TRUE,
-        .oldSwapchain = NULL,
+        .oldSwapchain = oldSwapchain,
     };
     result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR (physicalDevice, surface,
              &SurfaceCapabilities);
@@ -533,25 +2088,45 @@ create_swapchain (VkPhysicalDevice physicalDevice, VkDevice device,
             printf ("inherit ");
         }
         printf ("\n");
+        printf ("supportedCompositeAlpha: 0x%x\n",
+                SurfaceCapabilities.supportedCompositeAlpha);
         /*
-            VkCompositeAlphaFlagsKHR         supportedCompositeAlpha;
             VkImageUsageFlags                supportedUsageFlags;
             */
     }
+    /* Opaque images let compositor skip blending, alpha is only used when
+     * window has 32-bit visual that can carry it */
+    for (size_t i = hasAlpha ? 0 : 1;
+            i < sizeof (compositeAlphas) / sizeof (compositeAlphas[0]); i++) {
+        if (SurfaceCapabilities.supportedCompositeAlpha & compositeAlphas[i]) {
+            SwapchainCreateInfo.compositeAlpha = compositeAlphas[i];
+            break;
+        }
+    }
+    if (hasAlpha && verbose && SwapchainCreateInfo.compositeAlpha
+            != VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR) {
+        printf ("Surface doesn't blend premultiplied alpha, "
+                "frames are opaque\n");
+    }
+    *pCompositeAlpha = SwapchainCreateInfo.compositeAlpha;
     if (SwapchainCreateInfo.minImageCount < SurfaceCapabilities.minImageCount) {
         SwapchainCreateInfo.minImageCount = SurfaceCapabilities.minImageCount;
-    } else if (SwapchainCreateInfo.minImageCount >
+    } else if (SurfaceCapabilities.maxImageCount != 0
+               && SwapchainCreateInfo.minImageCount >
                SurfaceCapabilities.maxImageCount) {
         SwapchainCreateInfo.minImageCount = SurfaceCapabilities.maxImageCount;
     }
-    //SwapchainCreateInfo.imageExtent = SurfaceCapabilities.currentExtent;
-
-    /*
-    if (SurfaceCapabilities.currentExtent.width != -1
-            && SurfaceCapabilities.currentExtent.height != -1) {
+    if (SwapchainCreateInfo.minImageCount > MAX_SWAPCHAIN_IMAGES) {
+        fprintf (stderr, "%s: surface needs %u swapchain images, at most %d "
+                 "are supported\n", program_name,
+                 SwapchainCreateInfo.minImageCount, MAX_SWAPCHAIN_IMAGES);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    if (SurfaceCapabilities.currentExtent.width != UINT32_MAX
+            && SurfaceCapabilities.currentExtent.height != UINT32_MAX) {
         SwapchainCreateInfo.imageExtent = SurfaceCapabilities.currentExtent;
     }
-    */
+    *pExtent = SwapchainCreateInfo.imageExtent;
     result = vkGetPhysicalDeviceSurfacePresentModesKHR (physicalDevice, surface,
              &presentModeCount, presentModes);
     if (result != VK_SUCCESS) {
@@ -569,72 +2144,1919 @@ create_swapchain (VkPhysicalDevice physicalDevice, VkDevice device,
             SwapchainCreateInfo.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
         }
     }
+    *pPresentMode = SwapchainCreateInfo.presentMode;
     return vkCreateSwapchainKHR (device, &SwapchainCreateInfo, NULL, swapchain);
 }
 
-int main (int argc, char *const *argv)
+/** Create render pass that clears image and draws to it
+ * @param finalLayout layout image is left in for presentation or readback
+ */
+static VkResult
+create_render_pass (VkDevice device, VkFormat format, VkImageLayout finalLayout,
+                    VkRenderPass *renderPass)
+{
+    const VkAttachmentDescription attachments[] = {{
+            .flags = 0,
+            .format = format,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = finalLayout,
+        }
+    };
+    const VkAttachmentReference colorAttachments[] = {{
+            .attachment = 0,
+            .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        }
+    };
+    const VkSubpassDescription subpasses[] = {{
+            .flags = 0,
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+            .inputAttachmentCount = 0,
+            .pInputAttachments = NULL,
+            .colorAttachmentCount = 1,
+            .pColorAttachments = colorAttachments,
+            .pResolveAttachments = NULL,
+            .pDepthStencilAttachment = NULL,
+            .preserveAttachmentCount = 0,
+            .pPreserveAttachments = NULL,
+        }
+    };
+    /* Image is acquired at COLOR_ATTACHMENT_OUTPUT stage, see draw_frame() */
+    const VkSubpassDependency dependencies[] = {{
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dependencyFlags = 0,
+        }
+    };
+    const VkRenderPassCreateInfo renderPassCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .attachmentCount = 1,
+        .pAttachments = attachments,
+        .subpassCount = 1,
+        .pSubpasses = subpasses,
+        .dependencyCount = 1,
+        .pDependencies = dependencies,
+    };
+    return vkCreateRenderPass (device, &renderPassCreateInfo, NULL, renderPass);
+}
+
+/** Destroy image views and framebuffers of swapchain, but not swapchain itself
+ *
+ * Offscreen images are destroyed too, since they aren't owned by swapchain.
+ * @param device device that owns the swapchain
+ * @param swapchain swapchain which images should be released
+ */
+static void
+destroy_swapchain_images (VkDevice device, swapchain_t *swapchain)
+{
+    for (uint32_t i = 0; i < swapchain->image_count; i++) {
+        vkDestroyFramebuffer (device, swapchain->framebuffers[i], NULL);
+        vkDestroyImageView (device, swapchain->views[i], NULL);
+        swapchain->framebuffers[i] = VK_NULL_HANDLE;
+        swapchain->views[i] = VK_NULL_HANDLE;
+    }
+    swapchain->image_count = 0;
+    if (swapchain->is_offscreen) {
+        /* Image may be created without views if later step has failed */
+        for (uint32_t i = 0; i < MAX_SWAPCHAIN_IMAGES; i++) {
+            vkDestroyImage (device, swapchain->images[i], NULL);
+            vkFreeMemory (device, swapchain->memory[i], NULL);
+            swapchain->images[i] = VK_NULL_HANDLE;
+            swapchain->memory[i] = VK_NULL_HANDLE;
+        }
+    }
+}
+
+/** Create image view and framebuffer for each image of swapchain
+ * @param imageCount number of images in swapchain->images
+ */
+static VkResult
+create_swapchain_framebuffers (VkDevice device, VkRenderPass renderPass,
+                               uint32_t imageCount, swapchain_t *swapchain)
 {
-    int error = EXIT_SUCCESS;
-    xcb_connection_t *connection = NULL;
-    VkInstance vk = VK_NULL_HANDLE;
-    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-    VkDevice device = VK_NULL_HANDLE;
-    VkQueue queue = VK_NULL_HANDLE;
-    VkSurfaceKHR surface = VK_NULL_HANDLE;
-    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
     VkResult result = VK_SUCCESS;
-    parse_args (argc, argv);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VkImageViewCreateInfo imageViewCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .image = swapchain->images[i],
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = swapchain->format,
+            .components = {
+                VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY
+            },
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+        VkFramebufferCreateInfo framebufferCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .renderPass = renderPass,
+            .attachmentCount = 1,
+            .pAttachments = &swapchain->views[i],
+            .width = swapchain->extent.width,
+            .height = swapchain->extent.height,
+            .layers = 1,
+        };
+        swapchain->image_count = i;
+        result = vkCreateImageView (device, &imageViewCreateInfo, NULL,
+                                    &swapchain->views[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        swapchain->image_count = i + 1;
+        result = vkCreateFramebuffer (device, &framebufferCreateInfo, NULL,
+                                      &swapchain->framebuffers[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    swapchain->image_count = imageCount;
+    return VK_SUCCESS;
+}
 
-    connection = xcb_connect (NULL, NULL);
-    if (connection == NULL) {
-        fprintf (stderr, "%s: can't connect to X server\n", program_name);
-        error = EXIT_FAILURE;
-        goto out;
+/** Get images of swapchain and create image view and framebuffer for each */
+static VkResult
+create_swapchain_images (VkDevice device, VkRenderPass renderPass,
+                         swapchain_t *swapchain)
+{
+    uint32_t imageCount = MAX_SWAPCHAIN_IMAGES;
+    VkResult result = vkGetSwapchainImagesKHR (device, swapchain->handle,
+                      &imageCount, swapchain->images);
+    if (result == VK_INCOMPLETE) {
+        /* Image index could point past framebuffers otherwise */
+        fprintf (stderr, "%s: swapchain has more than %d images\n",
+                 program_name, MAX_SWAPCHAIN_IMAGES);
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    return create_swapchain_framebuffers (device, renderPass, imageCount,
+                                          swapchain);
+}
 
-    main_window = window_create (connection, "Vulkan Window", 640, 480);
-    if (main_window == NULL) {
-        fprintf (stderr, "%s: can't create game window\n", program_name);
-        error = EXIT_FAILURE;
-        goto out;
+/** Find memory type allowed by @a typeBits that has all @a flags
+ * @returns index of memory type, UINT32_MAX if there is none
+ */
+static uint32_t
+find_memory_type (const VkPhysicalDeviceMemoryProperties *properties,
+                  uint32_t typeBits, VkMemoryPropertyFlags flags)
+{
+    for (uint32_t i = 0; i < properties->memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) != 0
+                && (properties->memoryTypes[i].propertyFlags & flags) == flags) {
+            return i;
+        }
     }
-    if (vkCreateInstance (&instanceCreateInfo, NULL, &vk)) {
-        fprintf (stderr, "%s: can't load vulkan\n", program_name);
-        error = EXIT_FAILURE;
-        goto out;
+    return UINT32_MAX;
+}
+
+/** Create one image per frame in flight to render to without swapchain
+ *
+ * Frame renders to the image of its index, which is free once fence of the
+ * frame has signalled, so nothing needs to be acquired.
+ */
+static VkResult
+create_offscreen_images (VkPhysicalDevice physicalDevice, VkDevice device,
+                         VkRenderPass renderPass, swapchain_t *swapchain)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    const VkImageCreateInfo imageCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = swapchain->format,
+        .extent = {swapchain->extent.width, swapchain->extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    VkResult result = VK_SUCCESS;
+    vkGetPhysicalDeviceMemoryProperties (physicalDevice, &memoryProperties);
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        VkMemoryRequirements requirements;
+        VkMemoryAllocateInfo memoryAllocateInfo = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = NULL,
+            .allocationSize = 0,
+            .memoryTypeIndex = 0,
+        };
+        result = vkCreateImage (device, &imageCreateInfo, NULL,
+                                &swapchain->images[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        vkGetImageMemoryRequirements (device, swapchain->images[i],
+                                      &requirements);
+        memoryAllocateInfo.allocationSize = requirements.size;
+        memoryAllocateInfo.memoryTypeIndex = find_memory_type (&memoryProperties,
+                                             requirements.memoryTypeBits,
+                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX) {
+            /* Software implementations may have no device local memory */
+            memoryAllocateInfo.memoryTypeIndex = find_memory_type (
+                    &memoryProperties, requirements.memoryTypeBits, 0);
+        }
+        if (memoryAllocateInfo.memoryTypeIndex == UINT32_MAX) {
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+        result = vkAllocateMemory (device, &memoryAllocateInfo, NULL,
+                                   &swapchain->memory[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        result = vkBindImageMemory (device, swapchain->images[i],
+                                    swapchain->memory[i], 0);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
     }
-    if ((result = create_device (vk, &physicalDevice, &device))) {
-        fprintf (stderr, "%s: can't create vulkan device: %s\n", program_name,
-                 get_vulkan_error_string (result));
-        error = EXIT_FAILURE;
-        goto out;
+    return create_swapchain_framebuffers (device, renderPass, FRAMES_IN_FLIGHT,
+                                          swapchain);
+}
+
+/** Create or recreate swapchain of view with size requested by view
+ * @param renderer renderer that owns the view, GPU must be idle
+ * @param view view to resize
+ */
+static VkResult
+view_resize (renderer_t *renderer, view_t *view)
+{
+    swapchain_t *swapchain = &view->swapchain;
+    VkSwapchainKHR oldSwapchain = swapchain->handle;
+    VkResult result = VK_SUCCESS;
+    destroy_swapchain_images (renderer->device, swapchain);
+    swapchain->handle = VK_NULL_HANDLE;
+    swapchain->extent = view->extent;
+    swapchain->format = renderer->surfaceFormat.format;
+    if (view->surface == VK_NULL_HANDLE) {
+        swapchain->is_offscreen = 1;
+        swapchain->compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        result = create_offscreen_images (renderer->physicalDevice,
+                                          renderer->device, renderer->renderPass,
+                                          swapchain);
+    } else {
+        result = create_swapchain (renderer->physicalDevice, renderer->device,
+                                   view->surface, &renderer->surfaceFormat,
+                                   &swapchain->extent, renderer->hasAlpha,
+                                   oldSwapchain,
+                                   &swapchain->presentMode,
+                                   &swapchain->compositeAlpha,
+                                   &swapchain->handle);
+        present_latency_release_swapchain (renderer->latency, oldSwapchain);
+        vkDestroySwapchainKHR (renderer->device, oldSwapchain, NULL);
+        if (result == VK_SUCCESS) {
+            result = create_swapchain_images (renderer->device,
+                                              renderer->renderPass, swapchain);
+        }
     }
-    if ((result = create_surface (connection, window_get_native (main_window), vk,
-                                  &surface))) {
-        fprintf (stderr, "%s: can't create surface: %s\n", program_name,
-                 get_vulkan_error_string (result));
-        error = EXIT_FAILURE;
-        goto out;
+    flight_recorder_record (FLIGHT_EVENT_SWAPCHAIN, renderer->frame_number,
+                            result, swapchain->extent.width,
+                            swapchain->extent.height, swapchain->image_count);
+    return result;
+}
+
+/** Recreate swapchains of views that are out of date
+ * @param renderer target renderer
+ */
+static VkResult
+renderer_resize (renderer_t *renderer)
+{
+    VkResult result = VK_SUCCESS;
+    int isBusy = 0;
+    for (uint32_t i = 0; i < renderer->viewCount; i++) {
+        const view_t *view = &renderer->views[i];
+        isBusy |= view->isOutOfDate && view->swapchain.image_count > 0;
     }
-    vkGetDeviceQueue (device, 0, 0, &queue);
-    if ((result = create_swapchain (physicalDevice, device, surface, &swapchain))) {
-        fprintf (stderr, "%s: can't create swapchain: %s\n", program_name,
-                 get_vulkan_error_string (result));
-        error = EXIT_FAILURE;
-        goto out;
+    if (isBusy) {
+        /* Images of old swapchains may still be rendered to */
+        result = vkDeviceWaitIdle (renderer->device);
+    }
+    for (uint32_t i = 0; i < renderer->viewCount
+            && result == VK_SUCCESS; i++) {
+        view_t *view = &renderer->views[i];
+        if (view->isOutOfDate) {
+            result = view_resize (renderer, view);
+            view->isOutOfDate = result != VK_SUCCESS;
+        }
+    }
+    return result;
+}
 
+static VkResult
+create_frame (VkDevice device, uint32_t queueFamilyIndex, frame_t *frame)
+{
+    const VkCommandPoolCreateInfo commandPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = queueFamilyIndex,
+    };
+    const VkSemaphoreCreateInfo semaphoreCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+    /* Fence is signalled so the first wait on it doesn't block */
+    const VkFenceCreateInfo fenceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+    };
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = VK_NULL_HANDLE,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    VkResult result = vkCreateCommandPool (device, &commandPoolCreateInfo, NULL,
+                                           &frame->commandPool);
+    if (result != VK_SUCCESS) {
+        return result;
     }
-    while (window_is_exists (main_window)) {
-        window_process_events (main_window);
-        /*game_tick();*/
-        /* eglSwapBuffers (egl_display, window_surface);*/
+    commandBufferAllocateInfo.commandPool = frame->commandPool;
+    result = vkAllocateCommandBuffers (device, &commandBufferAllocateInfo,
+                                       &frame->commandBuffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkCreateSemaphore (device, &semaphoreCreateInfo, NULL,
+                                &frame->renderFinished);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    return vkCreateFence (device, &fenceCreateInfo, NULL, &frame->fence);
+}
+
+static void
+destroy_frame (VkDevice device, frame_t *frame)
+{
+    vkDestroyFence (device, frame->fence, NULL);
+    vkDestroySemaphore (device, frame->renderFinished, NULL);
+    vkDestroyCommandPool (device, frame->commandPool, NULL);
+}
+
+/** Create command buffers and semaphores of view for each frame in flight */
+static VkResult
+create_view (VkDevice device, uint32_t queueFamilyIndex, view_t *view)
+{
+    const VkCommandPoolCreateInfo commandPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = queueFamilyIndex,
+    };
+    const VkSemaphoreCreateInfo semaphoreCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = VK_NULL_HANDLE,
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = 1,
+    };
+    VkResult result = VK_SUCCESS;
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        result = vkCreateCommandPool (device, &commandPoolCreateInfo, NULL,
+                                      &view->commandPools[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        commandBufferAllocateInfo.commandPool = view->commandPools[i];
+        result = vkAllocateCommandBuffers (device, &commandBufferAllocateInfo,
+                                           &view->commandBuffers[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        result = vkCreateSemaphore (device, &semaphoreCreateInfo, NULL,
+                                    &view->imageAcquired[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    return VK_SUCCESS;
+}
+
+static void
+destroy_view (VkDevice device, view_t *view)
+{
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        vkDestroySemaphore (device, view->imageAcquired[i], NULL);
+        vkDestroyCommandPool (device, view->commandPools[i], NULL);
+    }
+    destroy_swapchain_images (device, &view->swapchain);
+    vkDestroySwapchainKHR (device, view->swapchain.handle, NULL);
+}
+
+#ifdef HAVE_SHADERS
+/** Create variant of triangle pipeline, runs on compiler's worker thread
+ * @param base pointer to triangle_pipeline_t
+ * @param specialization constants of the variant
+ */
+static VkResult
+build_triangle_pipeline (VkDevice device, VkPipelineCache cache,
+                         const void *base,
+                         const VkSpecializationInfo *specialization,
+                         VkPipeline *pipeline)
+{
+    const triangle_pipeline_t *triangle = (const triangle_pipeline_t *)base;
+    const VkPipelineShaderStageCreateInfo stages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = triangle->vertexShader,
+            .pName = "main",
+            .pSpecializationInfo = specialization,
+        }, {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = triangle->fragmentShader,
+            .pName = "main",
+            .pSpecializationInfo = specialization,
+        }
+    };
+    const VkPipelineVertexInputStateCreateInfo vertexInputState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .vertexBindingDescriptionCount = 0,
+        .pVertexBindingDescriptions = NULL,
+        .vertexAttributeDescriptionCount = 0,
+        .pVertexAttributeDescriptions = NULL,
+    };
+    const VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+    /* Viewport and scissor are dynamic, so resize doesn't need new pipeline */
+    const VkPipelineViewportStateCreateInfo viewportState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .viewportCount = 1,
+        .pViewports = NULL,
+        .scissorCount = 1,
+        .pScissors = NULL,
+    };
+    const VkPipelineRasterizationStateCreateInfo rasterizationState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .depthBiasConstantFactor = 0.0f,
+        .depthBiasClamp = 0.0f,
+        .depthBiasSlopeFactor = 0.0f,
+        .lineWidth = 1.0f,
+    };
+    const VkPipelineMultisampleStateCreateInfo multisampleState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+        .minSampleShading = 0.0f,
+        .pSampleMask = NULL,
+        .alphaToCoverageEnable = VK_FALSE,
+        .alphaToOneEnable = VK_FALSE,
+    };
+    const VkPipelineColorBlendAttachmentState colorBlendAttachments[] = {{
+            .blendEnable = VK_FALSE,
+            .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+            .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+            .colorBlendOp = VK_BLEND_OP_ADD,
+            .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+            .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+            .alphaBlendOp = VK_BLEND_OP_ADD,
+            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+            | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        }
+    };
+    const VkPipelineColorBlendStateCreateInfo colorBlendState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = 1,
+        .pAttachments = colorBlendAttachments,
+        .blendConstants = {0.0f, 0.0f, 0.0f, 0.0f},
+    };
+    const VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR
+    };
+    const VkPipelineDynamicStateCreateInfo dynamicState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .dynamicStateCount = 2,
+        .pDynamicStates = dynamicStates,
+    };
+    const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .stageCount = 2,
+        .pStages = stages,
+        .pVertexInputState = &vertexInputState,
+        .pInputAssemblyState = &inputAssemblyState,
+        .pTessellationState = NULL,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizationState,
+        .pMultisampleState = &multisampleState,
+        .pDepthStencilState = NULL,
+        .pColorBlendState = &colorBlendState,
+        .pDynamicState = &dynamicState,
+        .layout = triangle->layout,
+        .renderPass = triangle->renderPass,
+        .subpass = 0,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+    return vkCreateGraphicsPipelines (device, cache, 1, &pipelineCreateInfo,
+                                      NULL, pipeline);
+}
+
+static VkResult
+create_shader_module (VkDevice device, const uint32_t *code, size_t size,
+                      VkShaderModule *shaderModule)
+{
+    const VkShaderModuleCreateInfo shaderModuleCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .codeSize = size,
+        .pCode = code,
+    };
+    return vkCreateShaderModule (device, &shaderModuleCreateInfo, NULL,
+                                 shaderModule);
+}
+#endif
+
+/** Prepare variants of triangle pipeline from embedded shaders
+ * @param renderer renderer with initialized render pass and compiler
+ */
+static VkResult
+create_triangle_variants (renderer_t *renderer)
+{
+#ifdef HAVE_SHADERS
+    triangle_pipeline_t *triangle = &renderer->triangle;
+    const VkPushConstantRange pushConstantRanges[] = {{
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof (triangle_constants_t),
+        }
+    };
+    const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .setLayoutCount = 0,
+        .pSetLayouts = NULL,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = pushConstantRanges,
+    };
+    VkResult result = create_shader_module (renderer->device, triangle_vert_spv,
+                                            triangle_vert_spv_size,
+                                            &triangle->vertexShader);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = create_shader_module (renderer->device, triangle_frag_spv,
+                                   triangle_frag_spv_size,
+                                   &triangle->fragmentShader);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkCreatePipelineLayout (renderer->device, &pipelineLayoutCreateInfo,
+                                     NULL, &triangle->layout);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    triangle->renderPass = renderer->renderPass;
+    renderer->triangleVariants = shader_variants_create (renderer->compiler,
+                                 build_triangle_pipeline, triangle);
+    if (renderer->triangleVariants == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    shader_variant_key_set (&renderer->triangleKey, TRIANGLE_ANIMATE_CONSTANT, 1);
+    shader_variant_key_set (&renderer->triangleKey, TRIANGLE_GRAYSCALE_CONSTANT,
+                            0);
+    shader_variant_key_set (&renderer->triangleKey,
+                            TRIANGLE_ENCODE_SRGB_CONSTANT,
+                            renderer->encodesSrgb ? 1 : 0);
+    /* Start compiling variant used by the first frame right away */
+    shader_variants_get (renderer->triangleVariants, &renderer->triangleKey,
+                         VK_NULL_HANDLE);
+#else
+    (void)renderer;
+#endif
+    return VK_SUCCESS;
+}
+
+/** Get path of file flight recorder dumps to on errors
+ *
+ * Directory is VKBOOTSTRAP_FLIGHT_DIR, TMPDIR or /tmp, whichever is set
+ * first, so that failed runs don't litter working directory.
+ * @param path buffer that receives the path
+ * @param size size of @a path buffer
+ * @returns @a path, or NULL if VKBOOTSTRAP_FLIGHT_DIR is empty or path
+ *          doesn't fit
+ */
+static const char *
+get_flight_recorder_path (char *path, size_t size)
+{
+    const char *directory = getenv ("VKBOOTSTRAP_FLIGHT_DIR");
+    int length = -1;
+    if (directory == NULL) {
+        directory = getenv ("TMPDIR");
+        if (directory == NULL || directory[0] == '\0') {
+            directory = "/tmp";
+        }
+    }
+    if (directory[0] != '\0') {
+        length = snprintf (path, size, "%s/vkbootstrap.%d.flight", directory,
+                           (int)getpid ());
+    }
+    return (length > 0 && (size_t)length < size) ? path : NULL;
+}
+
+/** Get path of file where pipeline cache is kept between runs
+ * @param path buffer that receives the path
+ * @param size size of @a path buffer
+ * @returns @a path, or NULL if there is no place to keep the cache
+ */
+static const char *
+get_pipeline_cache_path (char *path, size_t size)
+{
+    const char *cache_home = getenv ("XDG_CACHE_HOME");
+    const char *home = getenv ("HOME");
+    int length = -1;
+    if (cache_home != NULL && cache_home[0] != '\0') {
+        length = snprintf (path, size, "%s/" PIPELINE_CACHE_FILE_NAME,
+                           cache_home);
+    } else if (home != NULL && home[0] != '\0') {
+        length = snprintf (path, size, "%s/.cache/" PIPELINE_CACHE_FILE_NAME,
+                           home);
+    }
+    return (length > 0 && (size_t)length < size) ? path : NULL;
+}
+
+/** Release all objects owned by renderer
+ * @param renderer renderer to clean up, can be partially initialized
+ */
+static void
+renderer_cleanup (renderer_t *renderer)
+{
+    char cachePath[MAX_PATH_LENGTH];
+    perf_counters_close (renderer->counters);
+    renderer->counters = NULL;
+    if (renderer->device == VK_NULL_HANDLE) {
+        return;
+    }
+    vkDeviceWaitIdle (renderer->device);
+    present_latency_destroy (renderer->latency);
+    if (verbose) {
+        gpu_profiler_print_stats (renderer->profiler);
+    }
+    gpu_profiler_destroy (renderer->profiler);
+    pipeline_compiler_destroy (renderer->compiler);
+    shader_variants_destroy (renderer->triangleVariants);
+    vkDestroyPipelineLayout (renderer->device, renderer->triangle.layout, NULL);
+    vkDestroyShaderModule (renderer->device, renderer->triangle.fragmentShader,
+                           NULL);
+    vkDestroyShaderModule (renderer->device, renderer->triangle.vertexShader,
+                           NULL);
+    if (renderer->pipelineCache != VK_NULL_HANDLE) {
+        pipeline_cache_save (renderer->device, renderer->pipelineCache,
+                             get_pipeline_cache_path (cachePath,
+                                     sizeof (cachePath)));
+        vkDestroyPipelineCache (renderer->device, renderer->pipelineCache, NULL);
+    }
+    worker_pool_destroy (renderer->recorders);
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        destroy_frame (renderer->device, &renderer->frames[i]);
+    }
+    for (uint32_t i = 0; i < renderer->viewCount; i++) {
+        destroy_view (renderer->device, &renderer->views[i]);
+    }
+    vkDestroyRenderPass (renderer->device, renderer->renderPass, NULL);
+    memset (renderer, 0, sizeof (*renderer));
+}
+
+/** Create everything needed to render frames to surfaces
+ * @param renderer renderer to initialize
+ * @param physicalDevice physical device of @a device
+ * @param properties properties of @a physicalDevice
+ * @param enabledFeatures features enabled on @a device
+ * @param device device to render with
+ * @param surfaceCount number of views, from 1 to MAX_WINDOWS
+ * @param surfaces surface of each view to present rendered frames to,
+ *                 VK_NULL_HANDLE to render view to offscreen images
+ * @param surfaceFormat format of images of all views, render pass is
+ *        created for it
+ * @param extent initial size of surfaces
+ * @param hasPresentWait non-zero if @a device has present wait enabled
+ * @param hasAlpha non-zero if windows of surfaces have alpha channel
+ */
+static VkResult
+renderer_init (renderer_t *renderer, VkPhysicalDevice physicalDevice,
+               const VkPhysicalDeviceProperties *properties,
+               const VkPhysicalDeviceFeatures *enabledFeatures, VkDevice device,
+               uint32_t surfaceCount, const VkSurfaceKHR *surfaces,
+               const VkSurfaceFormatKHR *surfaceFormat, VkExtent2D extent,
+               int hasPresentWait, int hasAlpha)
+{
+    const uint32_t queueFamilyIndex = 0;
+    const int statistics = enabledFeatures->pipelineStatisticsQuery == VK_TRUE;
+    char cachePath[MAX_PATH_LENGTH];
+    VkResult result = VK_SUCCESS;
+    memset (renderer, 0, sizeof (*renderer));
+    renderer->physicalDevice = physicalDevice;
+    renderer->device = device;
+    renderer->hasAlpha = hasAlpha;
+    renderer->surfaceFormat = *surfaceFormat;
+    /* Encoding for other color spaces is up to presentation engine */
+    renderer->encodesSrgb = surfaceFormat->colorSpace
+                            == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
+                            && !is_srgb_format (surfaceFormat->format);
+    renderer->hasStatistics = statistics;
+    vkGetDeviceQueue (device, queueFamilyIndex, 0, &renderer->queue);
+    /* Views either all present or all render offscreen */
+    result = create_render_pass (device, surfaceFormat->format,
+                                 surfaces[0] != VK_NULL_HANDLE
+                                 ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+                                 : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                 &renderer->renderPass);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t i = 0; i < surfaceCount; i++) {
+        view_t *view = &renderer->views[i];
+        view->surface = surfaces[i];
+        view->extent = extent;
+        view->isOutOfDate = 1;
+        renderer->viewCount = i + 1;
+        result = create_view (device, queueFamilyIndex, view);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    result = renderer_resize (renderer);
+    if (result != VK_SUCCESS) {
+        fprintf (stderr, "%s: can't create swapchain: %s\n", program_name,
+                 get_vulkan_error_string (result));
+        return result;
+    }
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        result = create_frame (device, queueFamilyIndex, &renderer->frames[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    /* Calling thread records one of views too */
+    renderer->recorders = worker_pool_create (surfaceCount, "record");
+    if (renderer->recorders == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    result = pipeline_cache_load (device, properties,
+                                  get_pipeline_cache_path (cachePath,
+                                          sizeof (cachePath)),
+                                  &renderer->pipelineCache);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = pipeline_compiler_create (device, renderer->pipelineCache, 0,
+                                       benchmark_mode, &renderer->compiler);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = create_triangle_variants (renderer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = gpu_profiler_create (physicalDevice, device, properties,
+                                  queueFamilyIndex, FRAMES_IN_FLIGHT,
+                                  statistics,
+                                  &renderer->profiler);
+    if (result != VK_SUCCESS && verbose) {
+        printf ("GPU timings are not available: %s\n",
+                get_vulkan_error_string (result));
+    }
+    if (benchmark_mode) {
+        result = present_latency_create (device, hasPresentWait
+                                         ? vkGetDeviceProcAddr (device,
+                                                 "vkWaitForPresentKHR")
+                                         : NULL,
+                                         &renderer->latency);
+        if (result != VK_SUCCESS && verbose) {
+            printf ("Present latency is not available: %s\n",
+                    get_vulkan_error_string (result));
+        }
+    }
+    return VK_SUCCESS;
+}
+
+/** Add CPU counters since end of previous phase to counters of @a phase
+ * @param renderer renderer which counters are sampled
+ * @param phase phase that has just ended
+ */
+static void
+renderer_end_phase (renderer_t *renderer, frame_phase_t phase)
+{
+    perf_sample_t now;
+    if (renderer->counters == NULL
+            || !perf_counters_read (renderer->counters, &now)) {
+        return;
+    }
+    perf_sample_add_delta (&renderer->phaseCounters[phase],
+                           &renderer->phaseBegin, &now);
+    renderer->phaseBegin = now;
+}
+
+/** Record commands that draw view to its secondary command buffer
+ * @param renderer renderer which frame is recorded
+ * @param frame_index index of frame in flight
+ * @param view view to record, its image must be acquired
+ */
+static VkResult
+record_view (renderer_t *renderer, uint32_t frame_index, view_t *view)
+{
+    VkCommandBuffer cmd = view->commandBuffers[frame_index];
+    const VkCommandBufferInheritanceInfo inheritanceInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = NULL,
+        .renderPass = renderer->renderPass,
+        .subpass = 0,
+        .framebuffer = view->swapchain.framebuffers[view->imageIndex],
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags = 0,
+        .pipelineStatistics = renderer->hasStatistics
+        ? GPU_PROFILER_PIPELINE_STATISTICS : 0,
+    };
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+        | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo,
+    };
+    const VkExtent2D extent = view->swapchain.extent;
+    const VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = (float)extent.width,
+        .height = (float)extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    const VkRect2D scissor = {.offset = {0, 0}, .extent = extent};
+    const triangle_constants_t constants = {
+        .time = renderer->animationTime,
+    };
+    VkResult result = vkResetCommandPool (renderer->device,
+                                          view->commandPools[frame_index], 0);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkBeginCommandBuffer (cmd, &beginInfo);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    /* Draw is skipped until pipeline is compiled in background */
+    if (renderer->trianglePipeline != VK_NULL_HANDLE) {
+        vkCmdBindPipeline (cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                           renderer->trianglePipeline);
+        vkCmdSetViewport (cmd, 0, 1, &viewport);
+        vkCmdSetScissor (cmd, 0, 1, &scissor);
+        vkCmdPushConstants (cmd, renderer->triangle.layout,
+                            VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof (constants),
+                            &constants);
+        vkCmdDraw (cmd, 3, 1, 0, 0);
+    }
+    return vkEndCommandBuffer (cmd);
+}
+
+/** Record views drawn by current frame, runs on recorder threads */
+static void
+record_view_task (void *context, uint32_t index)
+{
+    renderer_t *renderer = (renderer_t *)context;
+    view_t *view = &renderer->views[index];
+    TRACE_BEGIN ("record view");
+    view->recordResult = view->isDrawn
+                         ? record_view (renderer,
+                                        (uint32_t)(renderer->frame_number
+                                                % FRAMES_IN_FLIGHT), view)
+                         : VK_SUCCESS;
+    TRACE_END ();
+}
+
+/** Record commands of the frame to its command buffer
+ * @param renderer renderer which frame is recorded
+ * @param frame_index index of frame in flight
+ */
+static VkResult
+record_frame (renderer_t *renderer, uint32_t frame_index)
+{
+    const frame_t *frame = &renderer->frames[frame_index];
+    VkCommandBuffer cmd = frame->commandBuffer;
+    const float t = (float)(renderer->frame_number % 360) / 360.0f;
+    const float color[3] = {t, 0.5f * t, 1.0f - t};
+    VkClearValue clearValue;
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+    VkRenderPassBeginInfo renderPassBeginInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext = NULL,
+        .renderPass = renderer->renderPass,
+        .framebuffer = VK_NULL_HANDLE,
+        .renderArea = {.offset = {0, 0}, .extent = {0, 0}},
+        .clearValueCount = 1,
+        .pClearValues = &clearValue,
+    };
+    uint32_t pass = 0;
+    VkResult result = vkResetCommandPool (renderer->device, frame->commandPool,
+                                          0);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkBeginCommandBuffer (cmd, &beginInfo);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    gpu_profiler_begin_frame (renderer->profiler, cmd, frame_index,
+                              renderer->frame_number);
+    for (uint32_t i = 0; i < renderer->viewCount; i++) {
+        const view_t *view = &renderer->views[i];
+        /* Alpha is only cleared to what compositor will blend with */
+        const float alpha = view->swapchain.compositeAlpha
+                            == VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR
+                            ? TRANSPARENT_ALPHA : 1.0f;
+        if (!view->isDrawn) {
+            continue;
+        }
+        /* Premultiplied, so translucent background keeps its hue */
+        for (uint32_t c = 0; c < 3; c++) {
+            clearValue.color.float32[c] = renderer->encodesSrgb
+                                          ? encode_srgb (color[c] * alpha)
+                                          : color[c] * alpha;
+        }
+        clearValue.color.float32[3] = alpha;
+        renderPassBeginInfo.framebuffer =
+            view->swapchain.framebuffers[view->imageIndex];
+        renderPassBeginInfo.renderArea.extent = view->swapchain.extent;
+        pass = gpu_profiler_begin_pass (renderer->profiler, cmd, "main");
+        vkCmdBeginRenderPass (cmd, &renderPassBeginInfo,
+                              VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands (cmd, 1, &view->commandBuffers[frame_index]);
+        vkCmdEndRenderPass (cmd);
+        gpu_profiler_end_pass (renderer->profiler, cmd, pass);
+    }
+    gpu_profiler_end_frame (renderer->profiler, cmd);
+    return vkEndCommandBuffer (cmd);
+}
+
+/** Acquire images of views that can be drawn
+ * @param renderer renderer which views are acquired
+ * @param frame_index index of frame in flight
+ * @returns number of views drawn by frame
+ */
+static uint32_t
+acquire_views (renderer_t *renderer, uint32_t frame_index)
+{
+    uint32_t drawn_count = 0;
+    for (uint32_t i = 0; i < renderer->viewCount; i++) {
+        view_t *view = &renderer->views[i];
+        VkResult result = VK_SUCCESS;
+        view->isDrawn = 0;
+        if (view->isOutOfDate
+                || (view->window != NULL && !window_is_visible (view->window))) {
+            continue;
+        }
+        if (view->swapchain.is_offscreen) {
+            view->imageIndex = frame_index;
+        } else {
+            result = vkAcquireNextImageKHR (renderer->device,
+                                            view->swapchain.handle, UINT64_MAX,
+                                            view->imageAcquired[frame_index],
+                                            VK_NULL_HANDLE, &view->imageIndex);
+        }
+        flight_recorder_record (FLIGHT_EVENT_ACQUIRE, renderer->frame_number,
+                                result, view->imageIndex, i, 0);
+        /* Suboptimal image is still drawn, swapchain is recreated later */
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+            view->isDrawn = 1;
+            drawn_count++;
+        }
+        if (result != VK_SUCCESS) {
+            view->isOutOfDate = 1;
+        }
+    }
+    return drawn_count;
+}
+
+/** Check if swapchain of any view must be recreated */
+static int
+renderer_is_out_of_date (const renderer_t *renderer)
+{
+    for (uint32_t i = 0; i < renderer->viewCount; i++) {
+        if (renderer->views[i].isOutOfDate) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Render views and present them with a single present request
+ * @param renderer renderer to draw with
+ * @returns VK_ERROR_OUT_OF_DATE_KHR if swapchain of a view must be recreated
+ */
+static VkResult
+draw_frame (renderer_t *renderer)
+{
+    const uint64_t frame_number = renderer->frame_number;
+    const uint32_t frame_index = (uint32_t)(frame_number % FRAMES_IN_FLIGHT);
+    frame_t *frame = &renderer->frames[frame_index];
+    uint64_t wait_begin = 0;
+    VkSemaphore waitSemaphores[MAX_WINDOWS];
+    VkPipelineStageFlags waitStages[MAX_WINDOWS];
+    VkSwapchainKHR swapchains[MAX_WINDOWS];
+    uint32_t imageIndices[MAX_WINDOWS];
+    VkResult results[MAX_WINDOWS];
+    uint32_t presentViews[MAX_WINDOWS];
+    uint32_t presentCount = 0;
+    VkSwapchainKHR latencySwapchain = VK_NULL_HANDLE;
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = waitSemaphores,
+        .pWaitDstStageMask = waitStages,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &frame->commandBuffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = &frame->renderFinished,
+    };
+    VkPresentInfoKHR presentInfo = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .pNext = NULL,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &frame->renderFinished,
+        .swapchainCount = 0,
+        .pSwapchains = swapchains,
+        .pImageIndices = imageIndices,
+        .pResults = results,
+    };
+#ifdef VK_KHR_present_id
+    uint64_t presentIds[MAX_WINDOWS];
+    VkPresentIdKHR presentIdInfo = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .pNext = NULL,
+        .swapchainCount = 0,
+        .pPresentIds = presentIds,
+    };
+#endif
+    VkResult result = VK_SUCCESS;
+    TRACE_BEGIN ("wait fence");
+    wait_begin = timer_now_ns ();
+    result = vkWaitForFences (renderer->device, 1, &frame->fence, VK_TRUE,
+                              UINT64_MAX);
+    renderer->waitMs = timer_elapsed_ms (wait_begin, timer_now_ns ());
+    TRACE_END ();
+    renderer_end_phase (renderer, PHASE_WAIT_FENCE);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    /* Fence has signalled, so queries of this frame are ready */
+    renderer->hasGpuTimings = gpu_profiler_collect (renderer->profiler,
+                              frame_index, &renderer->gpuTimings);
+    if (renderer->hasGpuTimings) {
+        TRACE_GPU_FRAME (&renderer->gpuTimings, frame->submitTime);
+        flight_recorder_record (FLIGHT_EVENT_GPU_FRAME,
+                                renderer->gpuTimings.frame_number, VK_SUCCESS,
+                                (uint32_t)(renderer->gpuTimings.frame_ms * 1e3),
+                                renderer->gpuTimings.pass_count, 0);
+    }
+    TRACE_BEGIN ("acquire");
+    wait_begin = timer_now_ns ();
+    if (acquire_views (renderer, frame_index) == 0
+            && renderer_is_out_of_date (renderer)) {
+        result = VK_ERROR_OUT_OF_DATE_KHR;
+    }
+    renderer->waitMs += timer_elapsed_ms (wait_begin, timer_now_ns ());
+    TRACE_END ();
+    renderer_end_phase (renderer, PHASE_ACQUIRE);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    TRACE_BEGIN ("record");
+    /* Variants are looked up once, recorders only read the result */
+    renderer->trianglePipeline = shader_variants_get (
+                                     renderer->triangleVariants,
+                                     &renderer->triangleKey, VK_NULL_HANDLE);
+    worker_pool_run (renderer->recorders, renderer->viewCount,
+                     record_view_task, renderer);
+    for (uint32_t i = 0; i < renderer->viewCount && result == VK_SUCCESS; i++) {
+        result = renderer->views[i].recordResult;
+    }
+    if (result == VK_SUCCESS) {
+        result = record_frame (renderer, frame_index);
+    }
+    TRACE_END ();
+    renderer_end_phase (renderer, PHASE_RECORD);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t i = 0; i < renderer->viewCount; i++) {
+        const view_t *view = &renderer->views[i];
+        if (!view->isDrawn || view->swapchain.is_offscreen) {
+            continue;
+        }
+        waitSemaphores[presentCount] = view->imageAcquired[frame_index];
+        waitStages[presentCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        swapchains[presentCount] = view->swapchain.handle;
+        imageIndices[presentCount] = view->imageIndex;
+        presentViews[presentCount] = i;
+        presentCount++;
+    }
+    /* Nothing is acquired or presented offscreen, so there is nothing to
+     * wait */
+    submitInfo.waitSemaphoreCount = presentCount;
+    submitInfo.signalSemaphoreCount = presentCount > 0 ? 1 : 0;
+    present_latency_release_fence (renderer->latency, frame->fence);
+    result = vkResetFences (renderer->device, 1, &frame->fence);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    TRACE_BEGIN ("submit");
+    frame->submitTime = timer_now_ns ();
+    result = vkQueueSubmit (renderer->queue, 1, &submitInfo, frame->fence);
+    TRACE_END ();
+    flight_recorder_record (FLIGHT_EVENT_SUBMIT, frame_number, result,
+                            frame_index, 0, 0);
+    renderer_end_phase (renderer, PHASE_SUBMIT);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    renderer->frame_number++;
+    TRACE_BEGIN ("present");
+#ifdef VK_KHR_present_id
+    if (present_latency_uses_present_wait (renderer->latency)) {
+        ++renderer->presentId;
+        for (uint32_t i = 0; i < presentCount; i++) {
+            presentIds[i] = renderer->presentId;
+        }
+        presentIdInfo.swapchainCount = presentCount;
+        presentInfo.pNext = &presentIdInfo;
+    }
+#endif
+    /* All swapchains are handed to presentation engine in one request */
+    presentInfo.swapchainCount = presentCount;
+    if (presentCount > 0) {
+        result = vkQueuePresentKHR (renderer->queue, &presentInfo);
+    }
+    TRACE_END ();
+    flight_recorder_record (FLIGHT_EVENT_PRESENT, frame_number, result,
+                            presentCount, 0, 0);
+    renderer_end_phase (renderer, PHASE_PRESENT);
+    for (uint32_t i = 0; i < presentCount; i++) {
+        if (results[i] == VK_ERROR_OUT_OF_DATE_KHR
+                || results[i] == VK_SUBOPTIMAL_KHR) {
+            renderer->views[presentViews[i]].isOutOfDate = 1;
+        } else if (results[i] != VK_SUCCESS) {
+            return results[i];
+        }
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR
+            && result != VK_ERROR_OUT_OF_DATE_KHR) {
+        return result;
+    }
+    /* Latency is tracked on first view, other frames are only completed */
+    if (presentCount > 0 && presentViews[0] == 0
+            && (results[0] == VK_SUCCESS || results[0] == VK_SUBOPTIMAL_KHR)) {
+        latencySwapchain = swapchains[0];
+    }
+    present_latency_add (renderer->latency, frame_number, latencySwapchain,
+                         renderer->presentId, frame->fence, frame->submitTime);
+    return renderer_is_out_of_date (renderer)
+           ? VK_ERROR_OUT_OF_DATE_KHR : VK_SUCCESS;
+}
+
+/** Move latency samples of completed frames from renderer to benchmark
+ * @param renderer renderer which frames are tracked
+ * @param benchmark benchmark that receives samples
+ */
+static void
+collect_present_latency (renderer_t *renderer, benchmark_t *benchmark)
+{
+    present_latency_sample_t samples[MAX_LATENCY_SAMPLES];
+    uint32_t count = 0;
+    do {
+        count = present_latency_collect (renderer->latency, samples,
+                                         MAX_LATENCY_SAMPLES);
+        for (uint32_t i = 0; i < count; i++) {
+            benchmark_add_present_latency (benchmark, &samples[i]);
+        }
+    } while (count == MAX_LATENCY_SAMPLES);
+}
+
+/** Collect timings of frames still in flight and write benchmark report
+ * @param renderer renderer the benchmark was run with
+ * @param benchmark benchmark to finish
+ * @returns 0 on success, -1 if report can't be written
+ */
+static int
+finish_benchmark (renderer_t *renderer, benchmark_t *benchmark)
+{
+    gpu_frame_timings_t timings;
+    perf_sample_t counters;
+    /* Report describes first view, others are created alike */
+    const swapchain_t *swapchain = &renderer->views[0].swapchain;
+    vkDeviceWaitIdle (renderer->device);
+    /* Frames waited for with fences are complete once tracker notices it */
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        present_latency_release_fence (renderer->latency,
+                                       renderer->frames[i].fence);
+    }
+    pipeline_compiler_get_counters (renderer->compiler, &counters);
+    benchmark_add_thread_counters (benchmark, "pipeline compiler", &counters);
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        if (gpu_profiler_collect (renderer->profiler, i, &timings)) {
+            benchmark_add_gpu_frame (benchmark, &timings);
+        }
+    }
+    collect_present_latency (renderer, benchmark);
+    benchmark_set_swapchain (benchmark, get_swapchain_mode_string (swapchain),
+                             get_format_string (swapchain->format),
+                             swapchain->image_count, swapchain->extent);
+    benchmark_set_startup_round_trips (benchmark, round_trip_count);
+    if (window_count > 0) {
+        benchmark_set_window (benchmark, windows[0]->is_fullscreen,
+                              window_is_unredirected (windows[0]));
+    }
+    return benchmark_write_report (benchmark, benchmark_output);
+}
+
+/** Publish parameters of current swapchain of first view of renderer
+ * @param metrics target publisher, can be NULL
+ * @param renderer renderer which swapchain is published
+ */
+static void
+set_live_metrics_swapchain (live_metrics_t *metrics, const renderer_t *renderer)
+{
+    const swapchain_t *swapchain = &renderer->views[0].swapchain;
+    const char *present_mode = get_swapchain_mode_string (swapchain);
+    live_metrics_set_swapchain (metrics, present_mode, swapchain->extent.width,
+                                swapchain->extent.height, swapchain->image_count);
+}
+
+/** Check that none of windows is closed, true when there are no windows */
+static int windows_are_exist (void)
+{
+    for (uint32_t i = 0; i < window_count; i++) {
+        if (!window_is_exists (windows[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Check if any of windows can be seen */
+static int windows_are_visible (void)
+{
+    for (uint32_t i = 0; i < window_count; i++) {
+        if (window_is_visible (windows[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Tell window manager that frame was presented to all windows */
+static void windows_end_frame (void)
+{
+    for (uint32_t i = 0; i < window_count; i++) {
+        window_end_frame (windows[i]);
+    }
+}
+
+/** Mark views which window has been resized as out of date
+ * @param renderer renderer which views are checked
+ * @returns non-zero if any view has to be resized
+ */
+static int mark_resized_views (renderer_t *renderer)
+{
+    int is_resized = 0;
+    for (uint32_t i = 0; i < renderer->viewCount; i++) {
+        view_t *view = &renderer->views[i];
+        if (view->window != NULL && view->window->is_resized) {
+            view->window->is_resized = 0;
+            view->extent.width = (uint32_t)view->window->width;
+            view->extent.height = (uint32_t)view->window->height;
+            view->isOutOfDate = 1;
+            is_resized = 1;
+        }
+    }
+    return is_resized;
+}
+
+/** Ask frame loop to stop, so reports and trace are still written */
+static void handle_interrupt (int signal_number)
+{
+    (void)signal_number;
+    is_interrupted = 1;
+}
+
+#ifdef HAVE_XCB_SHM
+/** Render frames on CPU until window is closed or benchmark is done
+ *
+ * Same animation as Vulkan renderer, presented through MIT-SHM. Benchmark
+ * gets only CPU timings, with device named after the instruction set used.
+ * @param window window to present to
+ * @param simulation scene to animate
+ * @param benchmark benchmark to run, or NULL
+ * @param extent initial size of window
+ * @returns exit status of program
+ */
+static int
+run_software (game_window_t *window, simulation_t *simulation,
+              benchmark_t *benchmark, VkExtent2D extent)
+{
+    shm_presenter_t *presenter = NULL;
+    software_renderer_t *software = NULL;
+    uint64_t frame_number = 0;
+    uint64_t last_tick = 0;
+    const uint32_t first_round_trip = shm_presenter_get_round_trips ();
+    int error = EXIT_SUCCESS;
+    if (window == NULL) {
+        fprintf (stderr, "%s: software rendering needs X server\n",
+                 program_name);
+        return EXIT_FAILURE;
+    }
+    presenter = shm_presenter_create (window->connection,
+                                      window_get_native (window));
+    if (presenter == NULL
+            || shm_presenter_resize (presenter, (uint16_t)extent.width,
+                                     (uint16_t)extent.height) != 0) {
+        error = EXIT_FAILURE;
+    }
+    /* Round trips of later resizes and image waits belong to frames */
+    round_trip_count += shm_presenter_get_round_trips () - first_round_trip;
+    if (error != EXIT_SUCCESS) {
+        fprintf (stderr, "%s: can't present through MIT-SHM\n", program_name);
+        goto out;
+    }
+    software = software_renderer_create (0);
+    if (software == NULL) {
+        fprintf (stderr, "%s: can't create software renderer\n", program_name);
+        error = EXIT_FAILURE;
+        goto out;
+    }
+    if (verbose) {
+        printf ("Software rendering with %s on %u threads\n",
+                software_renderer_get_isa (software),
+                software_renderer_get_thread_count (software));
+    }
+    if (benchmark != NULL) {
+        VkPhysicalDeviceProperties properties;
+        memset (&properties, 0, sizeof (properties));
+        properties.deviceType = VK_PHYSICAL_DEVICE_TYPE_CPU;
+        snprintf (properties.deviceName, sizeof (properties.deviceName),
+                  "software %s", software_renderer_get_isa (software));
+        benchmark_set_device (benchmark, &properties, 0);
+    }
+    last_tick = timer_now_ns ();
+    while (!is_interrupted && window_is_exists (window)
+            && !benchmark_is_done (benchmark)) {
+        const uint64_t frame_begin = timer_now_ns ();
+        uint64_t wait_begin = 0;
+        uint64_t frame_end = 0;
+        double wait_ms = 0.0;
+        uint32_t *pixels = NULL;
+        int presented = 0;
+        TRACE_BEGIN ("frame");
+        TRACE_BEGIN ("process events");
+        window_apply_events (window, benchmark == NULL ? simulation : NULL);
+        TRACE_END ();
+        simulation_tick (simulation, benchmark != NULL ? 1.0 / 60.0
+                         : timer_elapsed_ms (last_tick, frame_begin) / 1000.0);
+        last_tick = frame_begin;
+        if (benchmark == NULL && !window_is_visible (window)) {
+            /* Frame is skipped, nothing keeps window manager waiting */
+            window_end_frame (window);
+            TRACE_END ();
+            event_thread_wait (HIDDEN_TICK_MS);
+            continue;
+        }
+        if (window->is_resized) {
+            window->is_resized = 0;
+            extent.width = (uint32_t)window->width;
+            extent.height = (uint32_t)window->height;
+            if (shm_presenter_resize (presenter, (uint16_t)extent.width,
+                                      (uint16_t)extent.height) != 0) {
+                TRACE_END ();
+                fprintf (stderr, "%s: can't resize MIT-SHM images\n",
+                         program_name);
+                error = EXIT_FAILURE;
+                break;
+            }
+        }
+        wait_begin = timer_now_ns ();
+        pixels = shm_presenter_acquire (presenter);
+        wait_ms = timer_elapsed_ms (wait_begin, timer_now_ns ());
+        TRACE_BEGIN ("draw");
+        software_renderer_draw (software, pixels, extent.width, extent.width,
+                                extent.height, frame_number,
+                                simulation->angle);
+        TRACE_END ();
+        TRACE_BEGIN ("present");
+        presented = shm_presenter_present (presenter) == 0;
+        TRACE_END ();
+        TRACE_END ();
+        if (!presented) {
+            fprintf (stderr, "%s: connection to X server is lost\n",
+                     program_name);
+            error = EXIT_FAILURE;
+            break;
+        }
+        window_end_frame (window);
+        frame_end = timer_now_ns ();
+        benchmark_end_frame (benchmark, frame_number,
+                             timer_elapsed_ms (frame_begin, frame_end) - wait_ms,
+                             frame_end);
+        frame_number++;
+    }
+    if (error == EXIT_SUCCESS && benchmark_is_done (benchmark)) {
+        benchmark_set_swapchain (benchmark, "mit-shm", "X8R8G8B8",
+                                 SHM_PRESENTER_IMAGE_COUNT, extent);
+        benchmark_set_window (benchmark, window->is_fullscreen,
+                              window_is_unredirected (window));
+        benchmark_set_startup_round_trips (benchmark, round_trip_count);
+        if (benchmark_write_report (benchmark, benchmark_output) != 0) {
+            fprintf (stderr, "%s: can't write benchmark report to %s\n",
+                     program_name, benchmark_output);
+            error = EXIT_FAILURE;
+        }
+    }
+out:
+    software_renderer_destroy (software);
+    shm_presenter_destroy (presenter);
+    return error;
+}
+#endif
+
+/** Render on CPU after Vulkan has failed, if there is window to present to
+ * @returns exit status of program
+ */
+static int
+fall_back_to_software (game_window_t *window, simulation_t *simulation,
+                       benchmark_t *benchmark, VkExtent2D extent)
+{
+#ifdef HAVE_XCB_SHM
+    if (window != NULL) {
+        fprintf (stderr, "%s: falling back to software rendering\n",
+                 program_name);
+        return run_software (window, simulation, benchmark, extent);
+    }
+#else
+    (void)window;
+    (void)simulation;
+    (void)benchmark;
+    (void)extent;
+#endif
+    return EXIT_FAILURE;
+}
+
+int main (int argc, char *const *argv)
+{
+    int error = EXIT_SUCCESS;
+    xcb_connection_t *connection = NULL;
+    VkInstance vk = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceFeatures enabledFeatures;
+    VkDevice device = VK_NULL_HANDLE;
+    VkSurfaceKHR surfaces[MAX_WINDOWS] = {VK_NULL_HANDLE};
+    VkSurfaceFormatKHR surfaceFormat;
+    xcb_intern_atom_cookie_t atomCookies[ATOM_COUNT];
+    renderer_t renderer = {0};
+    VkExtent2D extent = {.width = 640, .height = 480};
+    VkResult result = VK_SUCCESS;
+    benchmark_t *benchmark = NULL;
+    live_metrics_t *metrics = NULL;
+    simulation_t simulation;
+    uint64_t last_tick = 0;
+    int hasSurface = 0;
+    int hasProperties2 = 0;
+    int hasPresentWait = 0;
+    char flightPath[MAX_PATH_LENGTH];
+    parse_args (argc, argv);
+    if (get_flight_recorder_path (flightPath, sizeof (flightPath)) != NULL
+            && flight_recorder_init (flightPath) != 0 && verbose) {
+        printf ("Flight recorder can't catch fatal signals\n");
+    }
+    if (trace_output != NULL && trace_open (trace_output) != 0) {
+        fprintf (stderr, "%s: can't start trace, it may be compiled out\n",
+                 program_name);
+        error = EXIT_FAILURE;
+        goto out;
+    }
+    TRACE_THREAD_NAME ("main");
+    signal (SIGINT, handle_interrupt);
+    signal (SIGTERM, handle_interrupt);
+    simulation_init (&simulation, SIMULATION_DEFAULT_SEED);
+    if (benchmark_mode) {
+        benchmark = benchmark_create (benchmark_frames, benchmark_warmup,
+                                      SIMULATION_DEFAULT_SEED);
+        if (benchmark == NULL) {
+            fprintf (stderr, "%s: can't create benchmark\n", program_name);
+            error = EXIT_FAILURE;
+            goto out;
+        }
+    }
+
+    if (!headless_mode) {
+        TRACE_BEGIN ("connect");
+        connection = xcb_connect (NULL, NULL);
+        TRACE_END ();
+        if (connection == NULL) {
+            fprintf (stderr, "%s: can't connect to X server\n", program_name);
+            error = EXIT_FAILURE;
+            goto out;
+        }
+        request_atoms (connection, atomCookies);
+    }
+    if (!software_mode) {
+        /* X server answers atom requests in the meantime */
+        TRACE_BEGIN ("create instance");
+        result = create_instance (headless_mode, &hasSurface, &hasProperties2,
+                                  &vk);
+        TRACE_END ();
+    }
+    if (connection != NULL) {
+        TRACE_BEGIN ("collect atoms");
+        collect_atoms (connection, atomCookies);
+        init_extensions (connection);
+        TRACE_END ();
+        /* Software renderer draws to first window only */
+        if (software_mode) {
+            view_count = 1;
+        }
+        TRACE_BEGIN ("create window");
+        while (window_count < view_count) {
+            char caption[32];
+            game_window_t *window = NULL;
+            if (view_count > 1) {
+                snprintf (caption, sizeof (caption), "Vulkan Window %u",
+                          window_count + 1);
+            } else {
+                snprintf (caption, sizeof (caption), "Vulkan Window");
+            }
+            /* Software frames are opaque 8-bit, so alpha would only cost
+             * blending and 30-bit window can't take them at all */
+            window = window_create (connection, caption,
+                                    (uint16_t)extent.width,
+                                    (uint16_t)extent.height, fullscreen_mode,
+                                    transparent_mode && !software_mode,
+                                    deep_color_mode && !software_mode);
+            if (window == NULL) {
+                break;
+            }
+            windows[window_count++] = window;
+        }
+        TRACE_END ();
+        if (window_count < view_count) {
+            fprintf (stderr, "%s: can't create game window\n", program_name);
+            error = EXIT_FAILURE;
+            goto out;
+        }
+        if (verbose) {
+            printf ("Windows created after %u round trips to X server\n",
+                    round_trip_count);
+        }
+        /* Swapchain starts with size of screen when fullscreen */
+        extent.width = (uint32_t)windows[0]->width;
+        extent.height = (uint32_t)windows[0]->height;
+        /* Render thread never waits for X, slow frames don't delay events */
+        if (event_thread_start (connection) != 0) {
+            fprintf (stderr, "%s: can't start event thread\n", program_name);
+            error = EXIT_FAILURE;
+            goto out;
+        }
+    }
+#ifdef HAVE_XCB_SHM
+    if (software_mode) {
+        error = run_software (window_count > 0 ? windows[0] : NULL,
+                              &simulation, benchmark, extent);
+        goto out;
+    }
+#endif
+    if (result != VK_SUCCESS) {
+        fprintf (stderr, "%s: can't load vulkan\n", program_name);
+        error = fall_back_to_software (window_count > 0 ? windows[0] : NULL,
+                                       &simulation, benchmark, extent);
+        goto out;
+    }
+    if (verbose && !hasSurface) {
+        printf ("Headless surface is not supported, rendering offscreen\n");
+    }
+    TRACE_BEGIN ("create device");
+    result = create_device (vk, hasSurface, hasProperties2, &physicalDevice,
+                            &properties, &enabledFeatures, &hasPresentWait,
+                            &device);
+    TRACE_END ();
+    if (result != VK_SUCCESS) {
+        fprintf (stderr, "%s: can't create vulkan device: %s\n", program_name,
+                 get_vulkan_error_string (result));
+        error = fall_back_to_software (window_count > 0 ? windows[0] : NULL,
+                                       &simulation, benchmark, extent);
+        goto out;
+    }
+    TRACE_BEGIN ("create surface");
+    for (uint32_t i = 0; i < view_count && result == VK_SUCCESS; i++) {
+        if (window_count > 0) {
+            result = create_surface (connection, window_get_native (windows[i]),
+                                     vk, &surfaces[i]);
+        } else if (hasSurface) {
+            result = create_headless_surface (vk, &surfaces[i]);
+        }
+    }
+    TRACE_END ();
+    if (result != VK_SUCCESS) {
+        fprintf (stderr, "%s: can't create surface: %s\n", program_name,
+                 get_vulkan_error_string (result));
+        error = EXIT_FAILURE;
+        goto out;
+    }
+    /* Renderer presents from the same queue it renders with */
+    for (uint32_t i = 0; i < view_count && surfaces[i] != VK_NULL_HANDLE;
+            i++) {
+        VkBool32 supported = VK_FALSE;
+        result = vkGetPhysicalDeviceSurfaceSupportKHR (physicalDevice, 0,
+                 surfaces[i], &supported);
+        if (result != VK_SUCCESS) {
+            fprintf (stderr, "%s: can't get surface support: %s\n",
+                     program_name, get_vulkan_error_string (result));
+            error = EXIT_FAILURE;
+            goto out;
+        }
+        if (!supported) {
+            fprintf (stderr, "%s: queue family 0 can't present to surface\n",
+                     program_name);
+            error = EXIT_FAILURE;
+            goto out;
+        }
+    }
+    /* Windows share screen, so format of the first surface suits all */
+    result = choose_surface_format (physicalDevice, surfaces[0],
+                                    deep_color_mode, &surfaceFormat);
+    if (result != VK_SUCCESS) {
+        fprintf (stderr, "%s: can't get surface formats: %s\n", program_name,
+                 get_vulkan_error_string (result));
+        error = EXIT_FAILURE;
+        goto out;
+    }
+    if (verbose) {
+        const char *formatName = get_format_string (surfaceFormat.format);
+        printf ("Surface format %s, color space %d\n",
+                formatName != NULL ? formatName : "other",
+                surfaceFormat.colorSpace);
+    }
+    if (microbench_name != NULL) {
+        const microbench_context_t context = {
+            .physicalDevice = physicalDevice,
+            .properties = &properties,
+            .device = device,
+            .queueFamilyIndex = 0,
+            .surface = surfaces[0],
+            .format = surfaceFormat,
+            .extent = extent,
+        };
+        result = microbench_run (&context, microbench_name, benchmark_output);
+        if (result != VK_SUCCESS) {
+            fprintf (stderr, "%s: microbenchmark %s failed: %s\n", program_name,
+                     microbench_name, get_vulkan_error_string (result));
+            error = EXIT_FAILURE;
+        }
+        goto out;
+    }
+    TRACE_BEGIN ("init renderer");
+    result = renderer_init (&renderer, physicalDevice, &properties,
+                            &enabledFeatures, device, view_count, surfaces,
+                            &surfaceFormat, extent, hasPresentWait,
+                            window_count > 0 && windows[0]->depth == 32);
+    TRACE_END ();
+    if (result != VK_SUCCESS) {
+        fprintf (stderr, "%s: can't initialize renderer: %s\n", program_name,
+                 get_vulkan_error_string (result));
+        error = EXIT_FAILURE;
+        goto out;
+    }
+    for (uint32_t i = 0; i < window_count; i++) {
+        renderer.views[i].window = windows[i];
+    }
+    if (live_metrics_mode) {
+        metrics = live_metrics_create ();
+        if (metrics == NULL) {
+            fprintf (stderr, "%s: can't publish live metrics\n", program_name);
+        }
+        set_live_metrics_swapchain (metrics, &renderer);
+    }
+    if (benchmark != NULL) {
+        uint32_t physicalDeviceCount = 0;
+        /* Device is chosen among the first MAX_PHYSICAL_DEVICES only */
+        vkEnumeratePhysicalDevices (vk, &physicalDeviceCount, NULL);
+        benchmark_set_device (benchmark, &properties, physicalDeviceCount);
+        if (renderer.latency != NULL) {
+            benchmark_set_latency_source (benchmark,
+                                          present_latency_uses_present_wait (
+                                              renderer.latency)
+                                          ? "present_wait" : "fence");
+        }
+        renderer.counters = perf_counters_open ();
+        if (renderer.counters == NULL && verbose) {
+            printf ("CPU counters are not available\n");
+        }
+    }
+    last_tick = timer_now_ns ();
+    while (!is_interrupted && windows_are_exist ()
+            && !benchmark_is_done (benchmark)) {
+        const uint64_t frame_begin = timer_now_ns ();
+        const uint64_t frame_number = renderer.frame_number;
+        uint64_t input_ns = 0;
+        uint64_t frame_end = 0;
+        double cpu_ms = 0.0;
+        int presented = 0;
+        if (renderer.counters != NULL) {
+            perf_counters_read (renderer.counters, &renderer.phaseBegin);
+        }
+        TRACE_BEGIN ("frame");
+        TRACE_BEGIN ("process events");
+        /* Events are read by event thread, only its messages are taken */
+        for (uint32_t i = 0; i < window_count; i++) {
+            /* Input is dropped by benchmark, it would make runs differ */
+            const uint64_t window_ns = window_apply_events (windows[i],
+                                       benchmark == NULL ? &simulation : NULL);
+            if (window_ns != 0 && (input_ns == 0 || window_ns < input_ns)) {
+                input_ns = window_ns;
+            }
+        }
+        TRACE_END ();
+        renderer_end_phase (&renderer, PHASE_PROCESS_EVENTS);
+        TRACE_BEGIN ("simulation");
+        /* Benchmark steps by fixed time so every run renders the same frames */
+        simulation_tick (&simulation, benchmark != NULL ? 1.0 / 60.0
+                         : timer_elapsed_ms (last_tick, frame_begin) / 1000.0);
+        last_tick = frame_begin;
+        renderer.animationTime = simulation.angle;
+        TRACE_END ();
+        renderer_end_phase (&renderer, PHASE_SIMULATION);
+        if (window_count > 0 && benchmark == NULL && !windows_are_visible ()) {
+            /* Nobody sees frames, so nothing is submitted and GPU goes idle
+             * while simulation ticks at low rate */
+            windows_end_frame ();
+            TRACE_END ();
+            event_thread_wait (HIDDEN_TICK_MS);
+            continue;
+        }
+        if (mark_resized_views (&renderer)) {
+            /* Swapchain is rebuilt before drawing, so the frame answering
+             * sync request of window manager already has the new size */
+            result = renderer_resize (&renderer);
+            if (result == VK_SUCCESS) {
+                set_live_metrics_swapchain (metrics, &renderer);
+            }
+        }
+        if (result == VK_SUCCESS) {
+            result = draw_frame (&renderer);
+            presented = result == VK_SUCCESS;
+        }
+        if (presented) {
+            windows_end_frame ();
+        }
+        TRACE_END ();
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            result = renderer_resize (&renderer);
+            if (result == VK_SUCCESS) {
+                set_live_metrics_swapchain (metrics, &renderer);
+            }
+        }
+        if (result != VK_SUCCESS) {
+            flight_recorder_record (FLIGHT_EVENT_ERROR, frame_number, result,
+                                    __LINE__, 0, 0);
+            fprintf (stderr, "%s: can't draw frame: %s\n", program_name,
+                     get_vulkan_error_string (result));
+            error = EXIT_FAILURE;
+            goto out;
+        }
+        /* GPU timings and latencies are of earlier frames, which were
+         * submitted even if this one wasn't */
+        if (renderer.hasGpuTimings) {
+            live_metrics_add_gpu_frame (metrics, renderer.gpuTimings.frame_ms);
+            benchmark_add_gpu_frame (benchmark, &renderer.gpuTimings);
+        }
+        if (benchmark != NULL) {
+            collect_present_latency (&renderer, benchmark);
+        }
+        if (!presented) {
+            /* Frame dropped by swapchain recreation would skew statistics */
+            memset (renderer.phaseCounters, 0, sizeof (renderer.phaseCounters));
+            continue;
+        }
+        /* Present interval is measured between returns of present */
+        frame_end = timer_now_ns ();
+        cpu_ms = timer_elapsed_ms (frame_begin, frame_end) - renderer.waitMs;
+        flight_recorder_record (FLIGHT_EVENT_FRAME, frame_number, VK_SUCCESS,
+                                (uint32_t)(cpu_ms * 1e3),
+                                (uint32_t)(renderer.waitMs * 1e3), 0);
+        if (input_ns != 0) {
+            live_metrics_add_input (metrics, timer_elapsed_ms (input_ns,
+                                    frame_end));
+        }
+        live_metrics_end_frame (metrics, cpu_ms, frame_end);
+        if (benchmark != NULL) {
+            for (uint32_t i = 0; i < PHASE_COUNT; i++) {
+                benchmark_add_phase_counters (benchmark, phase_names[i],
+                                              &renderer.phaseCounters[i]);
+            }
+            memset (renderer.phaseCounters, 0, sizeof (renderer.phaseCounters));
+            benchmark_end_frame (benchmark, frame_number, cpu_ms, frame_end);
+        }
+    }
+    if (benchmark_is_done (benchmark)
+            && finish_benchmark (&renderer, benchmark) != 0) {
+        fprintf (stderr, "%s: can't write benchmark report to %s\n",
+                 program_name, benchmark_output);
+        error = EXIT_FAILURE;
+    }
+out:
+    if (error != EXIT_SUCCESS && flight_recorder_dump () == 0) {
+        fprintf (stderr, "%s: flight recorder written to %s\n", program_name,
+                 flight_recorder_path ());
+    }
+    live_metrics_destroy (metrics);
+    benchmark_destroy (benchmark);
+    renderer_cleanup (&renderer);
+    for (uint32_t i = 0; i < MAX_WINDOWS && vk != VK_NULL_HANDLE; i++) {
+        vkDestroySurfaceKHR (vk, surfaces[i], NULL);
+    }
+    vkDestroyDevice (device, NULL);
+    vkDestroyInstance (vk, NULL);
+    event_thread_stop ();
+    for (uint32_t i = 0; i < window_count; i++) {
+        window_destroy (windows[i]);
+    }
+    xcb_disconnect (connection);
+    if (trace_close () != 0) {
+        fprintf (stderr, "%s: can't write trace to %s\n", program_name,
+                 trace_output);
+        error = EXIT_FAILURE;
     }
-out:
-    vkDestroySwapchainKHR (device, swapchain, NULL);
-    vkDestroySurfaceKHR (vk, surface, NULL);
-    vkDestroyDevice (device, NULL);
-    vkDestroyInstance (vk, NULL);
-    window_destroy (main_window);
-    xcb_disconnect (connection);
     return error;
 }
@@ -0,0 +1,986 @@
+/**
+ * @file microbench.c
+ * Microbenchmarks built from single commands repeated many times.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "microbench.h"
+#include "timer.h"
+#ifdef HAVE_SHADERS
+#include "shaders.h"
+#endif
+
+/** Size of each half of buffer used by copy and host-write */
+#define COPY_SIZE ((VkDeviceSize)16 << 20)
+/** Copies of COPY_SIZE recorded in one command buffer */
+#define COPY_REPEATS 4
+/** Samples of each measurement, median is reported */
+#define ITERATIONS 15
+#define SUBMIT_ITERATIONS 1000
+/** Dispatches or barriers recorded in one command buffer */
+#define COMMAND_COUNT 1000
+#define PRESENT_ITERATIONS 120
+#define MAX_PRESENT_MODES 16
+#define MAX_LABEL_LENGTH 128
+
+/** Memory properties a benchmark buffer may have, others are skipped */
+#define PLAIN_MEMORY_PROPERTIES \
+    (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT \
+     | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT \
+     | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT \
+     | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+
+typedef struct microbench_t {
+    const microbench_context_t *context;
+    VkQueue queue;
+    VkCommandPool pool;
+    VkCommandBuffer cmd;
+    VkFence fence;
+    VkQueryPool queries; /**< Begin and end timestamps, or VK_NULL_HANDLE */
+    double period_ns; /**< Nanoseconds per timestamp tick */
+    uint64_t valid_mask; /**< Mask of valid bits in timestamp value */
+    FILE *file;
+    uint32_t result_count; /**< Number of results written so far */
+} microbench_t;
+
+/** Buffer of 2 * COPY_SIZE bytes bound to memory of one type */
+typedef struct memory_buffer_t {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    VkMemoryPropertyFlags flags;
+} memory_buffer_t;
+
+static int compare_doubles (const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/** Sort samples and get their median */
+static double median (double *samples, size_t count)
+{
+    qsort (samples, count, sizeof (double), compare_doubles);
+    return samples[count / 2];
+}
+
+static void report (microbench_t *mb, const char *benchmark, const char *label,
+                    double value, const char *unit)
+{
+    fprintf (mb->file, "%s\n    {\"benchmark\": \"%s\", \"label\": ",
+             mb->result_count > 0 ? "," : "", benchmark);
+    write_json_string (mb->file, label);
+    fprintf (mb->file, ", \"value\": %.4f, \"unit\": \"%s\"}", value, unit);
+    mb->result_count++;
+}
+
+/** Start recording, with begin timestamp if queue supports them */
+static VkResult begin_commands (microbench_t *mb)
+{
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+    VkResult result = vkResetCommandPool (mb->context->device, mb->pool, 0);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkBeginCommandBuffer (mb->cmd, &beginInfo);
+    if (result == VK_SUCCESS && mb->queries != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool (mb->cmd, mb->queries, 0, 2);
+        vkCmdWriteTimestamp (mb->cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             mb->queries, 0);
+    }
+    return result;
+}
+
+/** Finish recording, submit and wait for completion
+ * @param pGpuNs receives GPU time between begin and end timestamps, or CPU
+ *        time from submit to fence signal if queue has no timestamps
+ */
+static VkResult submit_commands (microbench_t *mb, double *pGpuNs)
+{
+    uint64_t timestamps[2] = {0, 0};
+    uint64_t submitted = 0;
+    VkResult result = VK_SUCCESS;
+    const VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &mb->cmd,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL,
+    };
+    if (mb->queries != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp (mb->cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             mb->queries, 1);
+    }
+    result = vkEndCommandBuffer (mb->cmd);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    submitted = timer_now_ns ();
+    result = vkQueueSubmit (mb->queue, 1, &submitInfo, mb->fence);
+    if (result == VK_SUCCESS) {
+        result = vkWaitForFences (mb->context->device, 1, &mb->fence, VK_TRUE,
+                                  UINT64_MAX);
+    }
+    *pGpuNs = (double)(timer_now_ns () - submitted);
+    if (result == VK_SUCCESS) {
+        result = vkResetFences (mb->context->device, 1, &mb->fence);
+    }
+    if (result == VK_SUCCESS && mb->queries != VK_NULL_HANDLE) {
+        result = vkGetQueryPoolResults (mb->context->device, mb->queries, 0, 2,
+                                        sizeof (timestamps), timestamps,
+                                        sizeof (uint64_t),
+                                        VK_QUERY_RESULT_64_BIT
+                                        | VK_QUERY_RESULT_WAIT_BIT);
+        *pGpuNs = (double)((timestamps[1] - timestamps[0]) & mb->valid_mask)
+                  * mb->period_ns;
+    }
+    return result;
+}
+
+/** Describe memory type as "<index> <properties>" */
+static void describe_memory_type (char *label, size_t size, uint32_t index,
+                                  VkMemoryPropertyFlags flags)
+{
+    snprintf (label, size, "%u%s%s%s%s", index,
+              flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ? " device-local" : "",
+              flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ? " host-visible" : "",
+              flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ? " coherent" : "",
+              flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT ? " cached" : "");
+}
+
+static void destroy_buffers (VkDevice device,
+                             memory_buffer_t buffers[VK_MAX_MEMORY_TYPES])
+{
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+        vkDestroyBuffer (device, buffers[i].buffer, NULL);
+        vkFreeMemory (device, buffers[i].memory, NULL);
+    }
+    memset (buffers, 0, sizeof (memory_buffer_t) * VK_MAX_MEMORY_TYPES);
+}
+
+/** Create buffer in each memory type that has @a required properties
+ *
+ * Types that can't hold buffer, are too small or run out of memory are
+ * left with VK_NULL_HANDLE buffer.
+ */
+static VkResult create_buffers (microbench_t *mb, VkMemoryPropertyFlags required,
+                                memory_buffer_t buffers[VK_MAX_MEMORY_TYPES])
+{
+    VkDevice device = mb->context->device;
+    VkPhysicalDeviceMemoryProperties properties;
+    VkMemoryRequirements requirements;
+    VkResult result = VK_SUCCESS;
+    const VkBufferCreateInfo bufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = 2 * COPY_SIZE,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+        | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL,
+    };
+    VkMemoryAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = 0,
+        .memoryTypeIndex = 0,
+    };
+    memset (buffers, 0, sizeof (memory_buffer_t) * VK_MAX_MEMORY_TYPES);
+    vkGetPhysicalDeviceMemoryProperties (mb->context->physicalDevice,
+                                         &properties);
+    for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+        const VkMemoryType *type = &properties.memoryTypes[i];
+        memory_buffer_t *buffer = &buffers[i];
+        if ((type->propertyFlags & required) != required
+                || (type->propertyFlags
+                    & ~(VkMemoryPropertyFlags)PLAIN_MEMORY_PROPERTIES) != 0
+                || properties.memoryHeaps[type->heapIndex].size < 8 * COPY_SIZE) {
+            continue;
+        }
+        result = vkCreateBuffer (device, &bufferCreateInfo, NULL, &buffer->buffer);
+        if (result != VK_SUCCESS) {
+            goto out;
+        }
+        vkGetBufferMemoryRequirements (device, buffer->buffer, &requirements);
+        allocateInfo.allocationSize = requirements.size;
+        allocateInfo.memoryTypeIndex = i;
+        if ((requirements.memoryTypeBits & (1u << i)) == 0
+                || vkAllocateMemory (device, &allocateInfo, NULL,
+                                     &buffer->memory) != VK_SUCCESS) {
+            vkDestroyBuffer (device, buffer->buffer, NULL);
+            buffer->buffer = VK_NULL_HANDLE;
+            continue;
+        }
+        result = vkBindBufferMemory (device, buffer->buffer, buffer->memory, 0);
+        if (result != VK_SUCCESS) {
+            goto out;
+        }
+        buffer->flags = type->propertyFlags;
+    }
+    return VK_SUCCESS;
+out:
+    destroy_buffers (device, buffers);
+    return result;
+}
+
+static VkResult bench_copy (microbench_t *mb)
+{
+    memory_buffer_t buffers[VK_MAX_MEMORY_TYPES];
+    double samples[ITERATIONS];
+    char source[MAX_LABEL_LENGTH];
+    char destination[MAX_LABEL_LENGTH];
+    char label[2 * MAX_LABEL_LENGTH + 4];
+    const VkBufferCopy region = {
+        .srcOffset = 0,
+        .dstOffset = COPY_SIZE,
+        .size = COPY_SIZE,
+    };
+    VkResult result = create_buffers (mb, 0, buffers);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t src = 0; src < VK_MAX_MEMORY_TYPES; src++) {
+        for (uint32_t dst = 0; dst < VK_MAX_MEMORY_TYPES; dst++) {
+            if (buffers[src].buffer == VK_NULL_HANDLE
+                    || buffers[dst].buffer == VK_NULL_HANDLE) {
+                continue;
+            }
+            for (uint32_t i = 0; i < ITERATIONS; i++) {
+                double ns = 0.0;
+                result = begin_commands (mb);
+                if (result != VK_SUCCESS) {
+                    goto out;
+                }
+                for (uint32_t j = 0; j < COPY_REPEATS; j++) {
+                    vkCmdCopyBuffer (mb->cmd, buffers[src].buffer,
+                                     buffers[dst].buffer, 1, &region);
+                }
+                result = submit_commands (mb, &ns);
+                if (result != VK_SUCCESS) {
+                    goto out;
+                }
+                /* Bytes per nanosecond are gigabytes per second */
+                samples[i] = (double)(COPY_SIZE * COPY_REPEATS) / ns;
+            }
+            describe_memory_type (source, sizeof (source), src,
+                                  buffers[src].flags);
+            describe_memory_type (destination, sizeof (destination), dst,
+                                  buffers[dst].flags);
+            snprintf (label, sizeof (label), "%s to %s", source, destination);
+            report (mb, "copy", label, median (samples, ITERATIONS), "GB/s");
+        }
+    }
+out:
+    destroy_buffers (mb->context->device, buffers);
+    return result;
+}
+
+static VkResult bench_host_write (microbench_t *mb)
+{
+    memory_buffer_t buffers[VK_MAX_MEMORY_TYPES];
+    double samples[ITERATIONS];
+    char label[MAX_LABEL_LENGTH];
+    VkDevice device = mb->context->device;
+    VkResult result = create_buffers (mb, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                      buffers);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t type = 0; type < VK_MAX_MEMORY_TYPES; type++) {
+        void *data = NULL;
+        VkMappedMemoryRange range = {
+            .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            .pNext = NULL,
+            .memory = buffers[type].memory,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+        if (buffers[type].buffer == VK_NULL_HANDLE) {
+            continue;
+        }
+        result = vkMapMemory (device, buffers[type].memory, 0, VK_WHOLE_SIZE, 0,
+                              &data);
+        if (result != VK_SUCCESS) {
+            goto out;
+        }
+        for (uint32_t i = 0; i < ITERATIONS && result == VK_SUCCESS; i++) {
+            const uint64_t begin = timer_now_ns ();
+            memset (data, (int)i, (size_t)(2 * COPY_SIZE));
+            if ((buffers[type].flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+                result = vkFlushMappedMemoryRanges (device, 1, &range);
+            }
+            samples[i] = (double)(2 * COPY_SIZE) / (double)(timer_now_ns () - begin);
+        }
+        vkUnmapMemory (device, buffers[type].memory);
+        if (result != VK_SUCCESS) {
+            goto out;
+        }
+        describe_memory_type (label, sizeof (label), type, buffers[type].flags);
+        report (mb, "host-write", label, median (samples, ITERATIONS), "GB/s");
+    }
+out:
+    destroy_buffers (device, buffers);
+    return result;
+}
+
+/** Measure submit of @a commandBufferCount empty command buffers
+ * @param pMicroseconds receives median time from submit to fence wait return
+ */
+static VkResult measure_submit (microbench_t *mb, uint32_t commandBufferCount,
+                                double *pMicroseconds)
+{
+    static double samples[SUBMIT_ITERATIONS];
+    VkDevice device = mb->context->device;
+    VkResult result = VK_SUCCESS;
+    const VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = commandBufferCount,
+        .pCommandBuffers = &mb->cmd,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL,
+    };
+    for (uint32_t i = 0; i < SUBMIT_ITERATIONS; i++) {
+        const uint64_t begin = timer_now_ns ();
+        result = vkQueueSubmit (mb->queue, commandBufferCount > 0 ? 1 : 0,
+                                &submitInfo, mb->fence);
+        if (result == VK_SUCCESS) {
+            result = vkWaitForFences (device, 1, &mb->fence, VK_TRUE, UINT64_MAX);
+        }
+        samples[i] = timer_elapsed_ms (begin, timer_now_ns ()) * 1e3;
+        if (result == VK_SUCCESS) {
+            result = vkResetFences (device, 1, &mb->fence);
+        }
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    *pMicroseconds = median (samples, SUBMIT_ITERATIONS);
+    return result;
+}
+
+static VkResult bench_submit (microbench_t *mb)
+{
+    double microseconds = 0.0;
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .pInheritanceInfo = NULL,
+    };
+    VkResult result = measure_submit (mb, 0, &microseconds);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    report (mb, "submit", "no command buffers", microseconds, "us");
+    result = vkResetCommandPool (mb->context->device, mb->pool, 0);
+    if (result == VK_SUCCESS) {
+        result = vkBeginCommandBuffer (mb->cmd, &beginInfo);
+    }
+    if (result == VK_SUCCESS) {
+        result = vkEndCommandBuffer (mb->cmd);
+    }
+    if (result == VK_SUCCESS) {
+        result = measure_submit (mb, 1, &microseconds);
+    }
+    if (result == VK_SUCCESS) {
+        report (mb, "submit", "empty command buffer", microseconds, "us");
+    }
+    return result;
+}
+
+#ifdef HAVE_SHADERS
+static VkResult bench_dispatch (microbench_t *mb)
+{
+    VkDevice device = mb->context->device;
+    VkShaderModule module = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    double gpu[ITERATIONS];
+    double record[ITERATIONS];
+    const VkShaderModuleCreateInfo moduleCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .codeSize = empty_comp_spv_size,
+        .pCode = empty_comp_spv,
+    };
+    const VkPipelineLayoutCreateInfo layoutCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .setLayoutCount = 0,
+        .pSetLayouts = NULL,
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges = NULL,
+    };
+    VkComputePipelineCreateInfo pipelineCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = VK_NULL_HANDLE,
+            .pName = "main",
+            .pSpecializationInfo = NULL,
+        },
+        .layout = VK_NULL_HANDLE,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+    VkResult result = vkCreateShaderModule (device, &moduleCreateInfo, NULL,
+                                            &module);
+    if (result != VK_SUCCESS) {
+        goto out;
+    }
+    result = vkCreatePipelineLayout (device, &layoutCreateInfo, NULL, &layout);
+    if (result != VK_SUCCESS) {
+        goto out;
+    }
+    pipelineCreateInfo.stage.module = module;
+    pipelineCreateInfo.layout = layout;
+    result = vkCreateComputePipelines (device, VK_NULL_HANDLE, 1,
+                                       &pipelineCreateInfo, NULL, &pipeline);
+    if (result != VK_SUCCESS) {
+        goto out;
+    }
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        uint64_t begin = 0;
+        result = begin_commands (mb);
+        if (result != VK_SUCCESS) {
+            goto out;
+        }
+        vkCmdBindPipeline (mb->cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        begin = timer_now_ns ();
+        for (uint32_t j = 0; j < COMMAND_COUNT; j++) {
+            vkCmdDispatch (mb->cmd, 1, 1, 1);
+        }
+        record[i] = (double)(timer_now_ns () - begin) / COMMAND_COUNT;
+        result = submit_commands (mb, &gpu[i]);
+        if (result != VK_SUCCESS) {
+            goto out;
+        }
+        gpu[i] /= COMMAND_COUNT;
+    }
+    report (mb, "dispatch", "gpu", median (gpu, ITERATIONS), "ns");
+    report (mb, "dispatch", "record", median (record, ITERATIONS), "ns");
+out:
+    vkDestroyPipeline (device, pipeline, NULL);
+    vkDestroyPipelineLayout (device, layout, NULL);
+    vkDestroyShaderModule (device, module, NULL);
+    return result;
+}
+#else
+static VkResult bench_dispatch (microbench_t *mb)
+{
+    (void)mb;
+    fprintf (stderr, "dispatch microbenchmark needs shaders compiled in\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+}
+#endif
+
+static VkResult bench_barrier (microbench_t *mb)
+{
+    double gpu[ITERATIONS];
+    double record[ITERATIONS];
+    const VkMemoryBarrier memoryBarrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+    };
+    VkResult result = VK_SUCCESS;
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        uint64_t begin = 0;
+        result = begin_commands (mb);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        begin = timer_now_ns ();
+        for (uint32_t j = 0; j < COMMAND_COUNT; j++) {
+            vkCmdPipelineBarrier (mb->cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                                  1, &memoryBarrier, 0, NULL, 0, NULL);
+        }
+        record[i] = (double)(timer_now_ns () - begin) / COMMAND_COUNT;
+        result = submit_commands (mb, &gpu[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        gpu[i] /= COMMAND_COUNT;
+    }
+    report (mb, "barrier", "gpu", median (gpu, ITERATIONS), "ns");
+    report (mb, "barrier", "record", median (record, ITERATIONS), "ns");
+    return result;
+}
+
+/** Record transition of swapchain image to present layout
+ *
+ * Nothing is drawn, so round trip is bound by presentation engine only.
+ */
+static VkResult record_present_transition (VkCommandBuffer cmd, VkImage image)
+{
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .pInheritanceInfo = NULL,
+    };
+    const VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = 0,
+        .dstAccessMask = 0,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    VkResult result = vkBeginCommandBuffer (cmd, &beginInfo);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    vkCmdPipelineBarrier (cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0,
+                          NULL, 1, &barrier);
+    return vkEndCommandBuffer (cmd);
+}
+
+/** Measure acquire, submit and present of one image with @a presentMode
+ * @param format format and color space of swapchain images
+ * @param pMilliseconds receives median time of the round trip
+ */
+static VkResult measure_present_mode (microbench_t *mb,
+                                      const VkSurfaceCapabilitiesKHR *capabilities,
+                                      const VkSurfaceFormatKHR *format,
+                                      VkPresentModeKHR presentMode,
+                                      double *pMilliseconds)
+{
+    static double samples[PRESENT_ITERATIONS];
+    VkDevice device = mb->context->device;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    VkSemaphore acquired = VK_NULL_HANDLE;
+    VkSemaphore transitioned = VK_NULL_HANDLE;
+    VkCommandPool pool = VK_NULL_HANDLE;
+    VkCommandBuffer cmds[MAX_SWAPCHAIN_IMAGES];
+    VkImage images[MAX_SWAPCHAIN_IMAGES];
+    uint32_t imageCount = MAX_SWAPCHAIN_IMAGES;
+    uint32_t sampleCount = 0;
+    const VkPipelineStageFlags waitStage =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkSwapchainCreateInfoKHR swapchainCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+        .pNext = NULL,
+        .flags = 0,
+        .surface = mb->context->surface,
+        .minImageCount = capabilities->minImageCount,
+        .imageFormat = format->format,
+        .imageColorSpace = format->colorSpace,
+        .imageExtent = capabilities->currentExtent,
+        .imageArrayLayers = 1,
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &mb->context->queueFamilyIndex,
+        .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
+        .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+        .presentMode = presentMode,
+        .clipped = VK_TRUE,
+        .oldSwapchain = VK_NULL_HANDLE,
+    };
+    const VkSemaphoreCreateInfo semaphoreCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+    const VkCommandPoolCreateInfo poolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queueFamilyIndex = mb->context->queueFamilyIndex,
+    };
+    VkCommandBufferAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = VK_NULL_HANDLE,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 0,
+    };
+    VkResult result = VK_SUCCESS;
+    if (capabilities->currentExtent.width == UINT32_MAX) {
+        swapchainCreateInfo.imageExtent = mb->context->extent;
+    }
+    if (swapchainCreateInfo.minImageCount < 2
+            && (capabilities->maxImageCount == 0
+                || capabilities->maxImageCount >= 2)) {
+        swapchainCreateInfo.minImageCount = 2;
+    }
+    result = vkCreateSwapchainKHR (device, &swapchainCreateInfo, NULL,
+                                   &swapchain);
+    if (result != VK_SUCCESS) {
+        goto out;
+    }
+    result = vkGetSwapchainImagesKHR (device, swapchain, &imageCount, images);
+    if (result == VK_INCOMPLETE) {
+        /* Acquired index could point past command buffers otherwise */
+        fprintf (stderr, "present microbenchmark supports at most %d "
+                 "swapchain images\n", MAX_SWAPCHAIN_IMAGES);
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+    if (result != VK_SUCCESS) {
+        goto out;
+    }
+    result = vkCreateCommandPool (device, &poolCreateInfo, NULL, &pool);
+    if (result != VK_SUCCESS) {
+        goto out;
+    }
+    allocateInfo.commandPool = pool;
+    allocateInfo.commandBufferCount = imageCount;
+    result = vkAllocateCommandBuffers (device, &allocateInfo, cmds);
+    for (uint32_t i = 0; i < imageCount && result == VK_SUCCESS; i++) {
+        result = record_present_transition (cmds[i], images[i]);
+    }
+    if (result == VK_SUCCESS) {
+        result = vkCreateSemaphore (device, &semaphoreCreateInfo, NULL, &acquired);
+    }
+    if (result == VK_SUCCESS) {
+        result = vkCreateSemaphore (device, &semaphoreCreateInfo, NULL,
+                                    &transitioned);
+    }
+    while (result == VK_SUCCESS && sampleCount < PRESENT_ITERATIONS) {
+        const uint64_t begin = timer_now_ns ();
+        uint32_t imageIndex = 0;
+        VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = NULL,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &acquired,
+            .pWaitDstStageMask = &waitStage,
+            .commandBufferCount = 1,
+            .pCommandBuffers = NULL,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &transitioned,
+        };
+        VkPresentInfoKHR presentInfo = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .pNext = NULL,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &transitioned,
+            .swapchainCount = 1,
+            .pSwapchains = &swapchain,
+            .pImageIndices = NULL,
+            .pResults = NULL,
+        };
+        result = vkAcquireNextImageKHR (device, swapchain, UINT64_MAX, acquired,
+                                        VK_NULL_HANDLE, &imageIndex);
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            break;
+        }
+        submitInfo.pCommandBuffers = &cmds[imageIndex];
+        presentInfo.pImageIndices = &imageIndex;
+        result = vkQueueSubmit (mb->queue, 1, &submitInfo, VK_NULL_HANDLE);
+        if (result == VK_SUCCESS) {
+            result = vkQueuePresentKHR (mb->queue, &presentInfo);
+        }
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+            /* Semaphores are reused only when queue has consumed them */
+            result = vkQueueWaitIdle (mb->queue);
+        }
+        samples[sampleCount++] = timer_elapsed_ms (begin, timer_now_ns ());
+    }
+    if (result == VK_SUCCESS) {
+        *pMilliseconds = median (samples, sampleCount);
+    }
+out:
+    vkDeviceWaitIdle (device);
+    vkDestroySemaphore (device, acquired, NULL);
+    vkDestroySemaphore (device, transitioned, NULL);
+    vkDestroyCommandPool (device, pool, NULL);
+    vkDestroySwapchainKHR (device, swapchain, NULL);
+    return result;
+}
+
+static VkResult bench_present (microbench_t *mb)
+{
+    VkSurfaceCapabilitiesKHR capabilities;
+    VkPresentModeKHR presentModes[MAX_PRESENT_MODES];
+    uint32_t presentModeCount = MAX_PRESENT_MODES;
+    double milliseconds = 0.0;
+    VkResult result = VK_SUCCESS;
+    if (mb->context->surface == VK_NULL_HANDLE) {
+        fprintf (stderr, "present microbenchmark needs surface\n");
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+    result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR (
+                 mb->context->physicalDevice, mb->context->surface, &capabilities);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkGetPhysicalDeviceSurfacePresentModesKHR (
+                 mb->context->physicalDevice, mb->context->surface,
+                 &presentModeCount, presentModes);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        return result;
+    }
+    for (uint32_t i = 0; i < presentModeCount; i++) {
+        result = measure_present_mode (mb, &capabilities, &mb->context->format,
+                                       presentModes[i], &milliseconds);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        report (mb, "present", get_present_mode_string (presentModes[i]),
+                milliseconds, "ms");
+    }
+    return VK_SUCCESS;
+}
+
+/** Measure present round trip with each format surface supports
+ *
+ * Formats that scanout can't take directly cost conversion on present.
+ * Mode without vertical sync is used when available, so that refresh
+ * rate doesn't hide the conversion.
+ */
+static VkResult bench_present_format (microbench_t *mb)
+{
+    VkSurfaceCapabilitiesKHR capabilities;
+    VkPresentModeKHR presentModes[MAX_PRESENT_MODES];
+    uint32_t presentModeCount = MAX_PRESENT_MODES;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkSurfaceFormatKHR formats[MAX_SURFACE_FORMATS];
+    uint32_t formatCount = MAX_SURFACE_FORMATS;
+    double milliseconds = 0.0;
+    VkResult result = VK_SUCCESS;
+    if (mb->context->surface == VK_NULL_HANDLE) {
+        fprintf (stderr, "present-format microbenchmark needs surface\n");
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+    result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR (
+                 mb->context->physicalDevice, mb->context->surface, &capabilities);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkGetPhysicalDeviceSurfacePresentModesKHR (
+                 mb->context->physicalDevice, mb->context->surface,
+                 &presentModeCount, presentModes);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        return result;
+    }
+    for (uint32_t i = 0; i < presentModeCount; i++) {
+        if (presentModes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR
+                || (presentModes[i] == VK_PRESENT_MODE_MAILBOX_KHR
+                    && presentMode != VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+            presentMode = presentModes[i];
+        }
+    }
+    result = vkGetPhysicalDeviceSurfaceFormatsKHR (
+                 mb->context->physicalDevice, mb->context->surface,
+                 &formatCount, formats);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        return result;
+    }
+    if (formatCount == 1 && formats[0].format == VK_FORMAT_UNDEFINED) {
+        /* Surface takes any format, measure the one used for rendering */
+        formats[0] = mb->context->format;
+    }
+    for (uint32_t i = 0; i < formatCount; i++) {
+        const char *name = get_format_string (formats[i].format);
+        char label[MAX_LABEL_LENGTH];
+        result = measure_present_mode (mb, &capabilities, &formats[i],
+                                       presentMode, &milliseconds);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        if (name != NULL) {
+            snprintf (label, sizeof (label), "%s %s", name,
+                      get_present_mode_string (presentMode));
+        } else {
+            snprintf (label, sizeof (label), "format %d %s",
+                      formats[i].format, get_present_mode_string (presentMode));
+        }
+        if (formats[i].colorSpace != VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            size_t length = strlen (label);
+            snprintf (label + length, sizeof (label) - length,
+                      " color space %d", formats[i].colorSpace);
+        }
+        report (mb, "present-format", label, milliseconds, "ms");
+    }
+    return VK_SUCCESS;
+}
+
+/** Microbenchmarks in the order "all" runs them */
+static const struct {
+    const char *name;
+    VkResult (*run) (microbench_t *mb);
+} microbenchmarks[] = {
+    {"copy", bench_copy},
+    {"host-write", bench_host_write},
+    {"submit", bench_submit},
+    {"dispatch", bench_dispatch},
+    {"barrier", bench_barrier},
+    {"present", bench_present},
+    {"present-format", bench_present_format},
+};
+
+#define MICROBENCHMARK_COUNT (sizeof (microbenchmarks) / sizeof (microbenchmarks[0]))
+
+int microbench_is_known (const char *name)
+{
+    if (strcmp (name, "all") == 0) {
+        return 1;
+    }
+    for (size_t i = 0; i < MICROBENCHMARK_COUNT; i++) {
+        if (strcmp (name, microbenchmarks[i].name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Create command pool, fence and timestamp queries shared by benchmarks */
+static VkResult microbench_init (microbench_t *mb,
+                                 const microbench_context_t *context)
+{
+    VkQueueFamilyProperties families[MAX_QUEUE_FAMILY_PROPERTIES];
+    uint32_t familyCount = MAX_QUEUE_FAMILY_PROPERTIES;
+    uint32_t validBits = 0;
+    VkDevice device = context->device;
+    const VkCommandPoolCreateInfo poolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = context->queueFamilyIndex,
+    };
+    VkCommandBufferAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = VK_NULL_HANDLE,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    const VkFenceCreateInfo fenceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+    const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2,
+        .pipelineStatistics = 0,
+    };
+    VkResult result = VK_SUCCESS;
+    memset (mb, 0, sizeof (*mb));
+    mb->context = context;
+    vkGetDeviceQueue (device, context->queueFamilyIndex, 0, &mb->queue);
+    vkGetPhysicalDeviceQueueFamilyProperties (context->physicalDevice,
+            &familyCount, families);
+    if (familyCount > context->queueFamilyIndex) {
+        validBits = families[context->queueFamilyIndex].timestampValidBits;
+    }
+    result = vkCreateCommandPool (device, &poolCreateInfo, NULL, &mb->pool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    allocateInfo.commandPool = mb->pool;
+    result = vkAllocateCommandBuffers (device, &allocateInfo, &mb->cmd);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkCreateFence (device, &fenceCreateInfo, NULL, &mb->fence);
+    if (result != VK_SUCCESS || validBits == 0) {
+        return result;
+    }
+    mb->period_ns = (double)context->properties->limits.timestampPeriod;
+    mb->valid_mask = validBits >= 64 ? UINT64_MAX
+                     : (((uint64_t)1 << validBits) - 1);
+    return vkCreateQueryPool (device, &queryPoolCreateInfo, NULL, &mb->queries);
+}
+
+static void microbench_cleanup (microbench_t *mb)
+{
+    VkDevice device = mb->context->device;
+    vkDestroyQueryPool (device, mb->queries, NULL);
+    vkDestroyFence (device, mb->fence, NULL);
+    vkDestroyCommandPool (device, mb->pool, NULL);
+}
+
+VkResult microbench_run (const microbench_context_t *context,
+                         const char *name, const char *path)
+{
+    const int is_stdout = path == NULL || strcmp (path, "-") == 0;
+    const int is_all = strcmp (name, "all") == 0;
+    const VkPhysicalDeviceProperties *properties = context->properties;
+    microbench_t mb;
+    VkResult result = microbench_init (&mb, context);
+    if (result != VK_SUCCESS) {
+        goto out;
+    }
+    mb.file = is_stdout ? stdout : fopen (path, "w");
+    if (mb.file == NULL) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+        goto out;
+    }
+    fprintf (mb.file, "{\n  \"device\": {\n    \"name\": ");
+    write_json_string (mb.file, properties->deviceName);
+    fprintf (mb.file, ",\n"
+             "    \"vendorID\": %u,\n"
+             "    \"deviceID\": %u,\n"
+             "    \"driverVersion\": %u,\n"
+             "    \"apiVersion\": %u\n"
+             "  },\n  \"timestamps\": %s,\n  \"results\": [",
+             properties->vendorID, properties->deviceID,
+             properties->driverVersion, properties->apiVersion,
+             mb.queries != VK_NULL_HANDLE ? "true" : "false");
+    for (size_t i = 0; i < MICROBENCHMARK_COUNT; i++) {
+        if (!is_all && strcmp (name, microbenchmarks[i].name) != 0) {
+            continue;
+        }
+        result = microbenchmarks[i].run (&mb);
+        if (is_all && result == VK_ERROR_FEATURE_NOT_PRESENT) {
+            result = VK_SUCCESS;
+        }
+        if (result != VK_SUCCESS) {
+            break;
+        }
+    }
+    fprintf (mb.file, "%s]\n}\n", mb.result_count > 0 ? "\n  " : "");
+    if (!is_stdout && fclose (mb.file) != 0 && result == VK_SUCCESS) {
+        result = VK_ERROR_INITIALIZATION_FAILED;
+    }
+out:
+    vkDeviceWaitIdle (context->device);
+    microbench_cleanup (&mb);
+    return result;
+}
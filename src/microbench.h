@@ -0,0 +1,47 @@
+/**
+ * @file microbench.h
+ * Isolated GPU microbenchmarks that characterize driver and host.
+ *
+ * Available microbenchmarks:
+ * - copy: vkCmdCopyBuffer bandwidth between each pair of memory types
+ * - host-write: CPU write bandwidth to each host visible memory type
+ * - submit: latency of empty vkQueueSubmit waited on with fence
+ * - dispatch: GPU and recording cost of vkCmdDispatch, needs shaders
+ * - barrier: GPU and recording cost of vkCmdPipelineBarrier
+ * - present: acquire/present round trip for each present mode
+ * - present-format: acquire/present round trip for each surface format
+ * - all: every one of the above
+ */
+#ifndef VKBOOTSTRAP_MICROBENCH_H
+#define VKBOOTSTRAP_MICROBENCH_H
+#include <vulkan/vulkan.h>
+
+/** Device and surface the microbenchmarks run on */
+typedef struct microbench_context_t {
+    VkPhysicalDevice physicalDevice;
+    const VkPhysicalDeviceProperties *properties;
+    VkDevice device;
+    uint32_t queueFamilyIndex; /**< Family of queue 0 used for submits */
+    VkSurfaceKHR surface; /**< VK_NULL_HANDLE if present can't be measured */
+    VkSurfaceFormatKHR format; /**< Format of swapchain images */
+    VkExtent2D extent; /**< Size of swapchain images if surface has none */
+} microbench_context_t;
+
+/** Check if microbenchmark with this name exists
+ * @param name name of microbenchmark or "all"
+ * @returns non-zero if @a name is known
+ */
+int microbench_is_known (const char *name);
+
+/** Run microbenchmark and write results as JSON
+ *
+ * Device must be idle, it is left idle on return.
+ * @param context device to measure
+ * @param name name of microbenchmark or "all"
+ * @param path file to write, "-" or NULL for standard output
+ * @returns VK_ERROR_INITIALIZATION_FAILED if report can't be written
+ */
+VkResult microbench_run (const microbench_context_t *context,
+                         const char *name, const char *path);
+
+#endif
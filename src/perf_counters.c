@@ -0,0 +1,187 @@
+/**
+ * @file perf_counters.c
+ * Group of perf events read with one read() call.
+ */
+#define _GNU_SOURCE
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "perf_counters.h"
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+struct perf_counters_t {
+    int leader; /**< File descriptor of group leader */
+    int fds[PERF_COUNTER_COUNT]; /**< -1 if counter is not available */
+    uint64_t ids[PERF_COUNTER_COUNT]; /**< Kernel id of each event */
+    uint32_t valid; /**< Mask of opened counters */
+};
+
+/** Type and config of each perf_counter_t */
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} counter_events[PERF_COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache_misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_misses"},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "context_switches"},
+};
+
+/** Open one event of calling thread
+ * @param group_fd leader of group to join, -1 to create new group
+ * @returns file descriptor, -1 on error
+ */
+static int open_event (perf_counter_t counter, int group_fd)
+{
+    struct perf_event_attr attr;
+    int fd = -1;
+    memset (&attr, 0, sizeof (attr));
+    attr.size = sizeof (attr);
+    attr.type = counter_events[counter].type;
+    attr.config = counter_events[counter].config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+                       | PERF_FORMAT_TOTAL_TIME_ENABLED
+                       | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_hv = 1;
+    fd = (int)syscall (SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    if (fd < 0) {
+        /* perf_event_paranoid 2 allows user space counting only */
+        attr.exclude_kernel = 1;
+        fd = (int)syscall (SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+    return fd;
+}
+
+perf_counters_t *perf_counters_open (void)
+{
+    perf_counters_t *counters = (perf_counters_t *)calloc (1,
+                                sizeof (perf_counters_t));
+    if (counters == NULL) {
+        return NULL;
+    }
+    counters->leader = -1;
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        const int fd = open_event ((perf_counter_t)i, counters->leader);
+        counters->fds[i] = fd;
+        if (fd < 0) {
+            continue;
+        }
+        if (ioctl (fd, PERF_EVENT_IOC_ID, &counters->ids[i]) != 0) {
+            close (fd);
+            counters->fds[i] = -1;
+            continue;
+        }
+        if (counters->leader < 0) {
+            counters->leader = fd;
+        }
+        counters->valid |= 1u << i;
+    }
+    if (counters->valid == 0) {
+        free (counters);
+        return NULL;
+    }
+    return counters;
+}
+
+void perf_counters_close (perf_counters_t *counters)
+{
+    if (counters == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (counters->fds[i] >= 0) {
+            close (counters->fds[i]);
+        }
+    }
+    free (counters);
+}
+
+int perf_counters_read (perf_counters_t *counters, perf_sample_t *sample)
+{
+    /* nr, time_enabled, time_running, then value and id of each event */
+    uint64_t data[3 + 2 * PERF_COUNTER_COUNT];
+    ssize_t size = 0;
+    double scale = 1.0;
+    memset (sample, 0, sizeof (*sample));
+    size = read (counters->leader, data, sizeof (data));
+    if (size < (ssize_t)(3 * sizeof (uint64_t))
+            || (size_t)size < (3 + 2 * data[0]) * sizeof (uint64_t)) {
+        return 0;
+    }
+    if (data[2] == 0) {
+        /* Group hasn't been scheduled on CPU yet */
+        sample->valid = counters->valid;
+        return 1;
+    }
+    if (data[2] < data[1]) {
+        scale = (double)data[1] / (double)data[2];
+    }
+    for (uint64_t i = 0; i < data[0]; i++) {
+        const uint64_t value = data[3 + 2 * i];
+        const uint64_t id = data[4 + 2 * i];
+        for (uint32_t j = 0; j < PERF_COUNTER_COUNT; j++) {
+            if ((counters->valid & (1u << j)) && counters->ids[j] == id) {
+                sample->values[j] = (uint64_t)((double)value * scale);
+                sample->valid |= 1u << j;
+            }
+        }
+    }
+    return 1;
+}
+
+const char *perf_counter_name (perf_counter_t counter)
+{
+    return counter < PERF_COUNTER_COUNT ? counter_events[counter].name : NULL;
+}
+
+#else
+
+static const char *const counter_names[PERF_COUNTER_COUNT] = {
+    "cycles", "instructions", "cache_misses", "branch_misses",
+    "context_switches",
+};
+
+perf_counters_t *perf_counters_open (void)
+{
+    return NULL;
+}
+
+void perf_counters_close (perf_counters_t *counters)
+{
+    (void)counters;
+}
+
+int perf_counters_read (perf_counters_t *counters, perf_sample_t *sample)
+{
+    (void)counters;
+    memset (sample, 0, sizeof (*sample));
+    return 0;
+}
+
+const char *perf_counter_name (perf_counter_t counter)
+{
+    return counter < PERF_COUNTER_COUNT ? counter_names[counter] : NULL;
+}
+
+#endif
+
+void perf_sample_add_delta (perf_sample_t *total, const perf_sample_t *begin,
+                            const perf_sample_t *end)
+{
+    const uint32_t valid = begin->valid & end->valid;
+    for (uint32_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if ((valid & (1u << i)) && end->values[i] >= begin->values[i]) {
+            total->values[i] += end->values[i] - begin->values[i];
+        }
+    }
+    total->valid |= valid;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file perf_counters.h
+ * CPU hardware counters of a thread read with perf_event_open.
+ */
+#ifndef VKBOOTSTRAP_PERF_COUNTERS_H
+#define VKBOOTSTRAP_PERF_COUNTERS_H
+#include <stdint.h>
+
+/** Counters that are opened for each thread */
+typedef enum perf_counter_t {
+    PERF_COUNTER_CYCLES = 0,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_CACHE_MISSES,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_CONTEXT_SWITCHES,
+    PERF_COUNTER_COUNT
+} perf_counter_t;
+
+/** Values of counters, either totals since opening or difference of them */
+typedef struct perf_sample_t {
+    uint32_t valid; /**< Bit (1 << counter) is set if counter is available */
+    uint64_t values[PERF_COUNTER_COUNT];
+} perf_sample_t;
+
+typedef struct perf_counters_t perf_counters_t;
+
+/** Open counters of calling thread
+ *
+ * Counters may be unavailable because of kernel.perf_event_paranoid,
+ * seccomp policy of container or missing PMU of virtual machine, so any
+ * subset of them can be opened.
+ * @returns counters, NULL if none of them can be opened or not on Linux
+ */
+perf_counters_t *perf_counters_open (void);
+
+/** Close counters
+ * @param counters counters to close, can be NULL
+ */
+void perf_counters_close (perf_counters_t *counters);
+
+/** Read current values of counters
+ *
+ * Values are scaled up if kernel multiplexed counters with other events.
+ * @param counters counters to read, must be read by thread that opened them
+ * @param sample receives values, its valid mask is 0 on error
+ * @returns 0 if counters can't be read
+ */
+int perf_counters_read (perf_counters_t *counters, perf_sample_t *sample);
+
+/** Add difference between two samples to total
+ * @param total sample to accumulate into
+ * @param begin earlier sample
+ * @param end later sample
+ */
+void perf_sample_add_delta (perf_sample_t *total, const perf_sample_t *begin,
+                            const perf_sample_t *end);
+
+/** Get short name of counter, used in reports */
+const char *perf_counter_name (perf_counter_t counter);
+
+#endif
@@ -0,0 +1,362 @@
+/**
+ * @file pipeline_compiler.c
+ * Worker threads that create pipelines while the render loop keeps going.
+ */
+#define _POSIX_C_SOURCE 200809L
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pipeline_compiler.h"
+#include "trace.h"
+
+#define MAX_WORKERS 4
+
+/** State of pipeline request */
+enum {
+    REQUEST_PENDING = 0,
+    REQUEST_READY,
+    REQUEST_FAILED,
+};
+
+struct pipeline_request_t {
+    pipeline_build_fn build;
+    const void *description;
+    VkPipeline pipeline; /**< Valid once state is REQUEST_READY */
+    VkResult result;
+    atomic_int state; /**< REQUEST_* published with release semantics */
+    pipeline_request_t *next; /**< Next request owned by compiler */
+    pipeline_request_t *next_job; /**< Next request in queue of workers */
+};
+
+struct pipeline_compiler_t {
+    VkDevice device;
+    VkPipelineCache cache;
+    pthread_mutex_t lock; /**< Protects everything below */
+    pthread_cond_t has_jobs;
+    pipeline_request_t *requests; /**< All requests ever made */
+    pipeline_request_t *first_job;
+    pipeline_request_t *last_job;
+    int is_stopping;
+    int count_events; /**< true if workers open perf counters */
+    perf_sample_t counters; /**< CPU counters of all builds so far */
+    uint32_t worker_count;
+    pthread_t workers[MAX_WORKERS];
+};
+
+/** Take next request from queue, waiting for one
+ * @returns NULL if compiler is being destroyed
+ */
+static pipeline_request_t *next_job (pipeline_compiler_t *compiler)
+{
+    pipeline_request_t *request = NULL;
+    pthread_mutex_lock (&compiler->lock);
+    while (compiler->first_job == NULL && !compiler->is_stopping) {
+        pthread_cond_wait (&compiler->has_jobs, &compiler->lock);
+    }
+    if (!compiler->is_stopping) {
+        request = compiler->first_job;
+        compiler->first_job = request->next_job;
+        if (compiler->first_job == NULL) {
+            compiler->last_job = NULL;
+        }
+    }
+    pthread_mutex_unlock (&compiler->lock);
+    return request;
+}
+
+static void *worker_main (void *arg)
+{
+    pipeline_compiler_t *compiler = (pipeline_compiler_t *)arg;
+    pipeline_request_t *request = NULL;
+    perf_counters_t *counters = NULL;
+    perf_sample_t begin, end;
+    TRACE_THREAD_NAME ("pipeline compiler");
+    if (compiler->count_events) {
+        counters = perf_counters_open ();
+    }
+    while ((request = next_job (compiler)) != NULL) {
+        TRACE_BEGIN ("build pipeline");
+        if (counters != NULL) {
+            perf_counters_read (counters, &begin);
+        }
+        request->result = request->build (compiler->device, compiler->cache,
+                                          request->description,
+                                          &request->pipeline);
+        if (counters != NULL && perf_counters_read (counters, &end)) {
+            pthread_mutex_lock (&compiler->lock);
+            perf_sample_add_delta (&compiler->counters, &begin, &end);
+            pthread_mutex_unlock (&compiler->lock);
+        }
+        TRACE_END ();
+        atomic_store_explicit (&request->state,
+                               request->result == VK_SUCCESS ? REQUEST_READY
+                               : REQUEST_FAILED, memory_order_release);
+    }
+    perf_counters_close (counters);
+    return NULL;
+}
+
+VkResult pipeline_compiler_create (VkDevice device, VkPipelineCache cache,
+                                   uint32_t thread_count, int count_events,
+                                   pipeline_compiler_t **pCompiler)
+{
+    pipeline_compiler_t *compiler = NULL;
+    *pCompiler = NULL;
+    if (thread_count == 0) {
+        /* Leave one CPU to the render loop */
+        long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 1 ? (uint32_t)(cpus - 1) : 1;
+    }
+    if (thread_count > MAX_WORKERS) {
+        thread_count = MAX_WORKERS;
+    }
+    compiler = (pipeline_compiler_t *)calloc (1, sizeof (pipeline_compiler_t));
+    if (compiler == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    compiler->device = device;
+    compiler->cache = cache;
+    compiler->count_events = count_events;
+    pthread_mutex_init (&compiler->lock, NULL);
+    pthread_cond_init (&compiler->has_jobs, NULL);
+    for (uint32_t i = 0; i < thread_count; i++) {
+        if (pthread_create (&compiler->workers[i], NULL, worker_main, compiler)) {
+            break;
+        }
+        compiler->worker_count = i + 1;
+    }
+    if (compiler->worker_count == 0) {
+        pipeline_compiler_destroy (compiler);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    *pCompiler = compiler;
+    return VK_SUCCESS;
+}
+
+void pipeline_compiler_destroy (pipeline_compiler_t *compiler)
+{
+    pipeline_request_t *request = NULL;
+    if (compiler == NULL) {
+        return;
+    }
+    pthread_mutex_lock (&compiler->lock);
+    compiler->is_stopping = 1;
+    pthread_cond_broadcast (&compiler->has_jobs);
+    pthread_mutex_unlock (&compiler->lock);
+    for (uint32_t i = 0; i < compiler->worker_count; i++) {
+        pthread_join (compiler->workers[i], NULL);
+    }
+    while ((request = compiler->requests) != NULL) {
+        compiler->requests = request->next;
+        if (atomic_load (&request->state) == REQUEST_READY) {
+            vkDestroyPipeline (compiler->device, request->pipeline, NULL);
+        }
+        free (request);
+    }
+    pthread_cond_destroy (&compiler->has_jobs);
+    pthread_mutex_destroy (&compiler->lock);
+    free (compiler);
+}
+
+void pipeline_compiler_get_counters (pipeline_compiler_t *compiler,
+                                     perf_sample_t *counters)
+{
+    pthread_mutex_lock (&compiler->lock);
+    *counters = compiler->counters;
+    pthread_mutex_unlock (&compiler->lock);
+}
+
+pipeline_request_t *pipeline_compiler_request (pipeline_compiler_t *compiler,
+        pipeline_build_fn build,
+        const void *description)
+{
+    pipeline_request_t *request = NULL;
+    request = (pipeline_request_t *)calloc (1, sizeof (pipeline_request_t));
+    if (request == NULL) {
+        return NULL;
+    }
+    request->build = build;
+    request->description = description;
+    request->pipeline = VK_NULL_HANDLE;
+    request->result = VK_NOT_READY;
+    atomic_init (&request->state, REQUEST_PENDING);
+    pthread_mutex_lock (&compiler->lock);
+    request->next = compiler->requests;
+    compiler->requests = request;
+    if (compiler->last_job != NULL) {
+        compiler->last_job->next_job = request;
+    } else {
+        compiler->first_job = request;
+    }
+    compiler->last_job = request;
+    pthread_cond_signal (&compiler->has_jobs);
+    pthread_mutex_unlock (&compiler->lock);
+    return request;
+}
+
+VkPipeline pipeline_request_get (const pipeline_request_t *request,
+                                 VkPipeline fallback)
+{
+    if (request != NULL
+            && atomic_load_explicit (&request->state,
+                                     memory_order_acquire) == REQUEST_READY) {
+        return request->pipeline;
+    }
+    return fallback;
+}
+
+int pipeline_request_is_finished (const pipeline_request_t *request)
+{
+    return atomic_load_explicit (&request->state,
+                                 memory_order_acquire) != REQUEST_PENDING;
+}
+
+VkResult pipeline_request_result (const pipeline_request_t *request)
+{
+    if (!pipeline_request_is_finished (request)) {
+        return VK_NOT_READY;
+    }
+    return request->result;
+}
+
+/** Header every pipeline cache data starts with, see vkGetPipelineCacheData */
+typedef struct pipeline_cache_header_t {
+    uint32_t length;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+} pipeline_cache_header_t;
+
+/** Check that saved cache data was produced by the same device and driver */
+static int is_cache_compatible (const void *data, size_t size,
+                                const VkPhysicalDeviceProperties *properties)
+{
+    pipeline_cache_header_t header;
+    if (size < sizeof (header)) {
+        return 0;
+    }
+    memcpy (&header, data, sizeof (header));
+    return header.length >= sizeof (header)
+           && header.version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+           && header.vendorID == properties->vendorID
+           && header.deviceID == properties->deviceID
+           && memcmp (header.pipelineCacheUUID, properties->pipelineCacheUUID,
+                      VK_UUID_SIZE) == 0;
+}
+
+/** Read whole file into memory
+ * @returns allocated buffer that caller must free, NULL otherwise
+ */
+static void *read_file (const char *path, size_t *pSize)
+{
+    void *data = NULL;
+    long size = 0;
+    FILE *file = fopen (path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fseek (file, 0, SEEK_END) == 0 && (size = ftell (file)) > 0
+            && fseek (file, 0, SEEK_SET) == 0) {
+        data = malloc ((size_t)size);
+        if (data != NULL && fread (data, 1, (size_t)size, file) != (size_t)size) {
+            free (data);
+            data = NULL;
+        }
+    }
+    fclose (file);
+    *pSize = (size_t)size;
+    return data;
+}
+
+VkResult pipeline_cache_load (VkDevice device,
+                              const VkPhysicalDeviceProperties *properties,
+                              const char *path, VkPipelineCache *pCache)
+{
+    size_t size = 0;
+    void *data = path != NULL ? read_file (path, &size) : NULL;
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .initialDataSize = 0,
+        .pInitialData = NULL,
+    };
+    VkResult result = VK_SUCCESS;
+    if (data != NULL && is_cache_compatible (data, size, properties)) {
+        pipelineCacheCreateInfo.initialDataSize = size;
+        pipelineCacheCreateInfo.pInitialData = data;
+    }
+    result = vkCreatePipelineCache (device, &pipelineCacheCreateInfo, NULL,
+                                    pCache);
+    free (data);
+    return result;
+}
+
+/** Create directories of path that don't exist yet, like mkdir -p
+ * @param path path of file, its last component is not created
+ * @returns 0 on success, -1 otherwise
+ */
+static int make_parent_directories (const char *path)
+{
+    char *directory = strdup (path);
+    int result = 0;
+    if (directory == NULL) {
+        return -1;
+    }
+    for (char *slash = strchr (directory + 1, '/'); slash != NULL && result == 0;
+            slash = strchr (slash + 1, '/')) {
+        *slash = '\0';
+        if (mkdir (directory, 0700) != 0 && errno != EEXIST) {
+            result = -1;
+        }
+        *slash = '/';
+    }
+    free (directory);
+    return result;
+}
+
+int pipeline_cache_save (VkDevice device, VkPipelineCache cache,
+                         const char *path)
+{
+    size_t size = 0;
+    void *data = NULL;
+    FILE *file = NULL;
+    char *temporary = NULL;
+    size_t temporaryLength = 0;
+    int is_saved = 0;
+    if (path == NULL
+            || vkGetPipelineCacheData (device, cache, &size, NULL) != VK_SUCCESS
+            || size == 0 || make_parent_directories (path) != 0) {
+        return 0;
+    }
+    /* Readers see either old or new file, never a partial one */
+    temporaryLength = strlen (path) + 32;
+    temporary = (char *)malloc (temporaryLength);
+    data = (void *)malloc (size);
+    if (temporary != NULL && data != NULL
+            && vkGetPipelineCacheData (device, cache, &size, data) == VK_SUCCESS) {
+        snprintf (temporary, temporaryLength, "%s.%ld.tmp", path,
+                  (long)getpid ());
+        file = fopen (temporary, "wb");
+    }
+    if (file != NULL) {
+        is_saved = fwrite (data, 1, size, file) == size;
+        is_saved = (fclose (file) == 0) && is_saved;
+        is_saved = is_saved && rename (temporary, path) == 0;
+        if (!is_saved) {
+            unlink (temporary);
+        }
+    }
+    free (temporary);
+    free (data);
+    return is_saved;
+}
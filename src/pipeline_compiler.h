@@ -0,0 +1,108 @@
+/**
+ * @file pipeline_compiler.h
+ * Creation of graphics and compute pipelines on worker threads.
+ */
+#ifndef VKBOOTSTRAP_PIPELINE_COMPILER_H
+#define VKBOOTSTRAP_PIPELINE_COMPILER_H
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "perf_counters.h"
+
+/** Function that creates pipeline on worker thread
+ * @param device device to create pipeline on
+ * @param cache pipeline cache shared by all workers
+ * @param description user supplied description of the pipeline
+ * @param pipeline receives created pipeline
+ */
+typedef VkResult (*pipeline_build_fn) (VkDevice device, VkPipelineCache cache,
+                                       const void *description,
+                                       VkPipeline *pipeline);
+
+typedef struct pipeline_compiler_t pipeline_compiler_t;
+typedef struct pipeline_request_t pipeline_request_t;
+
+/** Create compiler and start its worker threads
+ * @param device device to create pipelines on
+ * @param cache pipeline cache shared by workers, can be VK_NULL_HANDLE
+ * @param thread_count number of workers, 0 to pick from number of CPUs
+ * @param count_events non-zero to count CPU events of workers, see
+ *        pipeline_compiler_get_counters()
+ * @param pCompiler receives new compiler object
+ */
+VkResult pipeline_compiler_create (VkDevice device, VkPipelineCache cache,
+                                   uint32_t thread_count, int count_events,
+                                   pipeline_compiler_t **pCompiler);
+
+/** Stop workers and destroy all pipelines created by compiler
+ *
+ * Requests not started yet are dropped. Pipelines must not be in use by GPU.
+ * @param compiler compiler to destroy, can be NULL
+ */
+void pipeline_compiler_destroy (pipeline_compiler_t *compiler);
+
+/** Get CPU counters of all workers spent on building pipelines
+ * @param compiler target compiler
+ * @param counters receives sum of counters, valid mask is 0 if counting was
+ *        not requested or counters are unavailable
+ */
+void pipeline_compiler_get_counters (pipeline_compiler_t *compiler,
+                                     perf_sample_t *counters);
+
+/** Queue creation of pipeline
+ *
+ * Never waits for pipeline creation, only for queue to accept the request.
+ * @param compiler target compiler
+ * @param build function called on worker thread to create the pipeline
+ * @param description passed to @a build, must stay valid until the request
+ *        is finished or compiler is destroyed
+ * @returns request handle, or NULL if out of memory
+ */
+pipeline_request_t *pipeline_compiler_request (pipeline_compiler_t *compiler,
+        pipeline_build_fn build,
+        const void *description);
+
+/** Get pipeline of request without waiting
+ * @param request request returned by pipeline_compiler_request(), can be NULL
+ * @param fallback pipeline to return while request is not finished, can be
+ *        VK_NULL_HANDLE to make caller skip the draw
+ * @returns created pipeline, or @a fallback if it is not ready or failed
+ */
+VkPipeline pipeline_request_get (const pipeline_request_t *request,
+                                 VkPipeline fallback);
+
+/** Check is request finished
+ * @returns non-zero if pipeline is created or creation has failed
+ */
+int pipeline_request_is_finished (const pipeline_request_t *request);
+
+/** Get result of finished request
+ * @returns VK_NOT_READY if request is not finished yet
+ */
+VkResult pipeline_request_result (const pipeline_request_t *request);
+
+/** Load pipeline cache data saved by earlier run
+ *
+ * Data saved for different device or driver is ignored.
+ * @param device device to create cache on
+ * @param properties properties of physical device of @a device
+ * @param path file to read cache data from
+ * @param pCache receives new pipeline cache
+ */
+VkResult pipeline_cache_load (VkDevice device,
+                              const VkPhysicalDeviceProperties *properties,
+                              const char *path, VkPipelineCache *pCache);
+
+/** Save pipeline cache data so next run can reuse it
+ *
+ * Data is written to temporary file renamed over @a path, so concurrent
+ * instances and crashes never leave truncated cache behind. Missing
+ * directories of @a path are created.
+ * @param device device that owns @a cache
+ * @param cache cache to save
+ * @param path file to write cache data to
+ * @returns non-zero if data was saved
+ */
+int pipeline_cache_save (VkDevice device, VkPipelineCache cache,
+                         const char *path);
+
+#endif
@@ -0,0 +1,261 @@
+/**
+ * @file present_latency.c
+ * Thread that waits for frames in submit order and times their completion.
+ */
+#define _POSIX_C_SOURCE 200809L
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "present_latency.h"
+#include "timer.h"
+#include "trace.h"
+
+/** Maximum number of frames waited for at once, must be power of two */
+#define MAX_PENDING 64
+/** Maximum number of samples kept until collected, must be power of two */
+#define MAX_SAMPLES 256
+/** Wait is split into slices, so thread notices released swapchain */
+#define WAIT_TIMEOUT_NS 10000000ull
+
+/** Frame that is submitted but not complete yet */
+typedef struct pending_frame_t {
+    uint64_t frame_number;
+    VkSwapchainKHR swapchain; /**< VK_NULL_HANDLE if fence is waited for */
+    uint64_t present_id;
+    VkFence fence;
+    uint64_t submit_ns;
+    uint32_t queue_depth;
+} pending_frame_t;
+
+struct present_latency_t {
+    VkDevice device;
+    PFN_vkVoidFunction waitForPresent; /**< NULL if fences are waited for */
+    pthread_t thread;
+    pthread_mutex_t lock; /**< Protects everything below */
+    pthread_cond_t changed; /**< Frame is added, completed or released */
+    int is_stopping;
+    /** Swapchain being destroyed, its frames are dropped */
+    VkSwapchainKHR released_swapchain;
+    pending_frame_t pending[MAX_PENDING];
+    uint64_t pending_head; /**< Number of frames ever completed or dropped */
+    uint32_t pending_count;
+    present_latency_sample_t samples[MAX_SAMPLES];
+    uint64_t sample_head; /**< Number of samples ever collected or dropped */
+    uint32_t sample_count;
+};
+
+static VkResult wait_for_frame (const present_latency_t *latency,
+                                const pending_frame_t *frame)
+{
+#ifdef VK_KHR_present_wait
+    if (frame->swapchain != VK_NULL_HANDLE) {
+        const PFN_vkWaitForPresentKHR waitForPresent =
+            (PFN_vkWaitForPresentKHR)latency->waitForPresent;
+        return waitForPresent (latency->device, frame->swapchain,
+                               frame->present_id, WAIT_TIMEOUT_NS);
+    }
+#endif
+    return vkWaitForFences (latency->device, 1, &frame->fence, VK_TRUE,
+                            WAIT_TIMEOUT_NS);
+}
+
+/** Remove oldest pending frame and keep its sample if it has completed */
+static void complete_frame (present_latency_t *latency, int has_completed,
+                            uint64_t complete_ns)
+{
+    const pending_frame_t *frame =
+        &latency->pending[latency->pending_head & (MAX_PENDING - 1)];
+    if (has_completed) {
+        present_latency_sample_t *sample = NULL;
+        if (latency->sample_count == MAX_SAMPLES) {
+            /* Nobody collects samples, so drop the oldest one */
+            latency->sample_head++;
+            latency->sample_count--;
+        }
+        sample = &latency->samples[(latency->sample_head + latency->sample_count)
+                                   & (MAX_SAMPLES - 1)];
+        sample->frame_number = frame->frame_number;
+        sample->latency_ms = timer_elapsed_ms (frame->submit_ns, complete_ns);
+        sample->queue_depth = frame->queue_depth;
+        latency->sample_count++;
+    }
+    latency->pending_head++;
+    latency->pending_count--;
+    pthread_cond_broadcast (&latency->changed);
+}
+
+static void *latency_main (void *arg)
+{
+    present_latency_t *latency = (present_latency_t *)arg;
+    TRACE_THREAD_NAME ("present latency");
+    pthread_mutex_lock (&latency->lock);
+    while (!latency->is_stopping) {
+        pending_frame_t frame;
+        VkResult result = VK_SUCCESS;
+        uint64_t complete_ns = 0;
+        if (latency->pending_count == 0) {
+            pthread_cond_wait (&latency->changed, &latency->lock);
+            continue;
+        }
+        frame = latency->pending[latency->pending_head & (MAX_PENDING - 1)];
+        if (frame.swapchain != VK_NULL_HANDLE
+                && frame.swapchain == latency->released_swapchain) {
+            complete_frame (latency, 0, 0);
+            continue;
+        }
+        pthread_mutex_unlock (&latency->lock);
+        result = wait_for_frame (latency, &frame);
+        complete_ns = timer_now_ns ();
+        pthread_mutex_lock (&latency->lock);
+        if (result != VK_TIMEOUT) {
+            /* Frame that failed, e.g. with VK_ERROR_OUT_OF_DATE_KHR, is
+             * dropped without sample */
+            complete_frame (latency, result == VK_SUCCESS, complete_ns);
+        }
+    }
+    pthread_mutex_unlock (&latency->lock);
+    return NULL;
+}
+
+VkResult present_latency_create (VkDevice device,
+                                 PFN_vkVoidFunction waitForPresent,
+                                 present_latency_t **pLatency)
+{
+    present_latency_t *latency =
+        (present_latency_t *)calloc (1, sizeof (present_latency_t));
+    *pLatency = NULL;
+    if (latency == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    latency->device = device;
+#ifdef VK_KHR_present_wait
+    latency->waitForPresent = waitForPresent;
+#else
+    (void)waitForPresent;
+#endif
+    pthread_mutex_init (&latency->lock, NULL);
+    pthread_cond_init (&latency->changed, NULL);
+    if (pthread_create (&latency->thread, NULL, latency_main, latency) != 0) {
+        pthread_cond_destroy (&latency->changed);
+        pthread_mutex_destroy (&latency->lock);
+        free (latency);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    *pLatency = latency;
+    return VK_SUCCESS;
+}
+
+void present_latency_destroy (present_latency_t *latency)
+{
+    if (latency == NULL) {
+        return;
+    }
+    pthread_mutex_lock (&latency->lock);
+    latency->is_stopping = 1;
+    pthread_cond_broadcast (&latency->changed);
+    pthread_mutex_unlock (&latency->lock);
+    pthread_join (latency->thread, NULL);
+    pthread_cond_destroy (&latency->changed);
+    pthread_mutex_destroy (&latency->lock);
+    free (latency);
+}
+
+int present_latency_uses_present_wait (const present_latency_t *latency)
+{
+    return latency != NULL && latency->waitForPresent != NULL;
+}
+
+void present_latency_add (present_latency_t *latency, uint64_t frame_number,
+                          VkSwapchainKHR swapchain, uint64_t present_id,
+                          VkFence fence, uint64_t submit_ns)
+{
+    pending_frame_t *frame = NULL;
+    if (latency == NULL) {
+        return;
+    }
+    pthread_mutex_lock (&latency->lock);
+    if (latency->pending_count < MAX_PENDING) {
+        frame = &latency->pending[(latency->pending_head + latency->pending_count)
+                                  & (MAX_PENDING - 1)];
+        frame->frame_number = frame_number;
+        frame->present_id = present_id;
+        frame->submit_ns = submit_ns;
+        frame->queue_depth = latency->pending_count;
+        if (latency->waitForPresent != NULL && swapchain != VK_NULL_HANDLE) {
+            frame->swapchain = swapchain;
+            frame->fence = VK_NULL_HANDLE;
+        } else {
+            frame->swapchain = VK_NULL_HANDLE;
+            frame->fence = fence;
+        }
+        latency->pending_count++;
+        pthread_cond_broadcast (&latency->changed);
+    }
+    pthread_mutex_unlock (&latency->lock);
+}
+
+/** Check if any pending frame waits for @a fence or presents to @a swapchain */
+static int has_pending (const present_latency_t *latency, VkFence fence,
+                        VkSwapchainKHR swapchain)
+{
+    for (uint32_t i = 0; i < latency->pending_count; i++) {
+        const pending_frame_t *frame =
+            &latency->pending[(latency->pending_head + i) & (MAX_PENDING - 1)];
+        if ((fence != VK_NULL_HANDLE && frame->fence == fence)
+                || (swapchain != VK_NULL_HANDLE && frame->swapchain == swapchain)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void present_latency_release_fence (present_latency_t *latency, VkFence fence)
+{
+    if (latency == NULL) {
+        return;
+    }
+    pthread_mutex_lock (&latency->lock);
+    while (!latency->is_stopping && has_pending (latency, fence, VK_NULL_HANDLE)) {
+        pthread_cond_wait (&latency->changed, &latency->lock);
+    }
+    pthread_mutex_unlock (&latency->lock);
+}
+
+void present_latency_release_swapchain (present_latency_t *latency,
+                                        VkSwapchainKHR swapchain)
+{
+    if (latency == NULL || swapchain == VK_NULL_HANDLE) {
+        return;
+    }
+    pthread_mutex_lock (&latency->lock);
+    latency->released_swapchain = swapchain;
+    pthread_cond_broadcast (&latency->changed);
+    while (!latency->is_stopping
+            && has_pending (latency, VK_NULL_HANDLE, swapchain)) {
+        pthread_cond_wait (&latency->changed, &latency->lock);
+    }
+    latency->released_swapchain = VK_NULL_HANDLE;
+    pthread_mutex_unlock (&latency->lock);
+}
+
+uint32_t present_latency_collect (present_latency_t *latency,
+                                  present_latency_sample_t *samples,
+                                  uint32_t max_count)
+{
+    uint32_t count = 0;
+    if (latency == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock (&latency->lock);
+    while (count < max_count && latency->sample_count > 0) {
+        samples[count++] = latency->samples[latency->sample_head
+                                            & (MAX_SAMPLES - 1)];
+        latency->sample_head++;
+        latency->sample_count--;
+    }
+    pthread_mutex_unlock (&latency->lock);
+    return count;
+}
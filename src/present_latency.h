@@ -0,0 +1,86 @@
+/**
+ * @file present_latency.h
+ * Time from submit of frame until it reaches display, measured on own thread.
+ *
+ * With VK_KHR_present_wait the thread waits for present ID of each frame,
+ * so latency ends when presentation engine shows the image. Without it the
+ * thread waits for fence of frame submit and latency ends when GPU has
+ * finished the frame, which is only the lower bound of real latency.
+ */
+#ifndef VKBOOTSTRAP_PRESENT_LATENCY_H
+#define VKBOOTSTRAP_PRESENT_LATENCY_H
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+/** Latency of one frame */
+typedef struct present_latency_sample_t {
+    uint64_t frame_number; /**< Number of frame the sample belongs to */
+    double latency_ms; /**< Time from submit to completion */
+    /** Frames submitted before this one that were not yet complete */
+    uint32_t queue_depth;
+} present_latency_sample_t;
+
+typedef struct present_latency_t present_latency_t;
+
+/** Create tracker and start its thread
+ * @param device device frames are submitted to
+ * @param waitForPresent vkWaitForPresentKHR of @a device with present wait
+ *        enabled, or NULL to wait for fences
+ * @param pLatency receives new tracker
+ */
+VkResult present_latency_create (VkDevice device,
+                                 PFN_vkVoidFunction waitForPresent,
+                                 present_latency_t **pLatency);
+
+/** Stop thread and free tracker
+ * @param latency tracker to free, can be NULL
+ */
+void present_latency_destroy (present_latency_t *latency);
+
+/** Check if tracker waits for present IDs
+ * @param latency tracker to check, can be NULL
+ * @returns non-zero if frames should be presented with present ID
+ */
+int present_latency_uses_present_wait (const present_latency_t *latency);
+
+/** Start tracking of submitted frame
+ * @param latency target tracker, can be NULL
+ * @param frame_number number of frame
+ * @param swapchain swapchain frame was presented to with @a present_id, or
+ *        VK_NULL_HANDLE if it wasn't presented
+ * @param present_id ID the frame was presented with
+ * @param fence fence signalled by submit of the frame
+ * @param submit_ns time the frame was submitted, see timer_now_ns()
+ */
+void present_latency_add (present_latency_t *latency, uint64_t frame_number,
+                          VkSwapchainKHR swapchain, uint64_t present_id,
+                          VkFence fence, uint64_t submit_ns);
+
+/** Wait until tracker has finished waiting for fence
+ *
+ * Must be called before the fence is reset.
+ * @param latency target tracker, can be NULL
+ * @param fence fence that is signalled or about to be
+ */
+void present_latency_release_fence (present_latency_t *latency, VkFence fence);
+
+/** Stop tracking frames presented to swapchain
+ *
+ * Must be called before the swapchain is destroyed.
+ * @param latency target tracker, can be NULL
+ * @param swapchain swapchain that is about to be destroyed
+ */
+void present_latency_release_swapchain (present_latency_t *latency,
+                                        VkSwapchainKHR swapchain);
+
+/** Take samples of frames completed since last call
+ * @param latency source tracker, can be NULL
+ * @param samples array that receives samples, oldest first
+ * @param max_count size of @a samples
+ * @returns number of samples written
+ */
+uint32_t present_latency_collect (present_latency_t *latency,
+                                  present_latency_sample_t *samples,
+                                  uint32_t max_count);
+
+#endif
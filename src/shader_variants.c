@@ -0,0 +1,220 @@
+/**
+ * @file shader_variants.c
+ * Open addressing hash table of specialized pipelines.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "shader_variants.h"
+
+#define INITIAL_CAPACITY 16
+
+/** Single specialized pipeline, passed to compiler as description */
+typedef struct shader_variant_t {
+    const shader_variants_t *variants;
+    uint64_t hash;
+    shader_variant_key_t key;
+    VkSpecializationMapEntry entries[SHADER_VARIANT_MAX_CONSTANTS];
+    VkSpecializationInfo specialization;
+    pipeline_request_t *request;
+} shader_variant_t;
+
+struct shader_variants_t {
+    pipeline_compiler_t *compiler;
+    shader_variant_build_fn build;
+    const void *base;
+    uint32_t capacity; /**< Number of slots, power of two */
+    uint32_t count; /**< Number of occupied slots */
+    shader_variant_t **slots;
+};
+
+/** FNV-1a hash of constants set in key */
+static uint64_t hash_key (const shader_variant_key_t *key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint32_t i = 0; i < key->count; i++) {
+        const uint32_t words[2] = {key->ids[i], key->values[i]};
+        const unsigned char *bytes = (const unsigned char *)words;
+        for (size_t j = 0; j < sizeof (words); j++) {
+            hash ^= bytes[j];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static int is_same_key (const shader_variant_key_t *a,
+                        const shader_variant_key_t *b)
+{
+    return a->count == b->count
+           && memcmp (a->ids, b->ids, a->count * sizeof (a->ids[0])) == 0
+           && memcmp (a->values, b->values,
+                      a->count * sizeof (a->values[0])) == 0;
+}
+
+/** Find slot that holds variant with key, or empty slot where it belongs */
+static uint32_t find_slot (shader_variant_t *const *slots, uint32_t capacity,
+                           uint64_t hash, const shader_variant_key_t *key)
+{
+    uint32_t slot = (uint32_t)hash & (capacity - 1);
+    while (slots[slot] != NULL
+            && (slots[slot]->hash != hash
+                || !is_same_key (&slots[slot]->key, key))) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return slot;
+}
+
+/** Double number of slots
+ * @returns 0 if out of memory
+ */
+static int grow (shader_variants_t *variants)
+{
+    const uint32_t capacity = variants->capacity * 2;
+    shader_variant_t **slots = (shader_variant_t **)calloc (capacity,
+                               sizeof (shader_variant_t *));
+    if (slots == NULL) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < variants->capacity; i++) {
+        const shader_variant_t *variant = variants->slots[i];
+        if (variant != NULL) {
+            slots[find_slot (slots, capacity, variant->hash,
+                             &variant->key)] = variants->slots[i];
+        }
+    }
+    free (variants->slots);
+    variants->slots = slots;
+    variants->capacity = capacity;
+    return 1;
+}
+
+/** Compiler callback that forwards to build function of variants */
+static VkResult build_variant (VkDevice device, VkPipelineCache cache,
+                               const void *description, VkPipeline *pipeline)
+{
+    const shader_variant_t *variant = (const shader_variant_t *)description;
+    return variant->variants->build (device, cache, variant->variants->base,
+                                     &variant->specialization, pipeline);
+}
+
+/** Create variant and queue its compilation
+ * @returns new variant, NULL if out of memory
+ */
+static shader_variant_t *create_variant (const shader_variants_t *variants,
+        uint64_t hash,
+        const shader_variant_key_t *key)
+{
+    shader_variant_t *variant = (shader_variant_t *)calloc (1,
+                                sizeof (shader_variant_t));
+    if (variant == NULL) {
+        return NULL;
+    }
+    variant->variants = variants;
+    variant->hash = hash;
+    variant->key = *key;
+    for (uint32_t i = 0; i < key->count; i++) {
+        variant->entries[i].constantID = key->ids[i];
+        variant->entries[i].offset = (uint32_t)(i * sizeof (uint32_t));
+        variant->entries[i].size = sizeof (uint32_t);
+    }
+    variant->specialization.mapEntryCount = key->count;
+    variant->specialization.pMapEntries = variant->entries;
+    variant->specialization.dataSize = key->count * sizeof (uint32_t);
+    variant->specialization.pData = variant->key.values;
+    variant->request = pipeline_compiler_request (variants->compiler,
+                       build_variant, variant);
+    if (variant->request == NULL) {
+        free (variant);
+        return NULL;
+    }
+    return variant;
+}
+
+shader_variants_t *shader_variants_create (pipeline_compiler_t *compiler,
+        shader_variant_build_fn build,
+        const void *base)
+{
+    shader_variants_t *variants = (shader_variants_t *)calloc (1,
+                                  sizeof (shader_variants_t));
+    if (variants == NULL) {
+        return NULL;
+    }
+    variants->compiler = compiler;
+    variants->build = build;
+    variants->base = base;
+    variants->capacity = INITIAL_CAPACITY;
+    variants->slots = (shader_variant_t **)calloc (INITIAL_CAPACITY,
+                      sizeof (shader_variant_t *));
+    if (variants->slots == NULL) {
+        free (variants);
+        return NULL;
+    }
+    return variants;
+}
+
+void shader_variants_destroy (shader_variants_t *variants)
+{
+    if (variants == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < variants->capacity; i++) {
+        free (variants->slots[i]);
+    }
+    free (variants->slots);
+    free (variants);
+}
+
+int shader_variant_key_set (shader_variant_key_t *key, uint32_t id,
+                            uint32_t value)
+{
+    uint32_t i = 0;
+    while (i < key->count && key->ids[i] < id) {
+        i++;
+    }
+    if (i < key->count && key->ids[i] == id) {
+        key->values[i] = value;
+        return 1;
+    }
+    if (key->count == SHADER_VARIANT_MAX_CONSTANTS) {
+        return 0;
+    }
+    memmove (&key->ids[i + 1], &key->ids[i],
+             (key->count - i) * sizeof (key->ids[0]));
+    memmove (&key->values[i + 1], &key->values[i],
+             (key->count - i) * sizeof (key->values[0]));
+    key->ids[i] = id;
+    key->values[i] = value;
+    key->count++;
+    return 1;
+}
+
+VkPipeline shader_variants_get (shader_variants_t *variants,
+                                const shader_variant_key_t *key,
+                                VkPipeline fallback)
+{
+    uint64_t hash = 0;
+    uint32_t slot = 0;
+    if (variants == NULL) {
+        return fallback;
+    }
+    hash = hash_key (key);
+    slot = find_slot (variants->slots, variants->capacity, hash, key);
+    if (variants->slots[slot] == NULL) {
+        /* Keep load factor below 3/4 so probing stays short */
+        if ((variants->count + 1) * 4 > variants->capacity * 3) {
+            if (!grow (variants)) {
+                return fallback;
+            }
+            slot = find_slot (variants->slots, variants->capacity, hash, key);
+        }
+        variants->slots[slot] = create_variant (variants, hash, key);
+        if (variants->slots[slot] == NULL) {
+            return fallback;
+        }
+        variants->count++;
+    }
+    return pipeline_request_get (variants->slots[slot]->request, fallback);
+}
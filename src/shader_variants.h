@@ -0,0 +1,75 @@
+/**
+ * @file shader_variants.h
+ * Pipelines specialized with specialization constants, cached by key.
+ */
+#ifndef VKBOOTSTRAP_SHADER_VARIANTS_H
+#define VKBOOTSTRAP_SHADER_VARIANTS_H
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "pipeline_compiler.h"
+
+/** Maximum number of specialization constants in one key */
+#define SHADER_VARIANT_MAX_CONSTANTS 8
+
+/** Values of specialization constants that identify one variant
+ *
+ * Constants are kept sorted by id, so the same set of values always gives
+ * the same key regardless of order they were set in.
+ */
+typedef struct shader_variant_key_t {
+    uint32_t count; /**< Number of constants set */
+    uint32_t ids[SHADER_VARIANT_MAX_CONSTANTS]; /**< constant_id of each */
+    uint32_t values[SHADER_VARIANT_MAX_CONSTANTS]; /**< 32-bit value of each */
+} shader_variant_key_t;
+
+/** Function that creates specialized pipeline on worker thread
+ * @param device device to create pipeline on
+ * @param cache pipeline cache shared by workers
+ * @param base description shared by all variants
+ * @param specialization constants of this variant for every shader stage
+ * @param pipeline receives created pipeline
+ */
+typedef VkResult (*shader_variant_build_fn) (VkDevice device,
+        VkPipelineCache cache, const void *base,
+        const VkSpecializationInfo *specialization, VkPipeline *pipeline);
+
+typedef struct shader_variants_t shader_variants_t;
+
+/** Create empty set of variants of one pipeline
+ * @param compiler compiler to create variants with
+ * @param build function that creates pipeline of a variant
+ * @param base passed to @a build, must outlive the variants
+ * @returns new variants object, NULL if out of memory
+ */
+shader_variants_t *shader_variants_create (pipeline_compiler_t *compiler,
+        shader_variant_build_fn build,
+        const void *base);
+
+/** Free variants
+ *
+ * Pipelines are owned by compiler, so compiler must be destroyed first to
+ * make sure no worker is still building a variant.
+ * @param variants variants to free, can be NULL
+ */
+void shader_variants_destroy (shader_variants_t *variants);
+
+/** Set value of specialization constant in key
+ * @param key key to modify
+ * @param id constant_id of specialization constant
+ * @param value new value, booleans are 0 or 1
+ * @returns 0 if key is full, non-zero otherwise
+ */
+int shader_variant_key_set (shader_variant_key_t *key, uint32_t id,
+                            uint32_t value);
+
+/** Get pipeline of variant, queueing its creation on first use
+ * @param variants target variants, can be NULL
+ * @param key values of specialization constants
+ * @param fallback pipeline to return while variant is compiling
+ * @returns pipeline of variant, or @a fallback if it is not ready
+ */
+VkPipeline shader_variants_get (shader_variants_t *variants,
+                                const shader_variant_key_t *key,
+                                VkPipeline fallback);
+
+#endif
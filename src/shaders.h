@@ -0,0 +1,21 @@
+/**
+ * @file shaders.h
+ * SPIR-V of shaders from shaders/ directory embedded at build time.
+ *
+ * Only available when HAVE_SHADERS is defined, i.e. when GLSL compiler was
+ * found by the build system.
+ */
+#ifndef VKBOOTSTRAP_SHADERS_H
+#define VKBOOTSTRAP_SHADERS_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* Each shader is embedded as array of SPIR-V words and its size in bytes */
+extern const uint32_t triangle_vert_spv[];
+extern const size_t triangle_vert_spv_size;
+extern const uint32_t triangle_frag_spv[];
+extern const size_t triangle_frag_spv_size;
+extern const uint32_t empty_comp_spv[];
+extern const size_t empty_comp_spv_size;
+
+#endif
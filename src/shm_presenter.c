@@ -0,0 +1,240 @@
+/**
+ * @file shm_presenter.c
+ * Double buffered MIT-SHM images copied to window with xcb_shm_put_image().
+ *
+ * Copy is done by server when it processes the request, so reply to a
+ * GetInputFocus request sent right after it tells that the image is free.
+ */
+#define _XOPEN_SOURCE 700
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+#include "shm_presenter.h"
+#include "trace.h"
+
+/** Image in shared memory segment */
+typedef struct shm_image_t {
+    xcb_shm_seg_t segment;
+    int shmid; /**< -1 if image is not allocated */
+    uint32_t *pixels;
+    /** Reply arrives once server has copied the image */
+    xcb_get_input_focus_cookie_t copied;
+    int is_busy; /**< true if @a copied has not been waited for yet */
+} shm_image_t;
+
+struct shm_presenter_t {
+    xcb_connection_t *connection;
+    xcb_window_t window;
+    xcb_gcontext_t gc;
+    uint8_t depth; /**< Depth of window */
+    uint16_t width;
+    uint16_t height;
+    uint32_t current; /**< Image returned by last acquire */
+    shm_image_t images[SHM_PRESENTER_IMAGE_COUNT];
+};
+
+/** Replies waited for by all presenters */
+static uint32_t round_trip_count;
+
+/** Find visual of window among visuals of screens */
+static const xcb_visualtype_t *find_visual (xcb_connection_t *connection,
+        xcb_visualid_t visual_id)
+{
+    xcb_screen_iterator_t screens = xcb_setup_roots_iterator (
+                                        xcb_get_setup (connection));
+    for (; screens.rem; xcb_screen_next (&screens)) {
+        xcb_depth_iterator_t depths = xcb_screen_allowed_depths_iterator (
+                                          screens.data);
+        for (; depths.rem; xcb_depth_next (&depths)) {
+            xcb_visualtype_iterator_t visuals = xcb_depth_visuals_iterator (
+                                                    depths.data);
+            for (; visuals.rem; xcb_visualtype_next (&visuals)) {
+                if (visuals.data->visual_id == visual_id) {
+                    return visuals.data;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/** Check if images of depth are stored as 32 bit 0xAARRGGBB pixels
+ *
+ * Depth 32 keeps alpha in the top byte, depth 24 ignores it.
+ */
+static int is_supported_format (xcb_connection_t *connection, uint8_t depth,
+                                const xcb_visualtype_t *visual)
+{
+    xcb_format_iterator_t formats = xcb_setup_pixmap_formats_iterator (
+                                        xcb_get_setup (connection));
+    if (visual == NULL || visual->red_mask != 0xff0000
+            || visual->green_mask != 0xff00 || visual->blue_mask != 0xff) {
+        return 0;
+    }
+    for (; formats.rem; xcb_format_next (&formats)) {
+        if (formats.data->depth == depth) {
+            return formats.data->bits_per_pixel == 32;
+        }
+    }
+    return 0;
+}
+
+/** Wait until server has finished copying image */
+static void wait_image (shm_presenter_t *presenter, shm_image_t *image)
+{
+    if (image->is_busy) {
+        round_trip_count++;
+        free (xcb_get_input_focus_reply (presenter->connection, image->copied,
+                                         NULL));
+        image->is_busy = 0;
+    }
+}
+
+static void destroy_image (shm_presenter_t *presenter, shm_image_t *image)
+{
+    wait_image (presenter, image);
+    if (image->shmid != -1) {
+        xcb_shm_detach (presenter->connection, image->segment);
+        shmdt (image->pixels);
+        image->shmid = -1;
+        image->pixels = NULL;
+    }
+}
+
+/** Allocate segment and attach it to server
+ * @returns 0 on success, -1 otherwise
+ */
+static int create_image (shm_presenter_t *presenter, shm_image_t *image,
+                         size_t size)
+{
+    xcb_generic_error_t *error = NULL;
+    void *address = NULL;
+    const int shmid = shmget (IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (shmid == -1) {
+        return -1;
+    }
+    address = shmat (shmid, NULL, 0);
+    if (address == (void *) -1) {
+        shmctl (shmid, IPC_RMID, NULL);
+        return -1;
+    }
+    image->segment = xcb_generate_id (presenter->connection);
+    round_trip_count++;
+    error = xcb_request_check (presenter->connection,
+                               xcb_shm_attach_checked (presenter->connection,
+                                       image->segment, (uint32_t)shmid, 0));
+    /* Segment stays alive until both sides detach, even if it is removed */
+    shmctl (shmid, IPC_RMID, NULL);
+    if (error != NULL) {
+        free (error);
+        shmdt (address);
+        return -1;
+    }
+    image->shmid = shmid;
+    image->pixels = (uint32_t *)address;
+    return 0;
+}
+
+shm_presenter_t *shm_presenter_create (xcb_connection_t *connection,
+                                       xcb_window_t window)
+{
+    shm_presenter_t *presenter = NULL;
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data (
+                connection, &xcb_shm_id);
+    xcb_get_geometry_cookie_t geometry_cookie;
+    xcb_get_window_attributes_cookie_t attributes_cookie;
+    xcb_get_geometry_reply_t *geometry = NULL;
+    xcb_get_window_attributes_reply_t *attributes = NULL;
+    if (extension == NULL || !extension->present) {
+        return NULL;
+    }
+    geometry_cookie = xcb_get_geometry (connection, window);
+    attributes_cookie = xcb_get_window_attributes (connection, window);
+    /* Both replies arrive after a single round trip */
+    round_trip_count++;
+    geometry = xcb_get_geometry_reply (connection, geometry_cookie, NULL);
+    attributes = xcb_get_window_attributes_reply (connection,
+                 attributes_cookie, NULL);
+    if (geometry != NULL && attributes != NULL
+            && is_supported_format (connection, geometry->depth,
+                                    find_visual (connection,
+                                            attributes->visual))) {
+        presenter = (shm_presenter_t *)calloc (1, sizeof (shm_presenter_t));
+    }
+    if (presenter != NULL) {
+        presenter->connection = connection;
+        presenter->window = window;
+        presenter->depth = geometry->depth;
+        for (uint32_t i = 0; i < SHM_PRESENTER_IMAGE_COUNT; i++) {
+            presenter->images[i].shmid = -1;
+        }
+        presenter->gc = xcb_generate_id (connection);
+        xcb_create_gc (connection, presenter->gc, window, 0, NULL);
+    }
+    free (attributes);
+    free (geometry);
+    return presenter;
+}
+
+void shm_presenter_destroy (shm_presenter_t *presenter)
+{
+    if (presenter == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < SHM_PRESENTER_IMAGE_COUNT; i++) {
+        destroy_image (presenter, &presenter->images[i]);
+    }
+    xcb_free_gc (presenter->connection, presenter->gc);
+    xcb_flush (presenter->connection);
+    free (presenter);
+}
+
+int shm_presenter_resize (shm_presenter_t *presenter, uint16_t width,
+                          uint16_t height)
+{
+    const size_t size = (size_t)width * height * sizeof (uint32_t);
+    for (uint32_t i = 0; i < SHM_PRESENTER_IMAGE_COUNT; i++) {
+        destroy_image (presenter, &presenter->images[i]);
+    }
+    presenter->width = width;
+    presenter->height = height;
+    for (uint32_t i = 0; i < SHM_PRESENTER_IMAGE_COUNT; i++) {
+        if (create_image (presenter, &presenter->images[i], size) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+uint32_t *shm_presenter_acquire (shm_presenter_t *presenter)
+{
+    shm_image_t *image = NULL;
+    presenter->current = (presenter->current + 1) % SHM_PRESENTER_IMAGE_COUNT;
+    image = &presenter->images[presenter->current];
+    TRACE_BEGIN ("wait image");
+    wait_image (presenter, image);
+    TRACE_END ();
+    return image->pixels;
+}
+
+uint32_t shm_presenter_get_round_trips (void)
+{
+    return round_trip_count;
+}
+
+int shm_presenter_present (shm_presenter_t *presenter)
+{
+    shm_image_t *image = &presenter->images[presenter->current];
+    xcb_shm_put_image (presenter->connection, presenter->window,
+                       presenter->gc, presenter->width, presenter->height,
+                       0, 0, presenter->width, presenter->height, 0, 0,
+                       presenter->depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 0,
+                       image->segment, 0);
+    image->copied = xcb_get_input_focus (presenter->connection);
+    image->is_busy = 1;
+    return xcb_flush (presenter->connection) > 0 ? 0 : -1;
+}
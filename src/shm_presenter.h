@@ -0,0 +1,62 @@
+/**
+ * @file shm_presenter.h
+ * Presentation of CPU rendered images to X window through MIT-SHM.
+ *
+ * Images live in shared memory segments attached to the X server, so
+ * xcb_shm_put_image() copies pixels without sending them through the socket.
+ * Two images are used, one is drawn while the server copies the other.
+ */
+#ifndef VKBOOTSTRAP_SHM_PRESENTER_H
+#define VKBOOTSTRAP_SHM_PRESENTER_H
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+/** Number of images presented in turn */
+#define SHM_PRESENTER_IMAGE_COUNT 2
+
+typedef struct shm_presenter_t shm_presenter_t;
+
+/** Create presenter for window
+ * @param connection connection the window belongs to
+ * @param window window to present to, its depth must use 32 bits per pixel
+ * @returns new presenter without images, or NULL if server has no MIT-SHM or
+ *          the window can't be presented to
+ */
+shm_presenter_t *shm_presenter_create (xcb_connection_t *connection,
+                                       xcb_window_t window);
+
+/** Wait for server to finish with images and free presenter
+ * @param presenter presenter to free, can be NULL
+ */
+void shm_presenter_destroy (shm_presenter_t *presenter);
+
+/** Recreate images with new size
+ * @param presenter target presenter
+ * @param width width of images
+ * @param height height of images
+ * @returns 0 on success, -1 if shared memory can't be allocated or attached
+ */
+int shm_presenter_resize (shm_presenter_t *presenter, uint16_t width,
+                          uint16_t height);
+
+/** Get next image to draw, waits until server has finished copying it
+ * @param presenter target presenter, must have images
+ * @returns pixels in 0xAARRGGBB format, rows are as wide as the image,
+ *          alpha matters only in windows with 32-bit visual
+ */
+uint32_t *shm_presenter_acquire (shm_presenter_t *presenter);
+
+/** Copy image returned by last shm_presenter_acquire() to window
+ * @param presenter target presenter
+ * @returns 0 on success, -1 if connection has failed
+ */
+int shm_presenter_present (shm_presenter_t *presenter);
+
+/** Get number of round trips to X server made by all presenters so far
+ *
+ * Creating presenter, attaching images and waiting for the server to
+ * finish copying an image each wait for a reply.
+ */
+uint32_t shm_presenter_get_round_trips (void);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file simulation.c
+ * Scene that depends only on seed and sequence of time steps.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <math.h>
+#include "simulation.h"
+
+/** Number of ticks between changes of rotation speed */
+#define TICKS_PER_SPEED_CHANGE 60
+/** Rotation caused by one unit of raw pointer motion */
+#define RADIANS_PER_MOTION 0.005
+#define TWO_PI (2.0 * 3.14159265358979323846)
+
+static uint64_t next_random (simulation_t *simulation)
+{
+    uint64_t x = simulation->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    simulation->rng = x;
+    return x;
+}
+
+void simulation_init (simulation_t *simulation, uint64_t seed)
+{
+    simulation->rng = seed != 0 ? seed : SIMULATION_DEFAULT_SEED;
+    simulation->tick = 0;
+    simulation->angle = 0.0f;
+    simulation->speed = 1.0f;
+}
+
+void simulation_tick (simulation_t *simulation, double dt)
+{
+    if (simulation->tick % TICKS_PER_SPEED_CHANGE == 0) {
+        /* Speed in range [0.5, 2.0) radians per second */
+        const uint64_t bits = next_random (simulation) >> 11;
+        const double r = (double)bits / 9007199254740992.0; /* 2^53 */
+        simulation->speed = (float)(0.5 + 1.5 * r);
+    }
+    simulation->angle = (float)fmod ((double)simulation->angle
+                                     + (double)simulation->speed * dt,
+                                     TWO_PI);
+    simulation->tick++;
+}
+
+void simulation_apply_input (simulation_t *simulation,
+                             const input_event_t *event)
+{
+    if (event->type == INPUT_EVENT_RAW_MOTION) {
+        simulation->angle = (float)fmod ((double)simulation->angle
+                                         + RADIANS_PER_MOTION * event->x,
+                                         TWO_PI);
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * @file simulation.h
+ * Deterministic state of the animated scene.
+ */
+#ifndef VKBOOTSTRAP_SIMULATION_H
+#define VKBOOTSTRAP_SIMULATION_H
+#include <stdint.h>
+#include "input_queue.h"
+
+/** Seed used when workload must be the same on every run */
+#define SIMULATION_DEFAULT_SEED 0x5eed5eed5eed5eedULL
+
+/** Scene state advanced once per frame */
+typedef struct simulation_t {
+    uint64_t rng; /**< State of xorshift64 generator */
+    uint64_t tick; /**< Number of ticks simulated */
+    float angle; /**< Rotation of triangle in radians */
+    float speed; /**< Rotation speed in radians per second */
+} simulation_t;
+
+/** Reset scene to initial state
+ * @param simulation scene to reset
+ * @param seed seed of random generator, must not be 0
+ */
+void simulation_init (simulation_t *simulation, uint64_t seed);
+
+/** Advance scene
+ * @param simulation scene to advance
+ * @param dt time step in seconds
+ */
+void simulation_tick (simulation_t *simulation, double dt);
+
+/** Change scene by user input, raw pointer motion turns the triangle
+ * @param simulation scene to change
+ * @param event event taken from input queue
+ */
+void simulation_apply_input (simulation_t *simulation,
+                             const input_event_t *event);
+
+#endif
@@ -0,0 +1,469 @@
+/**
+ * @file software_renderer.c
+ * Band parallel scanline rasterizer with SIMD span kernels.
+ *
+ * Output matches the Vulkan renderer: the frame is cleared with the color of
+ * record_frame() and the triangle of triangle.vert is drawn with vertex colors
+ * interpolated across it. Swapchain images are sRGB, so linear colors are
+ * encoded too, with sRGB curve sampled into a table the kernels look up.
+ */
+#define _POSIX_C_SOURCE 200809L
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "software_renderer.h"
+#include "trace.h"
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+/* AVX2 kernels are compiled with target attribute and picked at runtime */
+#define HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#endif
+
+/** Fill @a count pixels with one color */
+typedef void (*fill_span_fn) (uint32_t *pixels, uint32_t count,
+                              uint32_t color);
+/** Write @a count pixels blended from vertex colors
+ * @param color linear color of the first pixel
+ * @param step change of linear color from pixel to the next one
+ */
+typedef void (*blend_span_fn) (uint32_t *pixels, uint32_t count,
+                               const float color[3], const float step[3]);
+
+/** Triangle of triangle.vert before rotation, in normalized coordinates */
+static const float triangle_positions[3][2] = {
+    {0.0f, -0.6f}, {0.6f, 0.5f}, {-0.6f, 0.5f},
+};
+/** Linear vertex colors of triangle.vert */
+static const float triangle_colors[3][3] = {
+    {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f},
+};
+
+/** Parameters of frame being drawn, shared by all threads */
+typedef struct software_frame_t {
+    uint32_t *pixels;
+    uint32_t stride;
+    uint32_t width;
+    uint32_t height;
+    uint32_t clear_color;
+    float positions[3][2]; /**< Vertices in pixels */
+    float area; /**< Twice signed area of triangle in pixels */
+    int has_triangle; /**< false if triangle is degenerate */
+} software_frame_t;
+
+typedef struct software_worker_t {
+    software_renderer_t *renderer;
+    pthread_t thread;
+    uint32_t band; /**< Band of rows drawn by this worker */
+} software_worker_t;
+
+struct software_renderer_t {
+    fill_span_fn fill_span;
+    blend_span_fn blend_span;
+    const char *isa;
+    uint32_t band_count; /**< Workers and the drawing thread */
+    uint32_t worker_count;
+    software_worker_t workers[SOFTWARE_RENDERER_MAX_THREADS - 1];
+    pthread_mutex_t lock; /**< Protects everything below */
+    pthread_cond_t frame_started;
+    pthread_cond_t band_finished;
+    uint64_t frame_id; /**< Incremented when workers have to draw a frame */
+    uint32_t busy_count; /**< Workers still drawing current frame */
+    int is_stopping;
+    /** Written only while no worker is busy */
+    software_frame_t frame;
+};
+
+/** Alpha of every pixel, windows with 32-bit visual show frames opaque */
+#define OPAQUE_ALPHA 0xff000000u
+
+/** Entries of sRGB table, 12 bits keep dark colors within one step */
+#define SRGB_TABLE_SIZE 4096
+
+/** 8-bit sRGB encoding of linear values 0 to 1 in SRGB_TABLE_SIZE steps,
+ * 32-bit entries so that AVX2 can gather them */
+static uint32_t srgb_table[SRGB_TABLE_SIZE];
+static pthread_once_t srgb_table_once = PTHREAD_ONCE_INIT;
+
+/** Fill srgb_table with the piecewise curve triangle.frag uses */
+static void init_srgb_table (void)
+{
+    for (uint32_t i = 0; i < SRGB_TABLE_SIZE; i++) {
+        const float linear = (float)i / (SRGB_TABLE_SIZE - 1);
+        const float encoded = linear < 0.0031308f ? linear * 12.92f
+                              : 1.055f * powf (linear, 1.0f / 2.4f) - 0.055f;
+        srgb_table[i] = (uint32_t)(encoded * 255.0f + 0.5f);
+    }
+}
+
+/** Encode linear color channel to 8 bits */
+static uint32_t encode_channel (float linear)
+{
+    if (linear <= 0.0f) {
+        return 0;
+    }
+    if (linear >= 1.0f) {
+        return 255;
+    }
+    return srgb_table[(uint32_t)(linear * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+}
+
+static void fill_span_scalar (uint32_t *pixels, uint32_t count, uint32_t color)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        pixels[i] = color;
+    }
+}
+
+/** Blend pixels from @a begin to @a end of span starting at @a pixels */
+static void blend_pixels (uint32_t *pixels, uint32_t begin, uint32_t end,
+                          const float color[3], const float step[3])
+{
+    for (uint32_t i = begin; i < end; i++) {
+        const float x = (float)i;
+        pixels[i] = OPAQUE_ALPHA
+                    | encode_channel (color[0] + x * step[0]) << 16
+                    | encode_channel (color[1] + x * step[1]) << 8
+                    | encode_channel (color[2] + x * step[2]);
+    }
+}
+
+static void blend_span_scalar (uint32_t *pixels, uint32_t count,
+                               const float color[3], const float step[3])
+{
+    blend_pixels (pixels, 0, count, color, step);
+}
+
+#if defined (__SSE2__)
+/** Encode 4 linear channels to 8 bits like encode_channel()
+ *
+ * SSE2 has no gather, table is read one lane at a time.
+ */
+static __m128i encode_sse2 (__m128 linear)
+{
+    const __m128 clamped = _mm_min_ps (_mm_max_ps (linear, _mm_setzero_ps ()),
+                                       _mm_set1_ps (1.0f));
+    union {
+        __m128i vector;
+        uint32_t lanes[4];
+    } index;
+    index.vector = _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (clamped,
+                                     _mm_set1_ps (SRGB_TABLE_SIZE - 1)),
+                                     _mm_set1_ps (0.5f)));
+    return _mm_set_epi32 ((int)srgb_table[index.lanes[3]],
+                          (int)srgb_table[index.lanes[2]],
+                          (int)srgb_table[index.lanes[1]],
+                          (int)srgb_table[index.lanes[0]]);
+}
+
+static void fill_span_sse2 (uint32_t *pixels, uint32_t count, uint32_t color)
+{
+    const __m128i value = _mm_set1_epi32 ((int)color);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128 ((__m128i *)(void *)(pixels + i), value);
+    }
+    fill_span_scalar (pixels + i, count - i, color);
+}
+
+static void blend_span_sse2 (uint32_t *pixels, uint32_t count,
+                             const float color[3], const float step[3])
+{
+    const __m128 lanes = _mm_set_ps (3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128i alpha = _mm_set1_epi32 ((int)OPAQUE_ALPHA);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_add_ps (_mm_set1_ps ((float)i), lanes);
+        const __m128i r = encode_sse2 (_mm_add_ps (_mm_set1_ps (color[0]),
+                                       _mm_mul_ps (x, _mm_set1_ps (step[0]))));
+        const __m128i g = encode_sse2 (_mm_add_ps (_mm_set1_ps (color[1]),
+                                       _mm_mul_ps (x, _mm_set1_ps (step[1]))));
+        const __m128i b = encode_sse2 (_mm_add_ps (_mm_set1_ps (color[2]),
+                                       _mm_mul_ps (x, _mm_set1_ps (step[2]))));
+        _mm_storeu_si128 ((__m128i *)(void *)(pixels + i),
+                          _mm_or_si128 (_mm_or_si128 (_mm_slli_epi32 (r, 16),
+                                        _mm_slli_epi32 (g, 8)),
+                                        _mm_or_si128 (b, alpha)));
+    }
+    blend_pixels (pixels, i, count, color, step);
+}
+#endif
+
+#ifdef HAVE_AVX2_KERNELS
+/** Encode 8 linear channels to 8 bits like encode_channel() */
+__attribute__ ((target ("avx2")))
+static __m256i encode_avx2 (__m256 linear)
+{
+    const __m256 clamped = _mm256_min_ps (_mm256_max_ps (linear,
+                                          _mm256_setzero_ps ()),
+                                          _mm256_set1_ps (1.0f));
+    const __m256i index = _mm256_cvttps_epi32 (_mm256_add_ps (_mm256_mul_ps (
+                              clamped, _mm256_set1_ps (SRGB_TABLE_SIZE - 1)),
+                              _mm256_set1_ps (0.5f)));
+    return _mm256_i32gather_epi32 ((const int *)(const void *)srgb_table,
+                                   index, 4);
+}
+
+__attribute__ ((target ("avx2")))
+static void fill_span_avx2 (uint32_t *pixels, uint32_t count, uint32_t color)
+{
+    const __m256i value = _mm256_set1_epi32 ((int)color);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256 ((__m256i *)(void *)(pixels + i), value);
+    }
+    fill_span_scalar (pixels + i, count - i, color);
+}
+
+__attribute__ ((target ("avx2")))
+static void blend_span_avx2 (uint32_t *pixels, uint32_t count,
+                             const float color[3], const float step[3])
+{
+    const __m256 lanes = _mm256_set_ps (7.0f, 6.0f, 5.0f, 4.0f,
+                                        3.0f, 2.0f, 1.0f, 0.0f);
+    const __m256i alpha = _mm256_set1_epi32 ((int)OPAQUE_ALPHA);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_add_ps (_mm256_set1_ps ((float)i), lanes);
+        const __m256i r = encode_avx2 (_mm256_add_ps (_mm256_set1_ps (color[0]),
+                                       _mm256_mul_ps (x, _mm256_set1_ps (step[0]))));
+        const __m256i g = encode_avx2 (_mm256_add_ps (_mm256_set1_ps (color[1]),
+                                       _mm256_mul_ps (x, _mm256_set1_ps (step[1]))));
+        const __m256i b = encode_avx2 (_mm256_add_ps (_mm256_set1_ps (color[2]),
+                                       _mm256_mul_ps (x, _mm256_set1_ps (step[2]))));
+        _mm256_storeu_si256 ((__m256i *)(void *)(pixels + i),
+                             _mm256_or_si256 (_mm256_or_si256 (
+                                     _mm256_slli_epi32 (r, 16),
+                                     _mm256_slli_epi32 (g, 8)),
+                                 _mm256_or_si256 (b, alpha)));
+    }
+    blend_pixels (pixels, i, count, color, step);
+}
+#endif
+
+/** Pick the widest span kernels supported by CPU */
+static void select_kernels (software_renderer_t *renderer)
+{
+    renderer->fill_span = fill_span_scalar;
+    renderer->blend_span = blend_span_scalar;
+    renderer->isa = "scalar";
+#if defined (__SSE2__)
+    renderer->fill_span = fill_span_sse2;
+    renderer->blend_span = blend_span_sse2;
+    renderer->isa = "sse2";
+#endif
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2")) {
+        renderer->fill_span = fill_span_avx2;
+        renderer->blend_span = blend_span_avx2;
+        renderer->isa = "avx2";
+    }
+#endif
+}
+
+/** Draw one row, coloring pixels whose centers are inside the triangle */
+static void draw_row (const software_renderer_t *renderer,
+                      const software_frame_t *frame, uint32_t y)
+{
+    uint32_t *row = frame->pixels + (size_t)y * frame->stride;
+    const float center_y = (float)y + 0.5f;
+    float weight_step[3], weight_offset[3];
+    float left = 0.0f;
+    float right = (float)frame->width;
+    float color[3], step[3];
+    uint32_t begin = 0, end = 0;
+    if (!frame->has_triangle) {
+        renderer->fill_span (row, frame->width, frame->clear_color);
+        return;
+    }
+    /* Barycentric weight of vertex i is linear in x along the row */
+    for (uint32_t i = 0; i < 3; i++) {
+        const float *a = frame->positions[(i + 1) % 3];
+        const float *b = frame->positions[(i + 2) % 3];
+        weight_step[i] = (a[1] - b[1]) / frame->area;
+        weight_offset[i] = ((b[0] - a[0]) * (center_y - a[1])
+                            + (b[1] - a[1]) * a[0]) / frame->area;
+        if (weight_step[i] > 0.0f) {
+            left = fmaxf (left, -weight_offset[i] / weight_step[i]);
+        } else if (weight_step[i] < 0.0f) {
+            right = fminf (right, -weight_offset[i] / weight_step[i]);
+        } else if (weight_offset[i] < 0.0f) {
+            right = left;
+        }
+    }
+    if (right > left) {
+        /* Pixel x is covered if its center x + 0.5 is in [left, right] */
+        const float first = fmaxf (ceilf (left - 0.5f), 0.0f);
+        const float limit = fminf (floorf (right - 0.5f) + 1.0f,
+                                  (float)frame->width);
+        begin = (uint32_t)first;
+        end = (uint32_t)limit;
+    }
+    if (begin >= end) {
+        renderer->fill_span (row, frame->width, frame->clear_color);
+        return;
+    }
+    for (uint32_t c = 0; c < 3; c++) {
+        const float x = (float)begin + 0.5f;
+        color[c] = 0.0f;
+        step[c] = 0.0f;
+        for (uint32_t i = 0; i < 3; i++) {
+            color[c] += (weight_step[i] * x + weight_offset[i])
+                        * triangle_colors[i][c];
+            step[c] += weight_step[i] * triangle_colors[i][c];
+        }
+    }
+    renderer->fill_span (row, begin, frame->clear_color);
+    renderer->blend_span (row + begin, end - begin, color, step);
+    renderer->fill_span (row + end, frame->width - end, frame->clear_color);
+}
+
+/** Draw rows of band, bands split the frame into equal parts */
+static void draw_band (const software_renderer_t *renderer, uint32_t band)
+{
+    const software_frame_t *frame = &renderer->frame;
+    const uint32_t begin = (uint32_t)((uint64_t)frame->height * band
+                                      / renderer->band_count);
+    const uint32_t end = (uint32_t)((uint64_t)frame->height * (band + 1)
+                                    / renderer->band_count);
+    TRACE_BEGIN ("rasterize");
+    for (uint32_t y = begin; y < end; y++) {
+        draw_row (renderer, frame, y);
+    }
+    TRACE_END ();
+}
+
+static void *worker_main (void *arg)
+{
+    software_worker_t *worker = (software_worker_t *)arg;
+    software_renderer_t *renderer = worker->renderer;
+    uint64_t frame_id = 0;
+    TRACE_THREAD_NAME ("software renderer");
+    pthread_mutex_lock (&renderer->lock);
+    for (;;) {
+        while (!renderer->is_stopping && renderer->frame_id == frame_id) {
+            pthread_cond_wait (&renderer->frame_started, &renderer->lock);
+        }
+        if (renderer->is_stopping) {
+            break;
+        }
+        frame_id = renderer->frame_id;
+        pthread_mutex_unlock (&renderer->lock);
+        draw_band (renderer, worker->band);
+        pthread_mutex_lock (&renderer->lock);
+        if (--renderer->busy_count == 0) {
+            pthread_cond_signal (&renderer->band_finished);
+        }
+    }
+    pthread_mutex_unlock (&renderer->lock);
+    return NULL;
+}
+
+software_renderer_t *software_renderer_create (uint32_t thread_count)
+{
+    software_renderer_t *renderer = NULL;
+    if (thread_count == 0) {
+        long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 1 ? (uint32_t)cpus : 1;
+    }
+    if (thread_count > SOFTWARE_RENDERER_MAX_THREADS) {
+        thread_count = SOFTWARE_RENDERER_MAX_THREADS;
+    }
+    renderer = (software_renderer_t *)calloc (1, sizeof (software_renderer_t));
+    if (renderer == NULL) {
+        return NULL;
+    }
+    pthread_once (&srgb_table_once, init_srgb_table);
+    select_kernels (renderer);
+    pthread_mutex_init (&renderer->lock, NULL);
+    pthread_cond_init (&renderer->frame_started, NULL);
+    pthread_cond_init (&renderer->band_finished, NULL);
+    /* Drawing thread takes band 0, so it never idles while workers draw */
+    for (uint32_t i = 0; i + 1 < thread_count; i++) {
+        software_worker_t *worker = &renderer->workers[i];
+        worker->renderer = renderer;
+        worker->band = i + 1;
+        if (pthread_create (&worker->thread, NULL, worker_main, worker)) {
+            break;
+        }
+        renderer->worker_count = i + 1;
+    }
+    renderer->band_count = renderer->worker_count + 1;
+    return renderer;
+}
+
+void software_renderer_destroy (software_renderer_t *renderer)
+{
+    if (renderer == NULL) {
+        return;
+    }
+    pthread_mutex_lock (&renderer->lock);
+    renderer->is_stopping = 1;
+    pthread_cond_broadcast (&renderer->frame_started);
+    pthread_mutex_unlock (&renderer->lock);
+    for (uint32_t i = 0; i < renderer->worker_count; i++) {
+        pthread_join (renderer->workers[i].thread, NULL);
+    }
+    pthread_cond_destroy (&renderer->band_finished);
+    pthread_cond_destroy (&renderer->frame_started);
+    pthread_mutex_destroy (&renderer->lock);
+    free (renderer);
+}
+
+const char *software_renderer_get_isa (const software_renderer_t *renderer)
+{
+    return renderer->isa;
+}
+
+uint32_t software_renderer_get_thread_count (const software_renderer_t *renderer)
+{
+    return renderer->band_count;
+}
+
+void software_renderer_draw (software_renderer_t *renderer, uint32_t *pixels,
+                             uint32_t stride, uint32_t width, uint32_t height,
+                             uint64_t frame_number, float angle)
+{
+    software_frame_t *frame = &renderer->frame;
+    const float t = (float)(frame_number % 360) / 360.0f;
+    const float c = cosf (angle);
+    const float s = sinf (angle);
+    float (*v)[2] = frame->positions;
+    pthread_mutex_lock (&renderer->lock);
+    frame->pixels = pixels;
+    frame->stride = stride;
+    frame->width = width;
+    frame->height = height;
+    frame->clear_color = OPAQUE_ALPHA | encode_channel (t) << 16
+                         | encode_channel (0.5f * t) << 8
+                         | encode_channel (1.0f - t);
+    /* Same rotation as triangle.vert, then viewport covering whole image */
+    for (uint32_t i = 0; i < 3; i++) {
+        const float x = triangle_positions[i][0];
+        const float y = triangle_positions[i][1];
+        v[i][0] = (c * x - s * y + 1.0f) * 0.5f * (float)width;
+        v[i][1] = (s * x + c * y + 1.0f) * 0.5f * (float)height;
+    }
+    frame->area = (v[2][0] - v[1][0]) * (v[0][1] - v[1][1])
+                  - (v[2][1] - v[1][1]) * (v[0][0] - v[1][0]);
+    /* Degenerate triangle covers no pixel centers */
+    frame->has_triangle = fabsf (frame->area) > 1e-6f;
+    renderer->frame_id++;
+    renderer->busy_count = renderer->worker_count;
+    pthread_cond_broadcast (&renderer->frame_started);
+    pthread_mutex_unlock (&renderer->lock);
+    draw_band (renderer, 0);
+    pthread_mutex_lock (&renderer->lock);
+    while (renderer->busy_count > 0) {
+        pthread_cond_wait (&renderer->band_finished, &renderer->lock);
+    }
+    pthread_mutex_unlock (&renderer->lock);
+}
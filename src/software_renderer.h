@@ -0,0 +1,50 @@
+/**
+ * @file software_renderer.h
+ * CPU rasterizer of the animated triangle, used when Vulkan is unavailable.
+ *
+ * Rows of the image are split into bands rendered by worker threads. Spans
+ * are filled and colored by SSE2 or AVX2 kernels picked at runtime.
+ */
+#ifndef VKBOOTSTRAP_SOFTWARE_RENDERER_H
+#define VKBOOTSTRAP_SOFTWARE_RENDERER_H
+#include <stdint.h>
+
+/** Maximum number of threads drawing one frame, including the caller */
+#define SOFTWARE_RENDERER_MAX_THREADS 16
+
+typedef struct software_renderer_t software_renderer_t;
+
+/** Create renderer and start its worker threads
+ * @param thread_count number of threads drawing a frame including the
+ *        caller, 0 to pick from number of CPUs
+ * @returns new renderer, or NULL on failure
+ */
+software_renderer_t *software_renderer_create (uint32_t thread_count);
+
+/** Stop workers and free renderer
+ * @param renderer renderer to free, can be NULL
+ */
+void software_renderer_destroy (software_renderer_t *renderer);
+
+/** Get name of instruction set used by span kernels
+ * @returns "avx2", "sse2" or "scalar"
+ */
+const char *software_renderer_get_isa (const software_renderer_t *renderer);
+
+/** Get number of threads drawing each frame, including the caller */
+uint32_t software_renderer_get_thread_count (const software_renderer_t *renderer);
+
+/** Draw frame, returns once all threads have finished it
+ * @param renderer renderer to draw with
+ * @param pixels image of @a width x @a height pixels in 0xffRRGGBB format
+ * @param stride distance between rows of @a pixels in pixels
+ * @param width width of the image
+ * @param height height of the image
+ * @param frame_number number of frame, selects clear color
+ * @param angle rotation of the triangle in radians
+ */
+void software_renderer_draw (software_renderer_t *renderer, uint32_t *pixels,
+                             uint32_t stride, uint32_t width, uint32_t height,
+                             uint64_t frame_number, float angle);
+
+#endif
@@ -0,0 +1,22 @@
+/**
+ * @file timer.c
+ * Monotonic clock based on clock_gettime.
+ */
+#define _POSIX_C_SOURCE 200809L
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <time.h>
+#include "timer.h"
+
+uint64_t timer_now_ns (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+double timer_elapsed_ms (uint64_t begin, uint64_t end)
+{
+    return (double)(end - begin) / 1e6;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file timer.h
+ * Monotonic clock used for all CPU side measurements.
+ */
+#ifndef VKBOOTSTRAP_TIMER_H
+#define VKBOOTSTRAP_TIMER_H
+#include <stdint.h>
+
+/** Get current time of monotonic clock
+ * @returns nanoseconds since unspecified point in the past
+ */
+uint64_t timer_now_ns (void);
+
+/** Convert difference between two timer_now_ns() values to milliseconds */
+double timer_elapsed_ms (uint64_t begin, uint64_t end);
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @file trace.c
+ * Per-thread ring buffers of trace zones and their export to JSON.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include "trace.h"
+
+#ifdef ENABLE_TRACE
+#include <stdatomic.h>
+#include "common.h"
+#include "timer.h"
+
+/** Number of zones each thread keeps, must be power of two */
+#define RING_SIZE 16384
+
+/** Maximum nesting of zones on one thread, deeper zones are not recorded */
+#define MAX_DEPTH 32
+
+/** Closed zone */
+typedef struct trace_zone_t {
+    const char *name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+} trace_zone_t;
+
+/** Ring of zones written by one thread and read by trace_close() */
+typedef struct trace_ring_t {
+    struct trace_ring_t *next; /**< Next ring in list of all rings */
+    uint32_t tid; /**< Id of track in trace */
+    const char *name; /**< Name of track, NULL if not named */
+    atomic_uint_fast64_t head; /**< Number of zones ever written */
+    uint32_t depth; /**< Number of open zones */
+    const char *open_names[MAX_DEPTH];
+    uint64_t open_begin_ns[MAX_DEPTH];
+    trace_zone_t zones[RING_SIZE];
+} trace_ring_t;
+
+static atomic_int is_enabled;
+static atomic_uint next_tid;
+static _Atomic (trace_ring_t *) rings;
+/** Incremented by trace_close(), rings of older generations are freed */
+static atomic_uint generation;
+static _Thread_local trace_ring_t *thread_ring;
+static _Thread_local unsigned thread_generation; /**< Of thread_ring */
+static const char *trace_path;
+static uint64_t base_ns; /**< Time trace was opened */
+static trace_ring_t *gpu_ring;
+static uint64_t gpu_end_ns; /**< End of last frame put on GPU track */
+
+/** Allocate ring and add it to list of all rings
+ * @returns new ring, NULL if out of memory
+ */
+static trace_ring_t *create_ring (const char *name)
+{
+    trace_ring_t *ring = (trace_ring_t *)calloc (1, sizeof (trace_ring_t));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->tid = atomic_fetch_add (&next_tid, 1) + 1;
+    ring->name = name;
+    atomic_init (&ring->head, 0);
+    ring->next = atomic_load (&rings);
+    while (!atomic_compare_exchange_weak (&rings, &ring->next, ring)) {
+    }
+    return ring;
+}
+
+/** Get ring of calling thread if it wasn't freed by trace_close() */
+static trace_ring_t *get_current_ring (void)
+{
+    if (thread_generation != atomic_load_explicit (&generation,
+            memory_order_relaxed)) {
+        return NULL;
+    }
+    return thread_ring;
+}
+
+/** Get ring of calling thread, creating it on first use */
+static trace_ring_t *get_thread_ring (void)
+{
+    trace_ring_t *ring = get_current_ring ();
+    if (ring == NULL) {
+        thread_generation = atomic_load_explicit (&generation,
+                            memory_order_relaxed);
+        thread_ring = create_ring (NULL);
+        ring = thread_ring;
+    }
+    return ring;
+}
+
+/** Append zone to ring, only owner of the ring may call it */
+static void push_zone (trace_ring_t *ring, const char *name, uint64_t begin_ns,
+                       uint64_t end_ns)
+{
+    const uint_fast64_t head = atomic_load_explicit (&ring->head,
+                               memory_order_relaxed);
+    trace_zone_t *zone = &ring->zones[head & (RING_SIZE - 1)];
+    zone->name = name;
+    zone->begin_ns = begin_ns;
+    zone->end_ns = end_ns;
+    atomic_store_explicit (&ring->head, head + 1, memory_order_release);
+}
+
+int trace_open (const char *path)
+{
+    trace_path = path;
+    base_ns = timer_now_ns ();
+    gpu_end_ns = 0;
+    gpu_ring = create_ring ("GPU");
+    if (gpu_ring == NULL) {
+        return -1;
+    }
+    atomic_store (&is_enabled, 1);
+    return 0;
+}
+
+void trace_thread_name (const char *name)
+{
+    trace_ring_t *ring = NULL;
+    if (!atomic_load_explicit (&is_enabled, memory_order_relaxed)) {
+        return;
+    }
+    ring = get_thread_ring ();
+    if (ring != NULL) {
+        ring->name = name;
+    }
+}
+
+void trace_begin (const char *name)
+{
+    trace_ring_t *ring = NULL;
+    if (!atomic_load_explicit (&is_enabled, memory_order_relaxed)) {
+        return;
+    }
+    ring = get_thread_ring ();
+    if (ring == NULL) {
+        return;
+    }
+    if (ring->depth < MAX_DEPTH) {
+        ring->open_names[ring->depth] = name;
+        ring->open_begin_ns[ring->depth] = timer_now_ns ();
+    }
+    ring->depth++;
+}
+
+void trace_end (void)
+{
+    trace_ring_t *ring = get_current_ring ();
+    if (!atomic_load_explicit (&is_enabled, memory_order_relaxed)
+            || ring == NULL || ring->depth == 0) {
+        return;
+    }
+    ring->depth--;
+    if (ring->depth < MAX_DEPTH) {
+        push_zone (ring, ring->open_names[ring->depth],
+                   ring->open_begin_ns[ring->depth], timer_now_ns ());
+    }
+}
+
+void trace_gpu_frame (const gpu_frame_timings_t *timings, uint64_t submit_ns)
+{
+    uint64_t begin_ns = submit_ns > gpu_end_ns ? submit_ns : gpu_end_ns;
+    if (!atomic_load_explicit (&is_enabled, memory_order_relaxed)) {
+        return;
+    }
+    gpu_end_ns = begin_ns + (uint64_t)(timings->frame_ms * 1e6);
+    push_zone (gpu_ring, "frame", begin_ns, gpu_end_ns);
+    for (uint32_t i = 0; i < timings->pass_count; i++) {
+        const uint64_t pass_begin_ns =
+            begin_ns + (uint64_t)(timings->pass_start_ms[i] * 1e6);
+        push_zone (gpu_ring, timings->pass_names[i], pass_begin_ns,
+                   pass_begin_ns + (uint64_t)(timings->pass_ms[i] * 1e6));
+    }
+}
+
+/** Write zones kept in ring as complete events
+ * @param separator receives "," once first event is written
+ */
+static void write_ring (FILE *file, const trace_ring_t *ring,
+                        const char **separator)
+{
+    const uint_fast64_t head = atomic_load_explicit (&ring->head,
+                               memory_order_acquire);
+    const uint_fast64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+    if (ring->name != NULL) {
+        fprintf (file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%u,\"args\":{\"name\":", *separator, ring->tid);
+        write_json_string (file, ring->name);
+        fprintf (file, "}}");
+        *separator = ",";
+    }
+    for (uint_fast64_t i = first; i < head; i++) {
+        const trace_zone_t *zone = &ring->zones[i & (RING_SIZE - 1)];
+        fprintf (file, "%s\n{\"name\":", *separator);
+        write_json_string (file, zone->name);
+        fprintf (file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                 "\"ts\":%.3f,\"dur\":%.3f}",
+                 ring == gpu_ring ? "gpu" : "cpu", ring->tid,
+                 (double)(zone->begin_ns - base_ns) / 1e3,
+                 (double)(zone->end_ns - zone->begin_ns) / 1e3);
+        *separator = ",";
+    }
+}
+
+int trace_close (void)
+{
+    trace_ring_t *ring = NULL;
+    const char *separator = "";
+    FILE *file = NULL;
+    int error = 0;
+    if (!atomic_exchange (&is_enabled, 0)) {
+        return 0;
+    }
+    file = fopen (trace_path, "w");
+    if (file != NULL) {
+        fprintf (file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        for (ring = atomic_load (&rings); ring != NULL; ring = ring->next) {
+            write_ring (file, ring, &separator);
+        }
+        fprintf (file, "\n]}\n");
+        error = fclose (file) != 0;
+    } else {
+        error = 1;
+    }
+    while ((ring = atomic_load (&rings)) != NULL) {
+        atomic_store (&rings, ring->next);
+        free (ring);
+    }
+    /* Rings other threads still point to are freed too */
+    atomic_fetch_add (&generation, 1);
+    thread_ring = NULL;
+    gpu_ring = NULL;
+    return error ? -1 : 0;
+}
+
+#else
+
+int trace_open (const char *path)
+{
+    (void)path;
+    return -1;
+}
+
+int trace_close (void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file trace.h
+ * Scoped CPU trace zones and GPU ranges exported as Chrome trace JSON.
+ *
+ * Zones are recorded with TRACE_* macros, which expand to nothing unless
+ * ENABLE_TRACE is defined. Each thread writes to its own ring buffer, so
+ * recording a zone takes no lock; when a ring is full the oldest zones are
+ * overwritten.
+ */
+#ifndef VKBOOTSTRAP_TRACE_H
+#define VKBOOTSTRAP_TRACE_H
+#include <stdint.h>
+#include "gpu_profiler.h"
+
+/** Start recording zones of all threads, again after trace_close() too
+ * @param path file trace_close() writes the trace to
+ * @returns 0 on success, -1 if tracing is compiled out or out of memory
+ */
+int trace_open (const char *path);
+
+/** Stop recording and write Chrome trace-event JSON
+ *
+ * Threads that record zones should be finished before the call, zones they
+ * record while the trace is being written may be lost.
+ * @returns 0 on success or if trace is not open, -1 if file can't be written
+ */
+int trace_close (void);
+
+#ifdef ENABLE_TRACE
+
+/** Give calling thread a name shown in trace viewer
+ * @param name string literal, must stay valid until trace_close()
+ */
+void trace_thread_name (const char *name);
+
+/** Open zone on calling thread, zones must be closed in reverse order
+ * @param name string literal, must stay valid until trace_close()
+ */
+void trace_begin (const char *name);
+
+/** Close innermost zone of calling thread */
+void trace_end (void);
+
+/** Put GPU timings of frame on GPU track
+ *
+ * GPU clock isn't calibrated against CPU one, so the frame is assumed to
+ * start when it was submitted or when the previous frame ended, whichever
+ * is later. Must be called from one thread in order of frames.
+ * @param timings timings read back by GPU profiler
+ * @param submit_ns time the frame was submitted, see timer_now_ns()
+ */
+void trace_gpu_frame (const gpu_frame_timings_t *timings, uint64_t submit_ns);
+
+#define TRACE_THREAD_NAME(name) trace_thread_name (name)
+#define TRACE_BEGIN(name) trace_begin (name)
+#define TRACE_END() trace_end ()
+#define TRACE_GPU_FRAME(timings, submit_ns) trace_gpu_frame (timings, submit_ns)
+
+#else
+
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+#define TRACE_GPU_FRAME(timings, submit_ns) ((void)0)
+
+#endif
+
+#endif
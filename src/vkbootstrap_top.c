@@ -0,0 +1,194 @@
+/**
+ * @file vkbootstrap_top.c
+ * Entry point of vkbootstrap-top, that shows live metrics of running
+ * vkbootstrap process.
+ */
+#define _POSIX_C_SOURCE 200809L
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <signal.h>
+#include <time.h>
+#include "live_metrics.h"
+#include "timer.h"
+
+/** Directory where POSIX shared memory segments are visible on Linux */
+#define SHM_DIRECTORY "/dev/shm"
+#define SEGMENT_PREFIX "vkbootstrap."
+
+/** Metrics not updated for this long are shown as stalled */
+#define STALL_NS 2000000000ull
+
+/** The name the program was run with */
+static const char *program_name;
+
+/** Flag that requests printing single snapshot */
+static int once = 0;
+
+/** Time between snapshots in milliseconds */
+static long interval_ms = 500;
+
+static const char *version_text =
+    "vkbootstrap-top (" PACKAGE_STRING ")\n\n"
+    "Copyright (C) 2017 Egor Artemov <egor.artemov@gmail.com>\n"
+    "This work is free. You can redistribute it and/or modify it under the\n"
+    "terms of the Do What The Fuck You Want To Public License, Version 2,\n"
+    "as published by Sam Hocevar. See http://www.wtfpl.net for more details.\n";
+
+static struct option const long_options[] = {
+    {"help", no_argument, NULL, 'h'},
+    {"version", no_argument, NULL, 'V'},
+    {"once", no_argument, NULL, '1'},
+    {"interval", required_argument, NULL, 'i'},
+    {NULL, 0, NULL, 0}
+};
+
+/** Print usage information */
+static void print_usage (void)
+{
+    printf ("Usage: %s [OPTION]... [PID]\n"
+            "Shows live metrics of vkbootstrap run with --live-metrics\n\n"
+            "Options:\n"
+            "  -h, --help        display this help and exit\n"
+            "  -V, --version     output version information and exit\n"
+            "  -1, --once        print one snapshot and exit\n"
+            "  -i, --interval=MS time between snapshots (500)\n"
+            "\nWithout PID the first process found in " SHM_DIRECTORY
+            " is shown.\n"
+            "\nReport bugs to: <" PACKAGE_BUGREPORT ">\n", program_name);
+}
+
+/** Parse command-line arguments
+ * @returns pid given on command line, 0 if there is none
+ */
+static int parse_args (int argc, char *const *argv)
+{
+    int opt;
+    char *end = NULL;
+    long pid = 0;
+    program_name = argv[0];
+    while ((opt = getopt_long (argc, argv, "hV1i:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h':
+                print_usage ();
+                exit (EXIT_SUCCESS);
+            case 'V':
+                printf ("%s\n", version_text);
+                exit (EXIT_SUCCESS);
+            case '1':
+                once = 1;
+                break;
+            case 'i':
+                interval_ms = strtol (optarg, &end, 10);
+                if (*end != '\0' || interval_ms <= 0) {
+                    fprintf (stderr, "%s: invalid interval '%s'\n", program_name,
+                             optarg);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            default:
+                print_usage ();
+                exit (EXIT_FAILURE);
+        }
+    }
+    if (optind < argc) {
+        pid = strtol (argv[optind], &end, 10);
+        if (*end != '\0' || pid <= 0 || pid > INT32_MAX) {
+            fprintf (stderr, "%s: invalid pid '%s'\n", program_name,
+                     argv[optind]);
+            exit (EXIT_FAILURE);
+        }
+    }
+    return (int)pid;
+}
+
+/** Find process that publishes metrics
+ * @returns pid, 0 if there is none
+ */
+static int find_publisher (void)
+{
+    DIR *directory = opendir (SHM_DIRECTORY);
+    struct dirent *entry = NULL;
+    int pid = 0;
+    if (directory == NULL) {
+        return 0;
+    }
+    while (pid == 0 && (entry = readdir (directory)) != NULL) {
+        if (strncmp (entry->d_name, SEGMENT_PREFIX,
+                     strlen (SEGMENT_PREFIX)) == 0) {
+            pid = atoi (entry->d_name + strlen (SEGMENT_PREFIX));
+            if (pid > 0 && kill (pid, 0) != 0 && errno == ESRCH) {
+                /* Segment was left by process that has crashed */
+                pid = 0;
+            }
+        }
+    }
+    closedir (directory);
+    return pid;
+}
+
+static void print_metrics (int pid, const live_metrics_data_t *data)
+{
+    const int is_stalled = timer_now_ns () - data->update_ns > STALL_NS;
+    printf ("pid %d  frame %llu%s\n"
+            "  cpu  %7.3f ms  avg %7.3f ms\n"
+            "  gpu  %7.3f ms  avg %7.3f ms\n"
+            "  present interval avg %7.3f ms  dropped %llu\n"
+            "  input to present avg %7.3f ms\n"
+            "  swapchain %ux%u  %u images  %s\n"
+            "  resident %.1f MiB\n",
+            pid, (unsigned long long)data->frame_number,
+            is_stalled ? "  (stalled)" : "",
+            data->cpu_frame_ms, data->cpu_frame_ms_avg,
+            data->gpu_frame_ms, data->gpu_frame_ms_avg,
+            data->present_interval_ms_avg,
+            (unsigned long long)data->dropped_frames,
+            data->input_latency_ms_avg,
+            data->width, data->height, data->image_count, data->present_mode,
+            (double)data->resident_bytes / (1024.0 * 1024.0));
+    fflush (stdout);
+}
+
+int main (int argc, char *const *argv)
+{
+    int pid = parse_args (argc, argv);
+    live_metrics_reader_t *reader = NULL;
+    live_metrics_data_t data;
+    const struct timespec interval = {
+        .tv_sec = interval_ms / 1000,
+        .tv_nsec = (interval_ms % 1000) * 1000000,
+    };
+    if (pid == 0) {
+        pid = find_publisher ();
+    }
+    if (pid == 0 || (reader = live_metrics_open (pid)) == NULL) {
+        fprintf (stderr, "%s: no live metrics found, run vkbootstrap "
+                 "with --live-metrics\n", program_name);
+        return EXIT_FAILURE;
+    }
+    for (;;) {
+        if (kill (pid, 0) != 0 && errno == ESRCH) {
+            fprintf (stderr, "%s: process %d has exited\n", program_name, pid);
+            break;
+        }
+        if (live_metrics_read (reader, &data)) {
+            if (!once) {
+                /* Clear terminal and move cursor home */
+                printf ("\033[H\033[2J");
+            }
+            print_metrics (pid, &data);
+        }
+        if (once) {
+            break;
+        }
+        nanosleep (&interval, NULL);
+    }
+    live_metrics_close (reader);
+    return EXIT_SUCCESS;
+}
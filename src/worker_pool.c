@@ -0,0 +1,133 @@
+/**
+ * @file worker_pool.c
+ * Workers sleep on condition variable between batches.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <pthread.h>
+#include "trace.h"
+#include "worker_pool.h"
+
+struct worker_pool_t {
+    const char *name;
+    uint32_t worker_count;
+    pthread_t workers[WORKER_POOL_MAX_THREADS - 1];
+    pthread_mutex_t lock; /**< Protects everything below */
+    pthread_cond_t batch_started;
+    pthread_cond_t batch_finished;
+    uint64_t batch_id; /**< Incremented when workers have to run a batch */
+    uint32_t busy_count; /**< Workers still running current batch */
+    int is_stopping;
+    worker_pool_fn fn;
+    void *context;
+    uint32_t count; /**< Number of items of current batch */
+    uint32_t next; /**< Next item to take */
+};
+
+/** Run items until none is left, called with lock held */
+static void run_items (worker_pool_t *pool)
+{
+    while (pool->next < pool->count) {
+        const uint32_t index = pool->next++;
+        pthread_mutex_unlock (&pool->lock);
+        pool->fn (pool->context, index);
+        pthread_mutex_lock (&pool->lock);
+    }
+}
+
+static void *worker_main (void *arg)
+{
+    worker_pool_t *pool = (worker_pool_t *)arg;
+    uint64_t batch_id = 0;
+    TRACE_THREAD_NAME (pool->name);
+    pthread_mutex_lock (&pool->lock);
+    for (;;) {
+        while (!pool->is_stopping && pool->batch_id == batch_id) {
+            pthread_cond_wait (&pool->batch_started, &pool->lock);
+        }
+        if (pool->is_stopping) {
+            break;
+        }
+        batch_id = pool->batch_id;
+        run_items (pool);
+        if (--pool->busy_count == 0) {
+            pthread_cond_signal (&pool->batch_finished);
+        }
+    }
+    pthread_mutex_unlock (&pool->lock);
+    return NULL;
+}
+
+worker_pool_t *worker_pool_create (uint32_t thread_count, const char *name)
+{
+    worker_pool_t *pool = NULL;
+    if (thread_count > WORKER_POOL_MAX_THREADS) {
+        thread_count = WORKER_POOL_MAX_THREADS;
+    }
+    pool = (worker_pool_t *)calloc (1, sizeof (worker_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->name = name;
+    pthread_mutex_init (&pool->lock, NULL);
+    pthread_cond_init (&pool->batch_started, NULL);
+    pthread_cond_init (&pool->batch_finished, NULL);
+    /* Calling thread also takes items, so it never idles during a batch */
+    for (uint32_t i = 0; i + 1 < thread_count; i++) {
+        if (pthread_create (&pool->workers[i], NULL, worker_main, pool)) {
+            break;
+        }
+        pool->worker_count = i + 1;
+    }
+    return pool;
+}
+
+void worker_pool_destroy (worker_pool_t *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock (&pool->lock);
+    pool->is_stopping = 1;
+    pthread_cond_broadcast (&pool->batch_started);
+    pthread_mutex_unlock (&pool->lock);
+    for (uint32_t i = 0; i < pool->worker_count; i++) {
+        pthread_join (pool->workers[i], NULL);
+    }
+    pthread_cond_destroy (&pool->batch_finished);
+    pthread_cond_destroy (&pool->batch_started);
+    pthread_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+uint32_t worker_pool_get_thread_count (const worker_pool_t *pool)
+{
+    return pool->worker_count + 1;
+}
+
+void worker_pool_run (worker_pool_t *pool, uint32_t count, worker_pool_fn fn,
+                      void *context)
+{
+    if (pool->worker_count == 0 || count < 2) {
+        /* Waking workers costs more than the items would gain */
+        for (uint32_t i = 0; i < count; i++) {
+            fn (context, i);
+        }
+        return;
+    }
+    pthread_mutex_lock (&pool->lock);
+    pool->fn = fn;
+    pool->context = context;
+    pool->count = count;
+    pool->next = 0;
+    pool->batch_id++;
+    pool->busy_count = pool->worker_count;
+    pthread_cond_broadcast (&pool->batch_started);
+    run_items (pool);
+    while (pool->busy_count > 0) {
+        pthread_cond_wait (&pool->batch_finished, &pool->lock);
+    }
+    pthread_mutex_unlock (&pool->lock);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file worker_pool.h
+ * Threads that run items of a batch in parallel with the calling thread.
+ *
+ * Items are taken one by one from a shared counter, so a batch of uneven
+ * items still keeps all threads busy until it is done.
+ */
+#ifndef VKBOOTSTRAP_WORKER_POOL_H
+#define VKBOOTSTRAP_WORKER_POOL_H
+#include <stdint.h>
+
+/** Maximum number of threads running a batch, including the caller */
+#define WORKER_POOL_MAX_THREADS 16
+
+/** Function run for each item of batch
+ * @param context context given to worker_pool_run()
+ * @param index index of item, from 0 to number of items - 1
+ */
+typedef void (*worker_pool_fn) (void *context, uint32_t index);
+
+typedef struct worker_pool_t worker_pool_t;
+
+/** Create pool and start its worker threads
+ * @param thread_count number of threads running a batch including the
+ *        caller, 1 runs batches on the caller only
+ * @param name static name of worker threads in trace
+ * @returns new pool, or NULL on failure
+ */
+worker_pool_t *worker_pool_create (uint32_t thread_count, const char *name);
+
+/** Stop workers and free pool
+ * @param pool pool to free, can be NULL
+ */
+void worker_pool_destroy (worker_pool_t *pool);
+
+/** Get number of threads running each batch, including the caller */
+uint32_t worker_pool_get_thread_count (const worker_pool_t *pool);
+
+/** Run @a fn for each item, returns once all items are done
+ * @param pool pool to run batch on
+ * @param count number of items
+ * @param fn function run for each item, possibly on several threads at once
+ * @param context passed to @a fn
+ */
+void worker_pool_run (worker_pool_t *pool, uint32_t count, worker_pool_fn fn,
+                      void *context);
+
+#endif
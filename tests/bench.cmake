@@ -0,0 +1,168 @@
+# Run benchmark scenarios and compare them against baseline
+#
+# Usage: cmake -DVKBOOTSTRAP=<exe> -DBASELINE=<json> -DWORK_DIR=<dir>
+#              [-DXVFB_RUN=<xvfb-run>] [-DICD=<manifest>]
+#              [-DSCENARIOS=name,name] [-DUPDATE=ON] -P bench.cmake
+#
+# Each scenario of baseline runs vkbootstrap --benchmark with its arguments
+# "runs" times and takes median of every metric. Metric is a dotted path in
+# benchmark report, all of them are times, so only growth over baseline by
+# more than tolerance_percent is a regression. Baseline values are strings,
+# so they survive rewriting of the file exactly. With UPDATE they are replaced
+# by measured ones instead.
+#
+# Baseline is measured on the host named by its "device". While it is marked
+# "provisional" its values are estimates, so regressions are only reported
+# as warnings; UPDATE of all scenarios on that host clears the mark. The
+# upload scenario renders in software and uploads every frame through
+# MIT-SHM. Resize storm has no scenario: without a window manager nothing
+# resizes the window, and a resize from vkbootstrap itself would not measure
+# the reconfigure path users hit.
+cmake_minimum_required(VERSION 3.19)
+
+foreach(variable VKBOOTSTRAP BASELINE WORK_DIR)
+    if(NOT DEFINED ${variable})
+        message(FATAL_ERROR "bench: ${variable} is not set")
+    endif()
+endforeach()
+
+# Reports are compared in fixed point, CMake has no floating point math
+set(FIXED_DIGITS 6)
+set(FIXED_ONE 1000000)
+
+# Convert non-negative decimal number to integer in millionths
+function(to_fixed value out)
+    if(NOT value MATCHES "^([0-9]+)(\\.([0-9]*))?$")
+        message(FATAL_ERROR "bench: '${value}' is not a plain decimal number")
+    endif()
+    set(whole ${CMAKE_MATCH_1})
+    set(fraction "${CMAKE_MATCH_3}000000")
+    string(SUBSTRING "${fraction}" 0 ${FIXED_DIGITS} fraction)
+    string(REGEX REPLACE "^0+([0-9])" "\\1" fraction "${fraction}")
+    math(EXPR fixed "${whole} * ${FIXED_ONE} + ${fraction}")
+    set(${out} ${fixed} PARENT_SCOPE)
+endfunction()
+
+# Convert millionths back to decimal number with 4 digits after point
+function(from_fixed fixed out)
+    math(EXPR whole "${fixed} / ${FIXED_ONE}")
+    math(EXPR fraction "${fixed} % ${FIXED_ONE} / 100 + 10000")
+    string(SUBSTRING "${fraction}" 1 4 fraction)
+    set(${out} "${whole}.${fraction}" PARENT_SCOPE)
+endfunction()
+
+if(DEFINED ICD AND NOT ICD STREQUAL "")
+    set(ENV{VK_ICD_FILENAMES} "${ICD}")
+endif()
+# Pipeline cache of the user must not affect startup time
+set(ENV{XDG_CACHE_HOME} "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+if(DEFINED SCENARIOS AND NOT SCENARIOS STREQUAL "")
+    string(REPLACE "," ";" SCENARIOS "${SCENARIOS}")
+endif()
+
+file(READ "${BASELINE}" baseline)
+string(JSON provisional ERROR_VARIABLE error GET "${baseline}" provisional)
+if(error)
+    set(provisional OFF)
+endif()
+if(provisional AND NOT UPDATE)
+    message(STATUS "bench: baseline is provisional, regressions don't fail")
+endif()
+string(JSON scenario_count LENGTH "${baseline}" scenarios)
+math(EXPR last_scenario "${scenario_count} - 1")
+set(regressions "")
+foreach(i RANGE ${last_scenario})
+    string(JSON name GET "${baseline}" scenarios ${i} name)
+    if(SCENARIOS AND NOT name IN_LIST SCENARIOS)
+        continue()
+    endif()
+    string(JSON runs GET "${baseline}" scenarios ${i} runs)
+    set(arguments "")
+    string(JSON argument_count LENGTH "${baseline}" scenarios ${i} args)
+    math(EXPR last_argument "${argument_count} - 1")
+    foreach(j RANGE ${last_argument})
+        string(JSON argument GET "${baseline}" scenarios ${i} args ${j})
+        list(APPEND arguments "${argument}")
+    endforeach()
+
+    set(wrapper "")
+    if(NOT "--headless" IN_LIST arguments AND "$ENV{DISPLAY}" STREQUAL "")
+        if(NOT XVFB_RUN)
+            message(FATAL_ERROR "bench: ${name} needs X server, install "
+                "xvfb-run or select headless scenarios with SCENARIOS")
+        endif()
+        set(wrapper ${XVFB_RUN} -a -s "-screen 0 1024x768x24")
+    endif()
+
+    string(JSON metric_count LENGTH "${baseline}" scenarios ${i} metrics)
+    math(EXPR last_metric "${metric_count} - 1")
+    foreach(k RANGE ${last_metric})
+        set(samples_${k} "")
+    endforeach()
+    foreach(run RANGE 1 ${runs})
+        set(report "${WORK_DIR}/${name}.${run}.json")
+        execute_process(
+            COMMAND ${wrapper} ${VKBOOTSTRAP} --benchmark --output=${report}
+                ${arguments}
+            WORKING_DIRECTORY "${WORK_DIR}"
+            RESULT_VARIABLE exit_code)
+        if(NOT exit_code EQUAL 0)
+            message(FATAL_ERROR "bench: ${name} run ${run} failed: ${exit_code}")
+        endif()
+        file(READ "${report}" report_json)
+        foreach(k RANGE ${last_metric})
+            string(JSON metric MEMBER "${baseline}" scenarios ${i} metrics ${k})
+            string(REPLACE "." ";" path "${metric}")
+            string(JSON value GET "${report_json}" ${path})
+            to_fixed("${value}" value)
+            list(APPEND samples_${k} ${value})
+        endforeach()
+    endforeach()
+
+    foreach(k RANGE ${last_metric})
+        string(JSON metric MEMBER "${baseline}" scenarios ${i} metrics ${k})
+        list(SORT samples_${k} COMPARE NATURAL)
+        list(LENGTH samples_${k} count)
+        math(EXPR middle "${count} / 2")
+        list(GET samples_${k} ${middle} value)
+        from_fixed(${value} shown)
+        if(UPDATE)
+            string(JSON baseline SET "${baseline}"
+                scenarios ${i} metrics ${metric} baseline "\"${shown}\"")
+            message(STATUS "bench: ${name} ${metric} ${shown}")
+            continue()
+        endif()
+        string(JSON expected GET "${baseline}"
+            scenarios ${i} metrics ${metric} baseline)
+        string(JSON tolerance GET "${baseline}"
+            scenarios ${i} metrics ${metric} tolerance_percent)
+        to_fixed("${expected}" expected)
+        math(EXPR limit "${expected} * (100 + ${tolerance}) / 100")
+        from_fixed(${limit} shown_limit)
+        if(value GREATER limit)
+            set(verdict "REGRESSION")
+            list(APPEND regressions "${name} ${metric}")
+        else()
+            set(verdict "ok")
+        endif()
+        message(STATUS "bench: ${name} ${metric} ${shown} "
+            "(limit ${shown_limit}) ${verdict}")
+    endforeach()
+endforeach()
+
+if(UPDATE)
+    # Scenarios left out keep their estimates
+    if(provisional AND NOT SCENARIOS)
+        string(JSON baseline SET "${baseline}" provisional false)
+    endif()
+    file(WRITE "${BASELINE}" "${baseline}\n")
+    message(STATUS "bench: baseline ${BASELINE} updated")
+elseif(regressions)
+    string(REPLACE ";" ", " regressions "${regressions}")
+    if(provisional)
+        message(WARNING "bench: regressions in ${regressions}")
+    else()
+        message(FATAL_ERROR "bench: regressions in ${regressions}")
+    endif()
+endif()
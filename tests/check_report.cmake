@@ -0,0 +1,67 @@
+# Check fields of report written by vkbootstrap --output
+#
+# Usage: cmake -DREPORT=<json> -P check_report.cmake <check>...
+#
+# Each check is PATH=VALUE, which compares field as string, or PATH>=VALUE,
+# which compares it as number. PATH is dotted like metrics of bench.cmake,
+# numbers in it index arrays. Booleans are true or false, null is null.
+cmake_minimum_required(VERSION 3.19)
+
+if(NOT DEFINED REPORT)
+    message(FATAL_ERROR "check_report: REPORT is not set")
+endif()
+if(NOT EXISTS "${REPORT}")
+    message(FATAL_ERROR "check_report: ${REPORT} was not written")
+endif()
+file(READ "${REPORT}" report_json)
+
+# Arguments up to -P and the script itself belong to cmake
+set(first_check 0)
+math(EXPR last_argument "${CMAKE_ARGC} - 1")
+foreach(i RANGE ${last_argument})
+    if(CMAKE_ARGV${i} STREQUAL "-P")
+        math(EXPR first_check "${i} + 2")
+    endif()
+endforeach()
+
+set(failures "")
+foreach(i RANGE ${first_check} ${last_argument})
+    set(check "${CMAKE_ARGV${i}}")
+    if(check MATCHES "^([^=>]+)>=(.*)$")
+        set(is_number ON)
+    elseif(check MATCHES "^([^=>]+)=(.*)$")
+        set(is_number OFF)
+    else()
+        message(FATAL_ERROR "check_report: invalid check '${check}'")
+    endif()
+    set(field "${CMAKE_MATCH_1}")
+    set(expected "${CMAKE_MATCH_2}")
+    string(REPLACE "." ";" path "${field}")
+    string(JSON type ERROR_VARIABLE error TYPE "${report_json}" ${path})
+    if(error)
+        list(APPEND failures "${field} is missing")
+        continue()
+    endif()
+    string(JSON value GET "${report_json}" ${path})
+    if(type STREQUAL "NULL")
+        set(value "null")
+    elseif(type STREQUAL "BOOLEAN")
+        if(value)
+            set(value "true")
+        else()
+            set(value "false")
+        endif()
+    endif()
+    if(is_number)
+        if(NOT type STREQUAL "NUMBER" OR value LESS expected)
+            list(APPEND failures "${field} is ${value}, expected >= ${expected}")
+        endif()
+    elseif(NOT value STREQUAL expected)
+        list(APPEND failures "${field} is ${value}, expected ${expected}")
+    endif()
+endforeach()
+
+if(failures)
+    string(REPLACE ";" ", " failures "${failures}")
+    message(FATAL_ERROR "check_report: ${REPORT}: ${failures}")
+endif()
@@ -0,0 +1,1798 @@
+/**
+ * @file mock_icd.c
+ * Vulkan driver that executes nothing, for testing device and swapchain
+ * handling of vkbootstrap on machines without GPU.
+ *
+ * Loader picks the driver up when VK_ICD_FILENAMES points to its manifest.
+ * Topology and faults are read from environment on first use:
+ * - VKBOOTSTRAP_MOCK_DEVICES: number of physical devices (1)
+ * - VKBOOTSTRAP_MOCK_QUEUE_FAMILIES: queue families of each device (1), all
+ *   support compute and transfer
+ * - VKBOOTSTRAP_MOCK_GRAPHICS_FAMILY: index of the only queue family that
+ *   supports graphics, index past the last family means none (0)
+ * - VKBOOTSTRAP_MOCK_PRESENT_FAMILY: index of the only queue family that
+ *   can present to surfaces, index past the last family means none (0)
+ * - VKBOOTSTRAP_MOCK_MEMORY_HEAPS: memory heaps of each device (2), each
+ *   has one memory type, the first is device local, others host visible
+ * - VKBOOTSTRAP_MOCK_PRESENT_MODES: comma separated list of immediate,
+ *   mailbox, fifo and fifo_relaxed, empty list means none (fifo)
+ * - VKBOOTSTRAP_MOCK_FORMATS: comma separated list of surface formats
+ *   bgra8_srgb, rgba8_srgb, bgra8_unorm, rgba8_unorm, a2b10g10r10,
+ *   a2r10g10b10 and undefined, the last one lets swapchain choose, empty
+ *   list means none (bgra8_srgb,rgba8_srgb)
+ * - VKBOOTSTRAP_MOCK_IMAGES: MIN,MAX image count of surface, MAX 0 means
+ *   no limit (2,8)
+ * - VKBOOTSTRAP_MOCK_EXTENT: WIDTHxHEIGHT of surface, "any" lets swapchain
+ *   choose (any)
+ * - VKBOOTSTRAP_MOCK_HEADLESS_SURFACE: 0 hides VK_EXT_headless_surface (1)
+ * - VKBOOTSTRAP_MOCK_LATENCY: comma separated FUNCTION:MICROSECONDS, each
+ *   call of FUNCTION sleeps that long
+ * - VKBOOTSTRAP_MOCK_ERRORS: comma separated FUNCTION:RESULT[@FIRST[-LAST]],
+ *   where FUNCTION returns RESULT from its FIRST-th call on, or only from
+ *   FIRST-th to LAST-th call, or on every call without @FIRST. RESULT is a
+ *   VkResult name or its value
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_icd.h>
+
+#define MAX_RULES 32
+#define MAX_FUNCTION_NAME 64
+#define MAX_SWAPCHAIN_IMAGES 16
+#define MAX_PRESENT_MODES 4
+#define MAX_SURFACE_FORMATS 7
+#define MAX_EXTENT 16384
+/** Ticks between consecutive timestamp queries, period is 1 ns */
+#define TIMESTAMP_STEP 100000u
+#define MOCK_VENDOR_ID 0x10000u
+
+/** Latency or error injected into one entry point */
+typedef struct mock_rule_t {
+    char function[MAX_FUNCTION_NAME];
+    int is_error; /**< true if rule injects result, false if latency */
+    VkResult result;
+    /** First call that fails counting from 1, 0 for all */
+    unsigned long first_call;
+    unsigned long last_call; /**< Last call that fails, 0 for no limit */
+    unsigned long latency_us;
+    unsigned long calls; /**< Number of calls seen so far */
+} mock_rule_t;
+
+/** Configuration read from environment, see top of file */
+typedef struct mock_config_t {
+    uint32_t device_count;
+    uint32_t queue_family_count;
+    uint32_t graphics_family;
+    uint32_t present_family;
+    uint32_t memory_heap_count;
+    uint32_t present_mode_count;
+    VkPresentModeKHR present_modes[MAX_PRESENT_MODES];
+    uint32_t format_count;
+    VkSurfaceFormatKHR formats[MAX_SURFACE_FORMATS];
+    uint32_t min_image_count;
+    uint32_t max_image_count;
+    VkExtent2D extent; /**< UINT32_MAX if swapchain chooses */
+    int has_headless_surface;
+    uint32_t rule_count;
+    mock_rule_t rules[MAX_RULES];
+} mock_config_t;
+
+typedef struct mock_physical_device_t {
+    VK_LOADER_DATA loader_data;
+    uint32_t index;
+} mock_physical_device_t;
+
+typedef struct mock_instance_t {
+    VK_LOADER_DATA loader_data;
+    mock_physical_device_t *devices;
+} mock_instance_t;
+
+typedef struct mock_queue_t {
+    VK_LOADER_DATA loader_data;
+} mock_queue_t;
+
+typedef struct mock_device_t {
+    VK_LOADER_DATA loader_data;
+    mock_queue_t queue;
+} mock_device_t;
+
+typedef struct mock_command_buffer_t {
+    VK_LOADER_DATA loader_data;
+    struct mock_command_buffer_t *next; /**< Next buffer of the same pool */
+} mock_command_buffer_t;
+
+typedef struct mock_command_pool_t {
+    mock_command_buffer_t *buffers;
+} mock_command_pool_t;
+
+typedef struct mock_fence_t {
+    int is_signaled;
+} mock_fence_t;
+
+typedef struct mock_image_t {
+    VkExtent3D extent;
+} mock_image_t;
+
+/** Device memory, host storage is allocated when it is first mapped */
+typedef struct mock_memory_t {
+    VkDeviceSize size;
+    void *data;
+} mock_memory_t;
+
+typedef struct mock_buffer_t {
+    VkDeviceSize size;
+} mock_buffer_t;
+
+typedef struct mock_swapchain_t {
+    uint32_t image_count;
+    uint32_t next_image;
+    mock_image_t images[MAX_SWAPCHAIN_IMAGES];
+} mock_swapchain_t;
+
+typedef struct mock_query_pool_t {
+    VkQueryType type;
+    uint32_t count;
+} mock_query_pool_t;
+
+/** Header of pipeline cache data, see vkGetPipelineCacheData */
+typedef struct mock_cache_header_t {
+    uint32_t length;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+} mock_cache_header_t;
+
+static const struct {
+    const char *name;
+    VkResult result;
+} result_names[] = {
+    {"VK_SUCCESS", VK_SUCCESS},
+    {"VK_NOT_READY", VK_NOT_READY},
+    {"VK_TIMEOUT", VK_TIMEOUT},
+    {"VK_INCOMPLETE", VK_INCOMPLETE},
+    {"VK_SUBOPTIMAL_KHR", VK_SUBOPTIMAL_KHR},
+    {"VK_ERROR_OUT_OF_HOST_MEMORY", VK_ERROR_OUT_OF_HOST_MEMORY},
+    {"VK_ERROR_OUT_OF_DEVICE_MEMORY", VK_ERROR_OUT_OF_DEVICE_MEMORY},
+    {"VK_ERROR_INITIALIZATION_FAILED", VK_ERROR_INITIALIZATION_FAILED},
+    {"VK_ERROR_DEVICE_LOST", VK_ERROR_DEVICE_LOST},
+    {"VK_ERROR_EXTENSION_NOT_PRESENT", VK_ERROR_EXTENSION_NOT_PRESENT},
+    {"VK_ERROR_FEATURE_NOT_PRESENT", VK_ERROR_FEATURE_NOT_PRESENT},
+    {"VK_ERROR_INCOMPATIBLE_DRIVER", VK_ERROR_INCOMPATIBLE_DRIVER},
+    {"VK_ERROR_SURFACE_LOST_KHR", VK_ERROR_SURFACE_LOST_KHR},
+    {"VK_ERROR_OUT_OF_DATE_KHR", VK_ERROR_OUT_OF_DATE_KHR},
+};
+
+static const struct {
+    const char *name;
+    VkPresentModeKHR mode;
+} present_mode_names[MAX_PRESENT_MODES] = {
+    {"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR},
+    {"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+    {"fifo", VK_PRESENT_MODE_FIFO_KHR},
+    {"fifo_relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR},
+};
+
+static const struct {
+    const char *name;
+    VkFormat format;
+} format_names[MAX_SURFACE_FORMATS] = {
+    {"bgra8_srgb", VK_FORMAT_B8G8R8A8_SRGB},
+    {"rgba8_srgb", VK_FORMAT_R8G8B8A8_SRGB},
+    {"bgra8_unorm", VK_FORMAT_B8G8R8A8_UNORM},
+    {"rgba8_unorm", VK_FORMAT_R8G8B8A8_UNORM},
+    {"a2b10g10r10", VK_FORMAT_A2B10G10R10_UNORM_PACK32},
+    {"a2r10g10b10", VK_FORMAT_A2R10G10B10_UNORM_PACK32},
+    {"undefined", VK_FORMAT_UNDEFINED},
+};
+
+static mock_config_t config;
+static pthread_once_t config_once = PTHREAD_ONCE_INIT;
+/** Protects call counters of rules and handle counter */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+/** Last value of handles of objects that have no state */
+static uint64_t last_handle = 0;
+
+/* Entry points the loader looks up by name */
+VKAPI_ATTR VkResult VKAPI_CALL
+vk_icdNegotiateLoaderICDInterfaceVersion (uint32_t *pSupportedVersion);
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL
+vk_icdGetInstanceProcAddr (VkInstance instance, const char *pName);
+
+static uint32_t parse_uint (const char *variable, uint32_t default_value)
+{
+    const char *value = getenv (variable);
+    char *end = NULL;
+    unsigned long number = 0;
+    if (value == NULL || *value == '\0') {
+        return default_value;
+    }
+    number = strtoul (value, &end, 10);
+    if (*end != '\0' || number > UINT32_MAX) {
+        fprintf (stderr, "mock icd: invalid %s '%s'\n", variable, value);
+        return default_value;
+    }
+    return (uint32_t)number;
+}
+
+static int parse_result (const char *name, VkResult *pResult)
+{
+    char *end = NULL;
+    long value = 0;
+    for (size_t i = 0; i < sizeof (result_names) / sizeof (result_names[0]);
+            i++) {
+        if (strcmp (name, result_names[i].name) == 0) {
+            *pResult = result_names[i].result;
+            return 1;
+        }
+    }
+    value = strtol (name, &end, 10);
+    if (*name == '\0' || *end != '\0' || value < INT32_MIN
+            || value > INT32_MAX) {
+        return 0;
+    }
+    *pResult = (VkResult)value;
+    return 1;
+}
+
+static void parse_present_modes (const char *value)
+{
+    char buffer[256];
+    char *saveptr = NULL;
+    snprintf (buffer, sizeof (buffer), "%s", value);
+    config.present_mode_count = 0;
+    for (char *token = strtok_r (buffer, ",", &saveptr); token != NULL;
+            token = strtok_r (NULL, ",", &saveptr)) {
+        uint32_t i = 0;
+        while (i < MAX_PRESENT_MODES
+                && strcmp (token, present_mode_names[i].name) != 0) {
+            i++;
+        }
+        if (i == MAX_PRESENT_MODES) {
+            fprintf (stderr, "mock icd: unknown present mode '%s'\n", token);
+        } else if (config.present_mode_count < MAX_PRESENT_MODES) {
+            config.present_modes[config.present_mode_count++] =
+                present_mode_names[i].mode;
+        }
+    }
+}
+
+static void parse_formats (const char *value)
+{
+    char buffer[256];
+    char *saveptr = NULL;
+    snprintf (buffer, sizeof (buffer), "%s", value);
+    config.format_count = 0;
+    for (char *token = strtok_r (buffer, ",", &saveptr); token != NULL;
+            token = strtok_r (NULL, ",", &saveptr)) {
+        uint32_t i = 0;
+        while (i < MAX_SURFACE_FORMATS
+                && strcmp (token, format_names[i].name) != 0) {
+            i++;
+        }
+        if (i == MAX_SURFACE_FORMATS) {
+            fprintf (stderr, "mock icd: unknown format '%s'\n", token);
+        } else if (config.format_count < MAX_SURFACE_FORMATS) {
+            config.formats[config.format_count].format = format_names[i].format;
+            config.formats[config.format_count].colorSpace =
+                VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+            config.format_count++;
+        }
+    }
+}
+
+/** Parse comma separated FUNCTION:VALUE rules
+ * @param is_error non-zero if VALUE is RESULT[@CALL], otherwise it is latency
+ */
+static void parse_rules (const char *variable, int is_error)
+{
+    const char *value = getenv (variable);
+    char buffer[1024];
+    char *saveptr = NULL;
+    if (value == NULL) {
+        return;
+    }
+    snprintf (buffer, sizeof (buffer), "%s", value);
+    for (char *token = strtok_r (buffer, ",", &saveptr); token != NULL;
+            token = strtok_r (NULL, ",", &saveptr)) {
+        mock_rule_t *rule = &config.rules[config.rule_count];
+        char *argument = strchr (token, ':');
+        char *call = NULL;
+        char *end = NULL;
+        int is_range_valid = 1;
+        int is_valid = 0;
+        if (config.rule_count == MAX_RULES || argument == NULL
+                || (size_t)(argument - token) >= sizeof (rule->function)) {
+            fprintf (stderr, "mock icd: ignored %s rule '%s'\n", variable,
+                     token);
+            continue;
+        }
+        memset (rule, 0, sizeof (*rule));
+        *argument++ = '\0';
+        strcpy (rule->function, token);
+        rule->is_error = is_error;
+        if (is_error) {
+            call = strchr (argument, '@');
+            if (call != NULL) {
+                *call++ = '\0';
+                rule->first_call = strtoul (call, &end, 10);
+                if (*end == '-') {
+                    rule->last_call = strtoul (end + 1, &end, 10);
+                    is_range_valid = rule->last_call >= rule->first_call;
+                }
+                is_range_valid = is_range_valid && *end == '\0'
+                                 && rule->first_call > 0;
+            }
+            is_valid = parse_result (argument, &rule->result) && is_range_valid;
+        } else {
+            rule->latency_us = strtoul (argument, &end, 10);
+            is_valid = *argument != '\0' && *end == '\0';
+        }
+        if (is_valid) {
+            config.rule_count++;
+        } else {
+            fprintf (stderr, "mock icd: ignored %s rule '%s'\n", variable,
+                     token);
+        }
+    }
+}
+
+static void load_config (void)
+{
+    const char *modes = getenv ("VKBOOTSTRAP_MOCK_PRESENT_MODES");
+    const char *formats = getenv ("VKBOOTSTRAP_MOCK_FORMATS");
+    const char *images = getenv ("VKBOOTSTRAP_MOCK_IMAGES");
+    const char *extent = getenv ("VKBOOTSTRAP_MOCK_EXTENT");
+    config.device_count = parse_uint ("VKBOOTSTRAP_MOCK_DEVICES", 1);
+    config.queue_family_count = parse_uint ("VKBOOTSTRAP_MOCK_QUEUE_FAMILIES",
+                                            1);
+    config.graphics_family = parse_uint ("VKBOOTSTRAP_MOCK_GRAPHICS_FAMILY", 0);
+    config.present_family = parse_uint ("VKBOOTSTRAP_MOCK_PRESENT_FAMILY", 0);
+    config.memory_heap_count = parse_uint ("VKBOOTSTRAP_MOCK_MEMORY_HEAPS", 2);
+    if (config.memory_heap_count > VK_MAX_MEMORY_HEAPS) {
+        config.memory_heap_count = VK_MAX_MEMORY_HEAPS;
+    }
+    config.present_modes[0] = VK_PRESENT_MODE_FIFO_KHR;
+    config.present_mode_count = 1;
+    if (modes != NULL) {
+        parse_present_modes (modes);
+    }
+    config.formats[0].format = VK_FORMAT_B8G8R8A8_SRGB;
+    config.formats[1].format = VK_FORMAT_R8G8B8A8_SRGB;
+    config.format_count = 2;
+    if (formats != NULL) {
+        parse_formats (formats);
+    }
+    config.min_image_count = 2;
+    config.max_image_count = 8;
+    if (images != NULL && sscanf (images, "%u,%u", &config.min_image_count,
+                                  &config.max_image_count) != 2) {
+        fprintf (stderr, "mock icd: invalid VKBOOTSTRAP_MOCK_IMAGES '%s'\n",
+                 images);
+    }
+    if (config.min_image_count > MAX_SWAPCHAIN_IMAGES) {
+        config.min_image_count = MAX_SWAPCHAIN_IMAGES;
+    }
+    if (config.max_image_count == 0
+            || config.max_image_count > MAX_SWAPCHAIN_IMAGES) {
+        config.max_image_count = MAX_SWAPCHAIN_IMAGES;
+    }
+    config.extent.width = UINT32_MAX;
+    config.extent.height = UINT32_MAX;
+    if (extent != NULL && strcmp (extent, "any") != 0
+            && sscanf (extent, "%ux%u", &config.extent.width,
+                       &config.extent.height) != 2) {
+        fprintf (stderr, "mock icd: invalid VKBOOTSTRAP_MOCK_EXTENT '%s'\n",
+                 extent);
+    }
+    config.has_headless_surface =
+        parse_uint ("VKBOOTSTRAP_MOCK_HEADLESS_SURFACE", 1) != 0;
+    parse_rules ("VKBOOTSTRAP_MOCK_LATENCY", 0);
+    parse_rules ("VKBOOTSTRAP_MOCK_ERRORS", 1);
+}
+
+static const mock_config_t *get_config (void)
+{
+    pthread_once (&config_once, load_config);
+    return &config;
+}
+
+/** Apply rules of entry point, called first by each of them
+ * @returns result to fail with, VK_SUCCESS if no error is injected
+ */
+static VkResult inject (const char *function)
+{
+    const mock_config_t *cfg = get_config ();
+    VkResult result = VK_SUCCESS;
+    unsigned long latency_us = 0;
+    if (cfg->rule_count == 0) {
+        return VK_SUCCESS;
+    }
+    pthread_mutex_lock (&mutex);
+    for (uint32_t i = 0; i < config.rule_count; i++) {
+        mock_rule_t *rule = &config.rules[i];
+        if (strcmp (rule->function, function) != 0) {
+            continue;
+        }
+        rule->calls++;
+        if (!rule->is_error) {
+            latency_us += rule->latency_us;
+        } else if (rule->calls >= rule->first_call
+                   && (rule->last_call == 0 || rule->calls <= rule->last_call)) {
+            result = rule->result;
+        }
+    }
+    pthread_mutex_unlock (&mutex);
+    if (latency_us > 0) {
+        const struct timespec delay = {
+            .tv_sec = (time_t)(latency_us / 1000000),
+            .tv_nsec = (long)(latency_us % 1000000) * 1000,
+        };
+        nanosleep (&delay, NULL);
+    }
+    return result;
+}
+
+/** Make unique handle for object that has no state */
+static uint64_t new_handle (void)
+{
+    uint64_t handle = 0;
+    pthread_mutex_lock (&mutex);
+    handle = ++last_handle;
+    pthread_mutex_unlock (&mutex);
+    return handle;
+}
+
+#define HANDLE(type, value) ((type)(uintptr_t)(value))
+#define OBJECT(type, handle) ((type *)(uintptr_t)(handle))
+
+/** Copy array to caller following two-call idiom of Vulkan */
+static VkResult copy_array (const void *source, uint32_t count, size_t size,
+                            uint32_t *pCount, void *destination)
+{
+    if (destination == NULL) {
+        *pCount = count;
+        return VK_SUCCESS;
+    }
+    if (*pCount > count) {
+        *pCount = count;
+    }
+    memcpy (destination, source, *pCount * size);
+    return *pCount < count ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_EnumerateInstanceExtensionProperties (const char *pLayerName,
+        uint32_t *pPropertyCount, VkExtensionProperties *pProperties)
+{
+    VkExtensionProperties extensions[3];
+    uint32_t count = 0;
+    VkResult result = inject ("vkEnumerateInstanceExtensionProperties");
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (pLayerName != NULL) {
+        return VK_ERROR_LAYER_NOT_PRESENT;
+    }
+    memset (extensions, 0, sizeof (extensions));
+    strcpy (extensions[count].extensionName, VK_KHR_SURFACE_EXTENSION_NAME);
+    extensions[count++].specVersion = VK_KHR_SURFACE_SPEC_VERSION;
+    strcpy (extensions[count].extensionName, VK_KHR_XCB_SURFACE_EXTENSION_NAME);
+    extensions[count++].specVersion = VK_KHR_XCB_SURFACE_SPEC_VERSION;
+#ifdef VK_EXT_headless_surface
+    if (get_config ()->has_headless_surface) {
+        strcpy (extensions[count].extensionName,
+                VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+        extensions[count++].specVersion = VK_EXT_HEADLESS_SURFACE_SPEC_VERSION;
+    }
+#endif
+    return copy_array (extensions, count, sizeof (extensions[0]),
+                       pPropertyCount, pProperties);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateInstance (const VkInstanceCreateInfo *pCreateInfo,
+                     const VkAllocationCallbacks *pAllocator,
+                     VkInstance *pInstance)
+{
+    const mock_config_t *cfg = get_config ();
+    mock_instance_t *instance = NULL;
+    VkResult result = inject ("vkCreateInstance");
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    instance = (mock_instance_t *)calloc (1, sizeof (mock_instance_t));
+    if (instance == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    instance->devices = (mock_physical_device_t *)calloc (
+                            cfg->device_count + 1, sizeof (mock_physical_device_t));
+    if (instance->devices == NULL) {
+        free (instance);
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    set_loader_magic_value (instance);
+    for (uint32_t i = 0; i < cfg->device_count; i++) {
+        set_loader_magic_value (&instance->devices[i]);
+        instance->devices[i].index = i;
+    }
+    *pInstance = (VkInstance)instance;
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyInstance (VkInstance instance,
+                      const VkAllocationCallbacks *pAllocator)
+{
+    mock_instance_t *mock = (mock_instance_t *)instance;
+    (void)pAllocator;
+    if (mock != NULL) {
+        free (mock->devices);
+        free (mock);
+    }
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_EnumeratePhysicalDevices (VkInstance instance,
+                               uint32_t *pPhysicalDeviceCount,
+                               VkPhysicalDevice *pPhysicalDevices)
+{
+    const mock_instance_t *mock = (const mock_instance_t *)instance;
+    const uint32_t count = get_config ()->device_count;
+    uint32_t i = 0;
+    VkResult result = inject ("vkEnumeratePhysicalDevices");
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (pPhysicalDevices == NULL) {
+        *pPhysicalDeviceCount = count;
+        return result;
+    }
+    for (i = 0; i < *pPhysicalDeviceCount && i < count; i++) {
+        pPhysicalDevices[i] = (VkPhysicalDevice)&mock->devices[i];
+    }
+    *pPhysicalDeviceCount = i;
+    return i < count ? VK_INCOMPLETE : result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetPhysicalDeviceProperties (VkPhysicalDevice physicalDevice,
+                                  VkPhysicalDeviceProperties *pProperties)
+{
+    const mock_physical_device_t *mock =
+        (const mock_physical_device_t *)physicalDevice;
+    (void)inject ("vkGetPhysicalDeviceProperties");
+    memset (pProperties, 0, sizeof (*pProperties));
+    pProperties->apiVersion = VK_MAKE_VERSION (1, 0, VK_HEADER_VERSION);
+    pProperties->driverVersion = VK_MAKE_VERSION (0, 1, 0);
+    pProperties->vendorID = MOCK_VENDOR_ID;
+    pProperties->deviceID = mock->index + 1;
+    pProperties->deviceType = VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU;
+    snprintf (pProperties->deviceName, sizeof (pProperties->deviceName),
+              "vkbootstrap mock device %u", mock->index);
+    memcpy (pProperties->pipelineCacheUUID, &mock->index,
+            sizeof (mock->index));
+    pProperties->limits.maxImageDimension2D = MAX_EXTENT;
+    pProperties->limits.timestampPeriod = 1.0f;
+    pProperties->limits.timestampComputeAndGraphics = VK_TRUE;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetPhysicalDeviceFeatures (VkPhysicalDevice physicalDevice,
+                                VkPhysicalDeviceFeatures *pFeatures)
+{
+    (void)physicalDevice;
+    (void)inject ("vkGetPhysicalDeviceFeatures");
+    memset (pFeatures, 0, sizeof (*pFeatures));
+    pFeatures->pipelineStatisticsQuery = VK_TRUE;
+    pFeatures->inheritedQueries = VK_TRUE;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetPhysicalDeviceQueueFamilyProperties (VkPhysicalDevice physicalDevice,
+        uint32_t *pQueueFamilyPropertyCount,
+        VkQueueFamilyProperties *pQueueFamilyProperties)
+{
+    const mock_config_t *cfg = get_config ();
+    const uint32_t count = cfg->queue_family_count;
+    (void)physicalDevice;
+    (void)inject ("vkGetPhysicalDeviceQueueFamilyProperties");
+    if (pQueueFamilyProperties == NULL) {
+        *pQueueFamilyPropertyCount = count;
+        return;
+    }
+    if (*pQueueFamilyPropertyCount > count) {
+        *pQueueFamilyPropertyCount = count;
+    }
+    for (uint32_t i = 0; i < *pQueueFamilyPropertyCount; i++) {
+        VkQueueFamilyProperties *family = &pQueueFamilyProperties[i];
+        memset (family, 0, sizeof (*family));
+        family->queueFlags = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+        if (i == cfg->graphics_family) {
+            family->queueFlags |= VK_QUEUE_GRAPHICS_BIT;
+        }
+        family->queueCount = 1;
+        family->timestampValidBits = 64;
+        family->minImageTransferGranularity.width = 1;
+        family->minImageTransferGranularity.height = 1;
+        family->minImageTransferGranularity.depth = 1;
+    }
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetPhysicalDeviceMemoryProperties (VkPhysicalDevice physicalDevice,
+                                        VkPhysicalDeviceMemoryProperties *pMemoryProperties)
+{
+    const uint32_t count = get_config ()->memory_heap_count;
+    (void)physicalDevice;
+    (void)inject ("vkGetPhysicalDeviceMemoryProperties");
+    memset (pMemoryProperties, 0, sizeof (*pMemoryProperties));
+    pMemoryProperties->memoryTypeCount = count;
+    pMemoryProperties->memoryHeapCount = count;
+    for (uint32_t i = 0; i < count; i++) {
+        pMemoryProperties->memoryHeaps[i].size = (VkDeviceSize)1 << 30;
+        pMemoryProperties->memoryTypes[i].heapIndex = i;
+        if (i == 0) {
+            pMemoryProperties->memoryHeaps[i].flags =
+                VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+            pMemoryProperties->memoryTypes[i].propertyFlags =
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        } else {
+            pMemoryProperties->memoryTypes[i].propertyFlags =
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        }
+    }
+}
+
+/** Every format can be sampled, blitted and rendered to */
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetPhysicalDeviceFormatProperties (VkPhysicalDevice physicalDevice,
+                                        VkFormat format,
+                                        VkFormatProperties *pFormatProperties)
+{
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+                                          | VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT
+                                          | VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT
+                                          | VK_FORMAT_FEATURE_BLIT_SRC_BIT
+                                          | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    (void)physicalDevice;
+    (void)format;
+    (void)inject ("vkGetPhysicalDeviceFormatProperties");
+    memset (pFormatProperties, 0, sizeof (*pFormatProperties));
+    pFormatProperties->linearTilingFeatures = features;
+    pFormatProperties->optimalTilingFeatures = features;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetPhysicalDeviceImageFormatProperties (VkPhysicalDevice physicalDevice,
+        VkFormat format, VkImageType type, VkImageTiling tiling,
+        VkImageUsageFlags usage, VkImageCreateFlags flags,
+        VkImageFormatProperties *pImageFormatProperties)
+{
+    VkResult result = inject ("vkGetPhysicalDeviceImageFormatProperties");
+    (void)physicalDevice;
+    (void)format;
+    (void)type;
+    (void)tiling;
+    (void)usage;
+    (void)flags;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    memset (pImageFormatProperties, 0, sizeof (*pImageFormatProperties));
+    pImageFormatProperties->maxExtent.width = MAX_EXTENT;
+    pImageFormatProperties->maxExtent.height = MAX_EXTENT;
+    pImageFormatProperties->maxExtent.depth = 1;
+    pImageFormatProperties->maxMipLevels = 1;
+    pImageFormatProperties->maxArrayLayers = 1;
+    pImageFormatProperties->sampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    pImageFormatProperties->maxResourceSize = (VkDeviceSize)1 << 30;
+    return result;
+}
+
+/** Sparse resources are not supported */
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetPhysicalDeviceSparseImageFormatProperties (
+    VkPhysicalDevice physicalDevice, VkFormat format, VkImageType type,
+    VkSampleCountFlagBits samples, VkImageUsageFlags usage,
+    VkImageTiling tiling, uint32_t *pPropertyCount,
+    VkSparseImageFormatProperties *pProperties)
+{
+    (void)physicalDevice;
+    (void)format;
+    (void)type;
+    (void)samples;
+    (void)usage;
+    (void)tiling;
+    (void)pProperties;
+    *pPropertyCount = 0;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_EnumerateDeviceExtensionProperties (VkPhysicalDevice physicalDevice,
+        const char *pLayerName, uint32_t *pPropertyCount,
+        VkExtensionProperties *pProperties)
+{
+    VkExtensionProperties extension;
+    VkResult result = inject ("vkEnumerateDeviceExtensionProperties");
+    (void)physicalDevice;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (pLayerName != NULL) {
+        return VK_ERROR_LAYER_NOT_PRESENT;
+    }
+    memset (&extension, 0, sizeof (extension));
+    strcpy (extension.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    extension.specVersion = VK_KHR_SWAPCHAIN_SPEC_VERSION;
+    return copy_array (&extension, 1, sizeof (extension), pPropertyCount,
+                       pProperties);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateDevice (VkPhysicalDevice physicalDevice,
+                   const VkDeviceCreateInfo *pCreateInfo,
+                   const VkAllocationCallbacks *pAllocator, VkDevice *pDevice)
+{
+    const mock_config_t *cfg = get_config ();
+    mock_device_t *device = NULL;
+    VkResult result = inject ("vkCreateDevice");
+    (void)physicalDevice;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t i = 0; i < pCreateInfo->queueCreateInfoCount; i++) {
+        if (pCreateInfo->pQueueCreateInfos[i].queueFamilyIndex
+                >= cfg->queue_family_count
+                || pCreateInfo->pQueueCreateInfos[i].queueCount != 1) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+    }
+    for (uint32_t i = 0; i < pCreateInfo->enabledExtensionCount; i++) {
+        if (strcmp (pCreateInfo->ppEnabledExtensionNames[i],
+                    VK_KHR_SWAPCHAIN_EXTENSION_NAME) != 0) {
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+    }
+    device = (mock_device_t *)calloc (1, sizeof (mock_device_t));
+    if (device == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    set_loader_magic_value (device);
+    set_loader_magic_value (&device->queue);
+    *pDevice = (VkDevice)device;
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyDevice (VkDevice device, const VkAllocationCallbacks *pAllocator)
+{
+    (void)pAllocator;
+    free (device);
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetDeviceQueue (VkDevice device, uint32_t queueFamilyIndex,
+                     uint32_t queueIndex, VkQueue *pQueue)
+{
+    mock_device_t *mock = (mock_device_t *)device;
+    (void)queueFamilyIndex;
+    (void)queueIndex;
+    *pQueue = (VkQueue)&mock->queue;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_DeviceWaitIdle (VkDevice device)
+{
+    (void)device;
+    return inject ("vkDeviceWaitIdle");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_QueueSubmit (VkQueue queue, uint32_t submitCount,
+                  const VkSubmitInfo *pSubmits, VkFence fence)
+{
+    VkResult result = inject ("vkQueueSubmit");
+    (void)queue;
+    (void)submitCount;
+    (void)pSubmits;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    /* Work is done as soon as it is submitted */
+    if (fence != VK_NULL_HANDLE) {
+        OBJECT (mock_fence_t, fence)->is_signaled = 1;
+    }
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_QueueWaitIdle (VkQueue queue)
+{
+    (void)queue;
+    return inject ("vkQueueWaitIdle");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateFence (VkDevice device, const VkFenceCreateInfo *pCreateInfo,
+                  const VkAllocationCallbacks *pAllocator, VkFence *pFence)
+{
+    mock_fence_t *fence = NULL;
+    VkResult result = inject ("vkCreateFence");
+    (void)device;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    fence = (mock_fence_t *)malloc (sizeof (mock_fence_t));
+    if (fence == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    fence->is_signaled = (pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) != 0;
+    *pFence = HANDLE (VkFence, fence);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyFence (VkDevice device, VkFence fence,
+                   const VkAllocationCallbacks *pAllocator)
+{
+    (void)device;
+    (void)pAllocator;
+    free (OBJECT (mock_fence_t, fence));
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_ResetFences (VkDevice device, uint32_t fenceCount, const VkFence *pFences)
+{
+    VkResult result = inject ("vkResetFences");
+    (void)device;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t i = 0; i < fenceCount; i++) {
+        OBJECT (mock_fence_t, pFences[i])->is_signaled = 0;
+    }
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_WaitForFences (VkDevice device, uint32_t fenceCount,
+                    const VkFence *pFences, VkBool32 waitAll, uint64_t timeout)
+{
+    uint32_t signaled = 0;
+    VkResult result = inject ("vkWaitForFences");
+    (void)device;
+    (void)timeout;
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t i = 0; i < fenceCount; i++) {
+        signaled += (uint32_t)OBJECT (mock_fence_t, pFences[i])->is_signaled;
+    }
+    /* Fence that wasn't submitted would never signal, so don't block */
+    if (signaled == 0 || (waitAll && signaled < fenceCount)) {
+        return VK_TIMEOUT;
+    }
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_AllocateMemory (VkDevice device, const VkMemoryAllocateInfo *pAllocateInfo,
+                     const VkAllocationCallbacks *pAllocator,
+                     VkDeviceMemory *pMemory)
+{
+    mock_memory_t *memory = NULL;
+    VkResult result = inject ("vkAllocateMemory");
+    (void)device;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (pAllocateInfo->memoryTypeIndex >= get_config ()->memory_heap_count) {
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+    memory = (mock_memory_t *)calloc (1, sizeof (mock_memory_t));
+    if (memory == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    memory->size = pAllocateInfo->allocationSize;
+    *pMemory = HANDLE (VkDeviceMemory, memory);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_FreeMemory (VkDevice device, VkDeviceMemory memory,
+                 const VkAllocationCallbacks *pAllocator)
+{
+    mock_memory_t *mock = OBJECT (mock_memory_t, memory);
+    (void)device;
+    (void)pAllocator;
+    if (mock != NULL) {
+        free (mock->data);
+        free (mock);
+    }
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_MapMemory (VkDevice device, VkDeviceMemory memory, VkDeviceSize offset,
+                VkDeviceSize size, VkMemoryMapFlags flags, void **ppData)
+{
+    mock_memory_t *mock = OBJECT (mock_memory_t, memory);
+    VkResult result = inject ("vkMapMemory");
+    (void)device;
+    (void)size;
+    (void)flags;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (mock->data == NULL) {
+        mock->data = calloc (1, (size_t)mock->size);
+        if (mock->data == NULL) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+    }
+    *ppData = (char *)mock->data + offset;
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_UnmapMemory (VkDevice device, VkDeviceMemory memory)
+{
+    (void)device;
+    (void)memory;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_FlushMappedMemoryRanges (VkDevice device, uint32_t memoryRangeCount,
+                              const VkMappedMemoryRange *pMemoryRanges)
+{
+    (void)device;
+    (void)memoryRangeCount;
+    (void)pMemoryRanges;
+    return inject ("vkFlushMappedMemoryRanges");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateBuffer (VkDevice device, const VkBufferCreateInfo *pCreateInfo,
+                   const VkAllocationCallbacks *pAllocator, VkBuffer *pBuffer)
+{
+    mock_buffer_t *buffer = NULL;
+    VkResult result = inject ("vkCreateBuffer");
+    (void)device;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    buffer = (mock_buffer_t *)malloc (sizeof (mock_buffer_t));
+    if (buffer == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    buffer->size = pCreateInfo->size;
+    *pBuffer = HANDLE (VkBuffer, buffer);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyBuffer (VkDevice device, VkBuffer buffer,
+                    const VkAllocationCallbacks *pAllocator)
+{
+    (void)device;
+    (void)pAllocator;
+    free (OBJECT (mock_buffer_t, buffer));
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetBufferMemoryRequirements (VkDevice device, VkBuffer buffer,
+                                  VkMemoryRequirements *pMemoryRequirements)
+{
+    const uint32_t count = get_config ()->memory_heap_count;
+    (void)device;
+    pMemoryRequirements->size = OBJECT (mock_buffer_t, buffer)->size;
+    pMemoryRequirements->alignment = 256;
+    pMemoryRequirements->memoryTypeBits = count >= 32 ? UINT32_MAX
+                                          : (1u << count) - 1;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_BindBufferMemory (VkDevice device, VkBuffer buffer, VkDeviceMemory memory,
+                       VkDeviceSize memoryOffset)
+{
+    (void)device;
+    (void)buffer;
+    (void)memory;
+    (void)memoryOffset;
+    return inject ("vkBindBufferMemory");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateImage (VkDevice device, const VkImageCreateInfo *pCreateInfo,
+                  const VkAllocationCallbacks *pAllocator, VkImage *pImage)
+{
+    mock_image_t *image = NULL;
+    VkResult result = inject ("vkCreateImage");
+    (void)device;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    image = (mock_image_t *)malloc (sizeof (mock_image_t));
+    if (image == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    image->extent = pCreateInfo->extent;
+    *pImage = HANDLE (VkImage, image);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyImage (VkDevice device, VkImage image,
+                   const VkAllocationCallbacks *pAllocator)
+{
+    (void)device;
+    (void)pAllocator;
+    free (OBJECT (mock_image_t, image));
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_GetImageMemoryRequirements (VkDevice device, VkImage image,
+                                 VkMemoryRequirements *pMemoryRequirements)
+{
+    const mock_image_t *mock = OBJECT (mock_image_t, image);
+    const uint32_t count = get_config ()->memory_heap_count;
+    (void)device;
+    pMemoryRequirements->size = (VkDeviceSize)mock->extent.width
+                                * mock->extent.height * mock->extent.depth * 4;
+    pMemoryRequirements->alignment = 256;
+    pMemoryRequirements->memoryTypeBits = count >= 32 ? UINT32_MAX
+                                          : (1u << count) - 1;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_BindImageMemory (VkDevice device, VkImage image, VkDeviceMemory memory,
+                      VkDeviceSize memoryOffset)
+{
+    (void)device;
+    (void)image;
+    (void)memory;
+    (void)memoryOffset;
+    return inject ("vkBindImageMemory");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateQueryPool (VkDevice device, const VkQueryPoolCreateInfo *pCreateInfo,
+                      const VkAllocationCallbacks *pAllocator,
+                      VkQueryPool *pQueryPool)
+{
+    mock_query_pool_t *pool = NULL;
+    VkResult result = inject ("vkCreateQueryPool");
+    (void)device;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    pool = (mock_query_pool_t *)malloc (sizeof (mock_query_pool_t));
+    if (pool == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    pool->type = pCreateInfo->queryType;
+    pool->count = pCreateInfo->queryCount;
+    *pQueryPool = HANDLE (VkQueryPool, pool);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyQueryPool (VkDevice device, VkQueryPool queryPool,
+                       const VkAllocationCallbacks *pAllocator)
+{
+    (void)device;
+    (void)pAllocator;
+    free (OBJECT (mock_query_pool_t, queryPool));
+}
+
+/** Timestamps grow by TIMESTAMP_STEP per query, other queries are zero */
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetQueryPoolResults (VkDevice device, VkQueryPool queryPool,
+                          uint32_t firstQuery, uint32_t queryCount,
+                          size_t dataSize, void *pData, VkDeviceSize stride,
+                          VkQueryResultFlags flags)
+{
+    const mock_query_pool_t *pool = OBJECT (mock_query_pool_t, queryPool);
+    VkResult result = inject ("vkGetQueryPoolResults");
+    (void)device;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    memset (pData, 0, dataSize);
+    for (uint32_t i = 0; i < queryCount && pool->type == VK_QUERY_TYPE_TIMESTAMP;
+            i++) {
+        const uint64_t value = (uint64_t)(firstQuery + i) * TIMESTAMP_STEP;
+        uint8_t *destination = (uint8_t *)pData + i * stride;
+        if (flags & VK_QUERY_RESULT_64_BIT) {
+            memcpy (destination, &value, sizeof (value));
+        } else {
+            const uint32_t value32 = (uint32_t)value;
+            memcpy (destination, &value32, sizeof (value32));
+        }
+    }
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreatePipelineCache (VkDevice device,
+                          const VkPipelineCacheCreateInfo *pCreateInfo,
+                          const VkAllocationCallbacks *pAllocator,
+                          VkPipelineCache *pPipelineCache)
+{
+    VkResult result = inject ("vkCreatePipelineCache");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pPipelineCache = HANDLE (VkPipelineCache, new_handle ());
+    return result;
+}
+
+/** Cache data is a bare header, see mock_GetPhysicalDeviceProperties() */
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetPipelineCacheData (VkDevice device, VkPipelineCache pipelineCache,
+                           size_t *pDataSize, void *pData)
+{
+    mock_cache_header_t header;
+    VkResult result = inject ("vkGetPipelineCacheData");
+    (void)device;
+    (void)pipelineCache;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (pData == NULL) {
+        *pDataSize = sizeof (header);
+        return result;
+    }
+    if (*pDataSize < sizeof (header)) {
+        *pDataSize = 0;
+        return VK_INCOMPLETE;
+    }
+    memset (&header, 0, sizeof (header));
+    header.length = sizeof (header);
+    header.version = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+    header.vendorID = MOCK_VENDOR_ID;
+    /* Device is unknown here, so the cache matches the first one */
+    header.deviceID = 1;
+    memcpy (pData, &header, sizeof (header));
+    *pDataSize = sizeof (header);
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateCommandPool (VkDevice device,
+                        const VkCommandPoolCreateInfo *pCreateInfo,
+                        const VkAllocationCallbacks *pAllocator,
+                        VkCommandPool *pCommandPool)
+{
+    mock_command_pool_t *pool = NULL;
+    VkResult result = inject ("vkCreateCommandPool");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    pool = (mock_command_pool_t *)calloc (1, sizeof (mock_command_pool_t));
+    if (pool == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    *pCommandPool = HANDLE (VkCommandPool, pool);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyCommandPool (VkDevice device, VkCommandPool commandPool,
+                         const VkAllocationCallbacks *pAllocator)
+{
+    mock_command_pool_t *pool = OBJECT (mock_command_pool_t, commandPool);
+    (void)device;
+    (void)pAllocator;
+    if (pool == NULL) {
+        return;
+    }
+    while (pool->buffers != NULL) {
+        mock_command_buffer_t *next = pool->buffers->next;
+        free (pool->buffers);
+        pool->buffers = next;
+    }
+    free (pool);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_ResetCommandPool (VkDevice device, VkCommandPool commandPool,
+                       VkCommandPoolResetFlags flags)
+{
+    (void)device;
+    (void)commandPool;
+    (void)flags;
+    return inject ("vkResetCommandPool");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_AllocateCommandBuffers (VkDevice device,
+                             const VkCommandBufferAllocateInfo *pAllocateInfo,
+                             VkCommandBuffer *pCommandBuffers)
+{
+    mock_command_pool_t *pool = OBJECT (mock_command_pool_t,
+                                        pAllocateInfo->commandPool);
+    VkResult result = inject ("vkAllocateCommandBuffers");
+    (void)device;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; i++) {
+        mock_command_buffer_t *buffer = (mock_command_buffer_t *)calloc (1,
+                                        sizeof (mock_command_buffer_t));
+        if (buffer == NULL) {
+            /* Buffers allocated so far are freed with the pool */
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        set_loader_magic_value (buffer);
+        buffer->next = pool->buffers;
+        pool->buffers = buffer;
+        pCommandBuffers[i] = (VkCommandBuffer)buffer;
+    }
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_FreeCommandBuffers (VkDevice device, VkCommandPool commandPool,
+                         uint32_t commandBufferCount,
+                         const VkCommandBuffer *pCommandBuffers)
+{
+    mock_command_pool_t *pool = OBJECT (mock_command_pool_t, commandPool);
+    (void)device;
+    for (uint32_t i = 0; i < commandBufferCount; i++) {
+        mock_command_buffer_t **link = &pool->buffers;
+        while (*link != NULL
+                && *link != (mock_command_buffer_t *)pCommandBuffers[i]) {
+            link = &(*link)->next;
+        }
+        if (*link != NULL) {
+            mock_command_buffer_t *buffer = *link;
+            *link = buffer->next;
+            free (buffer);
+        }
+    }
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_BeginCommandBuffer (VkCommandBuffer commandBuffer,
+                         const VkCommandBufferBeginInfo *pBeginInfo)
+{
+    (void)commandBuffer;
+    (void)pBeginInfo;
+    return inject ("vkBeginCommandBuffer");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_EndCommandBuffer (VkCommandBuffer commandBuffer)
+{
+    (void)commandBuffer;
+    return inject ("vkEndCommandBuffer");
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateSemaphore (VkDevice device, const VkSemaphoreCreateInfo *pCreateInfo,
+                      const VkAllocationCallbacks *pAllocator,
+                      VkSemaphore *pSemaphore)
+{
+    VkResult result = inject ("vkCreateSemaphore");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pSemaphore = HANDLE (VkSemaphore, new_handle ());
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateImageView (VkDevice device, const VkImageViewCreateInfo *pCreateInfo,
+                      const VkAllocationCallbacks *pAllocator,
+                      VkImageView *pView)
+{
+    VkResult result = inject ("vkCreateImageView");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pView = HANDLE (VkImageView, new_handle ());
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateFramebuffer (VkDevice device,
+                        const VkFramebufferCreateInfo *pCreateInfo,
+                        const VkAllocationCallbacks *pAllocator,
+                        VkFramebuffer *pFramebuffer)
+{
+    VkResult result = inject ("vkCreateFramebuffer");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pFramebuffer = HANDLE (VkFramebuffer, new_handle ());
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateRenderPass (VkDevice device,
+                       const VkRenderPassCreateInfo *pCreateInfo,
+                       const VkAllocationCallbacks *pAllocator,
+                       VkRenderPass *pRenderPass)
+{
+    VkResult result = inject ("vkCreateRenderPass");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pRenderPass = HANDLE (VkRenderPass, new_handle ());
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateShaderModule (VkDevice device,
+                         const VkShaderModuleCreateInfo *pCreateInfo,
+                         const VkAllocationCallbacks *pAllocator,
+                         VkShaderModule *pShaderModule)
+{
+    VkResult result = inject ("vkCreateShaderModule");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pShaderModule = HANDLE (VkShaderModule, new_handle ());
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreatePipelineLayout (VkDevice device,
+                           const VkPipelineLayoutCreateInfo *pCreateInfo,
+                           const VkAllocationCallbacks *pAllocator,
+                           VkPipelineLayout *pPipelineLayout)
+{
+    VkResult result = inject ("vkCreatePipelineLayout");
+    (void)device;
+    (void)pCreateInfo;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pPipelineLayout = HANDLE (VkPipelineLayout, new_handle ());
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateGraphicsPipelines (VkDevice device, VkPipelineCache pipelineCache,
+                              uint32_t createInfoCount,
+                              const VkGraphicsPipelineCreateInfo *pCreateInfos,
+                              const VkAllocationCallbacks *pAllocator,
+                              VkPipeline *pPipelines)
+{
+    VkResult result = inject ("vkCreateGraphicsPipelines");
+    (void)device;
+    (void)pipelineCache;
+    (void)pCreateInfos;
+    (void)pAllocator;
+    for (uint32_t i = 0; i < createInfoCount; i++) {
+        pPipelines[i] = result < VK_SUCCESS ? VK_NULL_HANDLE
+                        : HANDLE (VkPipeline, new_handle ());
+    }
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateComputePipelines (VkDevice device, VkPipelineCache pipelineCache,
+                             uint32_t createInfoCount,
+                             const VkComputePipelineCreateInfo *pCreateInfos,
+                             const VkAllocationCallbacks *pAllocator,
+                             VkPipeline *pPipelines)
+{
+    VkResult result = inject ("vkCreateComputePipelines");
+    (void)device;
+    (void)pipelineCache;
+    (void)pCreateInfos;
+    (void)pAllocator;
+    for (uint32_t i = 0; i < createInfoCount; i++) {
+        pPipelines[i] = result < VK_SUCCESS ? VK_NULL_HANDLE
+                        : HANDLE (VkPipeline, new_handle ());
+    }
+    return result;
+}
+
+/** Destroys objects that are plain handles without state */
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroyHandle (VkDevice device, uint64_t handle,
+                    const VkAllocationCallbacks *pAllocator)
+{
+    (void)device;
+    (void)handle;
+    (void)pAllocator;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetPhysicalDeviceSurfaceSupportKHR (VkPhysicalDevice physicalDevice,
+        uint32_t queueFamilyIndex, VkSurfaceKHR surface, VkBool32 *pSupported)
+{
+    VkResult result = inject ("vkGetPhysicalDeviceSurfaceSupportKHR");
+    (void)physicalDevice;
+    (void)surface;
+    *pSupported = queueFamilyIndex == get_config ()->present_family
+                  ? VK_TRUE : VK_FALSE;
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetPhysicalDeviceSurfaceCapabilitiesKHR (VkPhysicalDevice physicalDevice,
+        VkSurfaceKHR surface, VkSurfaceCapabilitiesKHR *pSurfaceCapabilities)
+{
+    const mock_config_t *cfg = get_config ();
+    VkResult result = inject ("vkGetPhysicalDeviceSurfaceCapabilitiesKHR");
+    (void)physicalDevice;
+    (void)surface;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    memset (pSurfaceCapabilities, 0, sizeof (*pSurfaceCapabilities));
+    pSurfaceCapabilities->minImageCount = cfg->min_image_count;
+    pSurfaceCapabilities->maxImageCount = cfg->max_image_count;
+    pSurfaceCapabilities->currentExtent = cfg->extent;
+    pSurfaceCapabilities->minImageExtent.width = 1;
+    pSurfaceCapabilities->minImageExtent.height = 1;
+    pSurfaceCapabilities->maxImageExtent.width = MAX_EXTENT;
+    pSurfaceCapabilities->maxImageExtent.height = MAX_EXTENT;
+    pSurfaceCapabilities->maxImageArrayLayers = 1;
+    pSurfaceCapabilities->supportedTransforms =
+        VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    pSurfaceCapabilities->currentTransform =
+        VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    pSurfaceCapabilities->supportedCompositeAlpha =
+        VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    pSurfaceCapabilities->supportedUsageFlags =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+        | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetPhysicalDeviceSurfaceFormatsKHR (VkPhysicalDevice physicalDevice,
+        VkSurfaceKHR surface, uint32_t *pSurfaceFormatCount,
+        VkSurfaceFormatKHR *pSurfaceFormats)
+{
+    const mock_config_t *cfg = get_config ();
+    VkResult result = inject ("vkGetPhysicalDeviceSurfaceFormatsKHR");
+    (void)physicalDevice;
+    (void)surface;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    return copy_array (cfg->formats, cfg->format_count,
+                       sizeof (cfg->formats[0]), pSurfaceFormatCount,
+                       pSurfaceFormats);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetPhysicalDeviceSurfacePresentModesKHR (VkPhysicalDevice physicalDevice,
+        VkSurfaceKHR surface, uint32_t *pPresentModeCount,
+        VkPresentModeKHR *pPresentModes)
+{
+    const mock_config_t *cfg = get_config ();
+    VkResult result = inject ("vkGetPhysicalDeviceSurfacePresentModesKHR");
+    (void)physicalDevice;
+    (void)surface;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    return copy_array (cfg->present_modes, cfg->present_mode_count,
+                       sizeof (cfg->present_modes[0]), pPresentModeCount,
+                       pPresentModes);
+}
+
+/** Check if surface supports format, any format if it reports undefined */
+static int is_surface_format (const mock_config_t *cfg, VkFormat format,
+                              VkColorSpaceKHR colorSpace)
+{
+    for (uint32_t i = 0; i < cfg->format_count; i++) {
+        if (cfg->formats[i].format == VK_FORMAT_UNDEFINED
+                || (cfg->formats[i].format == format
+                    && cfg->formats[i].colorSpace == colorSpace)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_CreateSwapchainKHR (VkDevice device,
+                         const VkSwapchainCreateInfoKHR *pCreateInfo,
+                         const VkAllocationCallbacks *pAllocator,
+                         VkSwapchainKHR *pSwapchain)
+{
+    const mock_config_t *cfg = get_config ();
+    mock_swapchain_t *swapchain = NULL;
+    VkResult result = inject ("vkCreateSwapchainKHR");
+    (void)device;
+    (void)pAllocator;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (pCreateInfo->minImageCount < cfg->min_image_count
+            || pCreateInfo->minImageCount > cfg->max_image_count
+            || pCreateInfo->imageExtent.width == 0
+            || pCreateInfo->imageExtent.height == 0
+            || pCreateInfo->imageExtent.width > MAX_EXTENT
+            || pCreateInfo->imageExtent.height > MAX_EXTENT) {
+        /* Application ignored surface capabilities */
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    if (!is_surface_format (cfg, pCreateInfo->imageFormat,
+                            pCreateInfo->imageColorSpace)) {
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+    swapchain = (mock_swapchain_t *)calloc (1, sizeof (mock_swapchain_t));
+    if (swapchain == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    swapchain->image_count = pCreateInfo->minImageCount;
+    for (uint32_t i = 0; i < swapchain->image_count; i++) {
+        swapchain->images[i].extent.width = pCreateInfo->imageExtent.width;
+        swapchain->images[i].extent.height = pCreateInfo->imageExtent.height;
+        swapchain->images[i].extent.depth = 1;
+    }
+    *pSwapchain = HANDLE (VkSwapchainKHR, swapchain);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroySwapchainKHR (VkDevice device, VkSwapchainKHR swapchain,
+                          const VkAllocationCallbacks *pAllocator)
+{
+    (void)device;
+    (void)pAllocator;
+    free (OBJECT (mock_swapchain_t, swapchain));
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_GetSwapchainImagesKHR (VkDevice device, VkSwapchainKHR swapchain,
+                            uint32_t *pSwapchainImageCount,
+                            VkImage *pSwapchainImages)
+{
+    mock_swapchain_t *mock = OBJECT (mock_swapchain_t, swapchain);
+    uint32_t i = 0;
+    VkResult result = inject ("vkGetSwapchainImagesKHR");
+    (void)device;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    if (pSwapchainImages == NULL) {
+        *pSwapchainImageCount = mock->image_count;
+        return result;
+    }
+    for (i = 0; i < *pSwapchainImageCount && i < mock->image_count; i++) {
+        pSwapchainImages[i] = HANDLE (VkImage, &mock->images[i]);
+    }
+    *pSwapchainImageCount = i;
+    return i < mock->image_count ? VK_INCOMPLETE : result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_AcquireNextImageKHR (VkDevice device, VkSwapchainKHR swapchain,
+                          uint64_t timeout, VkSemaphore semaphore,
+                          VkFence fence, uint32_t *pImageIndex)
+{
+    mock_swapchain_t *mock = OBJECT (mock_swapchain_t, swapchain);
+    VkResult result = inject ("vkAcquireNextImageKHR");
+    (void)device;
+    (void)timeout;
+    (void)semaphore;
+    if (result < VK_SUCCESS) {
+        return result;
+    }
+    *pImageIndex = mock->next_image;
+    mock->next_image = (mock->next_image + 1) % mock->image_count;
+    if (fence != VK_NULL_HANDLE) {
+        OBJECT (mock_fence_t, fence)->is_signaled = 1;
+    }
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL
+mock_QueuePresentKHR (VkQueue queue, const VkPresentInfoKHR *pPresentInfo)
+{
+    VkResult result = inject ("vkQueuePresentKHR");
+    (void)queue;
+    for (uint32_t i = 0; pPresentInfo->pResults != NULL
+            && i < pPresentInfo->swapchainCount; i++) {
+        pPresentInfo->pResults[i] = result;
+    }
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL
+mock_DestroySurfaceKHR (VkInstance instance, VkSurfaceKHR surface,
+                        const VkAllocationCallbacks *pAllocator)
+{
+    (void)instance;
+    (void)surface;
+    (void)pAllocator;
+}
+
+/** Command that records nothing, used for all vkCmd* entry points */
+static VKAPI_ATTR void VKAPI_CALL
+mock_CmdNothing (void)
+{
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL
+mock_GetDeviceProcAddr (VkDevice device, const char *pName);
+
+#define ENTRY(name, function) {name, (PFN_vkVoidFunction)function}
+
+/** Entry points of the driver, device level ones included */
+static const struct {
+    const char *name;
+    PFN_vkVoidFunction function;
+} entry_points[] = {
+    ENTRY ("vkCreateInstance", mock_CreateInstance),
+    ENTRY ("vkDestroyInstance", mock_DestroyInstance),
+    ENTRY ("vkEnumerateInstanceExtensionProperties",
+           mock_EnumerateInstanceExtensionProperties),
+    ENTRY ("vkEnumeratePhysicalDevices", mock_EnumeratePhysicalDevices),
+    ENTRY ("vkGetPhysicalDeviceProperties", mock_GetPhysicalDeviceProperties),
+    ENTRY ("vkGetPhysicalDeviceFeatures", mock_GetPhysicalDeviceFeatures),
+    ENTRY ("vkGetPhysicalDeviceQueueFamilyProperties",
+           mock_GetPhysicalDeviceQueueFamilyProperties),
+    ENTRY ("vkGetPhysicalDeviceMemoryProperties",
+           mock_GetPhysicalDeviceMemoryProperties),
+    ENTRY ("vkGetPhysicalDeviceFormatProperties",
+           mock_GetPhysicalDeviceFormatProperties),
+    ENTRY ("vkGetPhysicalDeviceImageFormatProperties",
+           mock_GetPhysicalDeviceImageFormatProperties),
+    ENTRY ("vkGetPhysicalDeviceSparseImageFormatProperties",
+           mock_GetPhysicalDeviceSparseImageFormatProperties),
+    ENTRY ("vkEnumerateDeviceExtensionProperties",
+           mock_EnumerateDeviceExtensionProperties),
+    ENTRY ("vkCreateDevice", mock_CreateDevice),
+    ENTRY ("vkDestroyDevice", mock_DestroyDevice),
+    ENTRY ("vkGetDeviceProcAddr", mock_GetDeviceProcAddr),
+    ENTRY ("vkGetDeviceQueue", mock_GetDeviceQueue),
+    ENTRY ("vkDeviceWaitIdle", mock_DeviceWaitIdle),
+    ENTRY ("vkQueueSubmit", mock_QueueSubmit),
+    ENTRY ("vkCreateFence", mock_CreateFence),
+    ENTRY ("vkDestroyFence", mock_DestroyFence),
+    ENTRY ("vkResetFences", mock_ResetFences),
+    ENTRY ("vkWaitForFences", mock_WaitForFences),
+    ENTRY ("vkQueueWaitIdle", mock_QueueWaitIdle),
+    ENTRY ("vkAllocateMemory", mock_AllocateMemory),
+    ENTRY ("vkFreeMemory", mock_FreeMemory),
+    ENTRY ("vkMapMemory", mock_MapMemory),
+    ENTRY ("vkUnmapMemory", mock_UnmapMemory),
+    ENTRY ("vkFlushMappedMemoryRanges", mock_FlushMappedMemoryRanges),
+    ENTRY ("vkCreateBuffer", mock_CreateBuffer),
+    ENTRY ("vkDestroyBuffer", mock_DestroyBuffer),
+    ENTRY ("vkGetBufferMemoryRequirements", mock_GetBufferMemoryRequirements),
+    ENTRY ("vkBindBufferMemory", mock_BindBufferMemory),
+    ENTRY ("vkCreateImage", mock_CreateImage),
+    ENTRY ("vkDestroyImage", mock_DestroyImage),
+    ENTRY ("vkGetImageMemoryRequirements", mock_GetImageMemoryRequirements),
+    ENTRY ("vkBindImageMemory", mock_BindImageMemory),
+    ENTRY ("vkCreateQueryPool", mock_CreateQueryPool),
+    ENTRY ("vkDestroyQueryPool", mock_DestroyQueryPool),
+    ENTRY ("vkGetQueryPoolResults", mock_GetQueryPoolResults),
+    ENTRY ("vkCreatePipelineCache", mock_CreatePipelineCache),
+    ENTRY ("vkDestroyPipelineCache", mock_DestroyHandle),
+    ENTRY ("vkGetPipelineCacheData", mock_GetPipelineCacheData),
+    ENTRY ("vkCreateCommandPool", mock_CreateCommandPool),
+    ENTRY ("vkDestroyCommandPool", mock_DestroyCommandPool),
+    ENTRY ("vkResetCommandPool", mock_ResetCommandPool),
+    ENTRY ("vkAllocateCommandBuffers", mock_AllocateCommandBuffers),
+    ENTRY ("vkFreeCommandBuffers", mock_FreeCommandBuffers),
+    ENTRY ("vkBeginCommandBuffer", mock_BeginCommandBuffer),
+    ENTRY ("vkEndCommandBuffer", mock_EndCommandBuffer),
+    ENTRY ("vkCreateSemaphore", mock_CreateSemaphore),
+    ENTRY ("vkDestroySemaphore", mock_DestroyHandle),
+    ENTRY ("vkCreateImageView", mock_CreateImageView),
+    ENTRY ("vkDestroyImageView", mock_DestroyHandle),
+    ENTRY ("vkCreateFramebuffer", mock_CreateFramebuffer),
+    ENTRY ("vkDestroyFramebuffer", mock_DestroyHandle),
+    ENTRY ("vkCreateRenderPass", mock_CreateRenderPass),
+    ENTRY ("vkDestroyRenderPass", mock_DestroyHandle),
+    ENTRY ("vkCreateShaderModule", mock_CreateShaderModule),
+    ENTRY ("vkDestroyShaderModule", mock_DestroyHandle),
+    ENTRY ("vkCreatePipelineLayout", mock_CreatePipelineLayout),
+    ENTRY ("vkDestroyPipelineLayout", mock_DestroyHandle),
+    ENTRY ("vkCreateGraphicsPipelines", mock_CreateGraphicsPipelines),
+    ENTRY ("vkCreateComputePipelines", mock_CreateComputePipelines),
+    ENTRY ("vkDestroyPipeline", mock_DestroyHandle),
+    ENTRY ("vkCmdBeginQuery", mock_CmdNothing),
+    ENTRY ("vkCmdCopyBuffer", mock_CmdNothing),
+    ENTRY ("vkCmdPipelineBarrier", mock_CmdNothing),
+    ENTRY ("vkCmdDispatch", mock_CmdNothing),
+    ENTRY ("vkCmdEndQuery", mock_CmdNothing),
+    ENTRY ("vkCmdResetQueryPool", mock_CmdNothing),
+    ENTRY ("vkCmdWriteTimestamp", mock_CmdNothing),
+    ENTRY ("vkCmdBeginRenderPass", mock_CmdNothing),
+    ENTRY ("vkCmdEndRenderPass", mock_CmdNothing),
+    ENTRY ("vkCmdBindPipeline", mock_CmdNothing),
+    ENTRY ("vkCmdSetViewport", mock_CmdNothing),
+    ENTRY ("vkCmdSetScissor", mock_CmdNothing),
+    ENTRY ("vkCmdPushConstants", mock_CmdNothing),
+    ENTRY ("vkCmdDraw", mock_CmdNothing),
+    ENTRY ("vkCmdExecuteCommands", mock_CmdNothing),
+    ENTRY ("vkGetPhysicalDeviceSurfaceSupportKHR",
+           mock_GetPhysicalDeviceSurfaceSupportKHR),
+    ENTRY ("vkGetPhysicalDeviceSurfaceCapabilitiesKHR",
+           mock_GetPhysicalDeviceSurfaceCapabilitiesKHR),
+    ENTRY ("vkGetPhysicalDeviceSurfaceFormatsKHR",
+           mock_GetPhysicalDeviceSurfaceFormatsKHR),
+    ENTRY ("vkGetPhysicalDeviceSurfacePresentModesKHR",
+           mock_GetPhysicalDeviceSurfacePresentModesKHR),
+    ENTRY ("vkDestroySurfaceKHR", mock_DestroySurfaceKHR),
+    ENTRY ("vkCreateSwapchainKHR", mock_CreateSwapchainKHR),
+    ENTRY ("vkDestroySwapchainKHR", mock_DestroySwapchainKHR),
+    ENTRY ("vkGetSwapchainImagesKHR", mock_GetSwapchainImagesKHR),
+    ENTRY ("vkAcquireNextImageKHR", mock_AcquireNextImageKHR),
+    ENTRY ("vkQueuePresentKHR", mock_QueuePresentKHR),
+};
+
+static PFN_vkVoidFunction find_entry_point (const char *name)
+{
+    for (size_t i = 0; i < sizeof (entry_points) / sizeof (entry_points[0]);
+            i++) {
+        if (strcmp (entry_points[i].name, name) == 0) {
+            return entry_points[i].function;
+        }
+    }
+    return NULL;
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL
+mock_GetDeviceProcAddr (VkDevice device, const char *pName)
+{
+    (void)device;
+    return find_entry_point (pName);
+}
+
+/** Surfaces are created by loader, so interface 2 is enough */
+VKAPI_ATTR VkResult VKAPI_CALL
+vk_icdNegotiateLoaderICDInterfaceVersion (uint32_t *pSupportedVersion)
+{
+    if (*pSupportedVersion > 2) {
+        *pSupportedVersion = 2;
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL
+vk_icdGetInstanceProcAddr (VkInstance instance, const char *pName)
+{
+    (void)instance;
+    return find_entry_point (pName);
+}